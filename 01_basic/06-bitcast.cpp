@@ -2,7 +2,11 @@
 // 「（翻訳）C/C++のStrict Aliasingを理解する または - どうして#$@##@^%コンパイラは僕がしたい事をさせてくれないの！」
 // https://yohhoy.hatenadiary.jp/entry/20120220/p1
 
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <iostream>
+#include <utility>
 
 uint32_t swap_endian_invalid(uint32_t a)
 {
@@ -14,3 +18,12 @@ uint32_t swap_endian_invalid(uint32_t a)
     ptr[1] = tmp;
     return acopy;
 }
+
+// 正しい書き方：ポインタを読み替えず、std::bit_cast(C++20)で別の型の値としてコピーする
+// 配列をまとめてバイト順を変換するには 04-performance/byte_order.h を使う
+uint32_t swap_endian_valid(uint32_t a)
+{
+    auto halves = std::bit_cast<std::array<uint16_t, 2>>(a);
+    std::swap(halves[0], halves[1]);
+    return std::bit_cast<uint32_t>(halves);
+}
@@ -11,18 +11,21 @@
 // * bit_cast: 値のビットパターンを維持したまま別の型に変換
 
 #include <iostream>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 
+// メモリ上のバイト列を16進で表示する(大量に表示する場合は 04-performance/bitpattern.h を使う)
 #define dump_bitpattern(x) _dump_bitpattern(#x, x)
 template <class T>
 void _dump_bitpattern(const char *name, const T &x)
 {
     printf("%s : ", name);
-    unsigned char a[sizeof(T) + 2] = {0}; //
+    unsigned char a[sizeof(T)];
     std::memcpy(a, &x, sizeof(T));
-    for (int i = 0; i < sizeof(a); i++)
+    for (std::size_t i = 0; i < sizeof(a); i++)
     {
-        printf("%x", a[i]);
+        printf("%02x", a[i]); // "%x"だと0x0aが"a"になってしまうので2桁にする
     }
     printf("\n");
 }
@@ -0,0 +1,157 @@
+/// 隠れたメモリ確保を数える
+// * 01_basic/02-auto.cpp の不要なコピー、std::functionのラップ、make_shared と new の違いなどを
+//   「何回メモリ確保が起きているか」で確認する
+// * ビルド: g++ -std=c++20 -O2 -g -rdynamic 01-alloc_tracker.cpp alloc_tracker.cpp
+//   (-rdynamic を付けると確保位置の表示に関数名が出る)
+
+#include "alloc_tracker.h"
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using alloc_tracker::alloc_scope;
+
+struct X
+{
+    std::string name; // SSOに収まらない長さにしておくとコピーのたびに確保が起きる
+};
+
+[[gnu::noinline]] void make_many_strings(std::vector<std::string> &out)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        out.push_back(std::string(64, 'a' + i % 26));
+    }
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 02-auto.cpp の範囲for文。autoだと要素のコピー(=文字列の確保)が走る
+        vector<X> v(3, X{"long long long long long name"});
+
+        {
+            alloc_scope scope{"for (auto x : v)"};
+            for (auto x : v)
+            {
+                (void)x;
+            }
+        } // → new: 3 回
+        {
+            alloc_scope scope{"for (const auto &x : v)"};
+            for (const auto &x : v)
+            {
+                (void)x;
+            }
+        } // → new: 0 回
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // map<string, int> を pair<string, int> で受けるとコピーが発生する
+        map<string, int> m = {{"a long long long long key 1", 1}, {"a long long long long key 2", 2}};
+        {
+            alloc_scope scope{"const pair<string, int> &"};
+            // for (const pair<string, int> &e : m) と同じ(キーがconstでないので型が違い、一時オブジェクトが作られる)
+            // ループ変数のまま書くと -Wrange-loop-construct で警告されるので、受け直す形で明示している
+            for (const auto &kv : m)
+            {
+                const pair<string, int> &e = kv;
+                (void)e;
+            }
+        }
+        {
+            alloc_scope scope{"const auto &"};
+            for (const auto &e : m)
+            {
+                (void)e;
+            }
+        }
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // std::functionのラップ
+        // 小さなキャプチャは内部バッファに収まるが、大きくなるとヒープに確保される
+        int a = 1;
+        {
+            alloc_scope scope{"std::function (small capture)"};
+            function<int(int)> f = [a](int x)
+            { return a + x; };
+            (void)f(1);
+        }
+        {
+            alloc_scope scope{"std::function (large capture)"};
+            int b = 2, c = 3, d = 4, e = 5;
+            function<int(int)> f = [a, b, c, d, e](int x)
+            { return a + b + c + d + e + x; };
+            (void)f(1);
+        }
+        {
+            alloc_scope scope{"lambda with auto"};
+            int b = 2, c = 3, d = 4, e = 5;
+            auto f = [a, b, c, d, e](int x)
+            { return a + b + c + d + e + x; };
+            (void)f(1);
+        }
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // make_shared は管理領域とオブジェクトを1回で確保する
+        {
+            alloc_scope scope{"shared_ptr<int>(new int)"};
+            shared_ptr<int> p(new int(42)); // new int と 管理領域 の2回
+        }
+        {
+            alloc_scope scope{"make_shared<int>"};
+            auto p = make_shared<int>(42); // 1回
+        }
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // alloc_scopeは入れ子にもできる。結果だけ取り出すこともできる
+        alloc_scope outer{"outer"};
+        vector<int> v;
+        {
+            alloc_scope inner{"inner", false};
+            for (int i = 0; i < 100; i++)
+            {
+                v.push_back(i); // 容量が足りなくなるたびに再確保される
+            }
+            cout << "push_back x100 : new " << inner.delta().allocations << " times" << endl;
+        }
+        v.shrink_to_fit();
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 確保位置のサンプリング
+        // 64回に1回だけスタックを記録し、確保量の多い場所を表示する
+        alloc_tracker::enable_sampling(64);
+        vector<string> strings;
+        make_many_strings(strings);
+        vector<unique_ptr<int>> ints;
+        for (int i = 0; i < 1000; i++)
+        {
+            ints.push_back(make_unique<int>(i));
+        }
+        alloc_tracker::enable_sampling(0);
+        alloc_tracker::report_top_sites(3);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const auto g = alloc_tracker::global_counters();
+        cout << "total: new " << g.allocations << " / delete " << g.deallocations
+             << " / live " << g.live_bytes() << " bytes" << endl;
+    }
+}
+
+// Q1: 置き換えたoperator newは遅くならない？
+//   -> スレッドローカルなカウンタの加算と、アトミックな加算が数回増えるだけ。
+//      サンプリングを有効にした場合だけbacktraceのコストがかかる
+// Q2: mallocを直接呼んでいる部分は数えられる？
+//   -> 数えられない。数えるのはoperator new/deleteを通る確保だけ
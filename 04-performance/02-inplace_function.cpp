@@ -0,0 +1,144 @@
+/// std::functionの代わりになるコールバックの受け方
+// * 01_basic/04-lambda.cpp の function_with_callback は std::function<void(int)> で受けていた。
+//   std::functionはキャプチャが大きいとヒープ確保し、呼び出しも間接的になる
+// * 代わりの選択肢
+//   - inplace_function<Sig, N> : 保持する(あとで呼ぶ)場合。Nバイトを超えるキャプチャはコンパイルエラー
+//   - function_ref<Sig>        : その場で呼ぶだけの場合。所有しないのでコピーもしない
+//   - テンプレート引数で受ける  : 最速だがヘッダに実装を書く必要があり、型を保存できない
+// * ビルド: g++ -std=c++20 -O2 -march=native 02-inplace_function.cpp
+
+#include "bench.h"
+#include "function_ref.h"
+#include "inplace_function.h"
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// 04-lambda.cppと同じ関数を受け方だけ変えて並べる
+void function_with_callback(int a, std::function<void(int)> callback) { callback(a * 2); }
+void function_with_callback_ref(int a, function_ref<void(int)> callback) { callback(a * 2); }
+
+// あとで呼ぶためにコールバックを保持するクラス
+class button
+{
+public:
+    void on_click(inplace_function<void(int), 16> handler) { handler_ = std::move(handler); }
+    void click(int x) const
+    {
+        if (handler_)
+            handler_(x);
+    }
+
+private:
+    inplace_function<void(int), 16> handler_;
+};
+
+//
+// ベンチマーク用
+//
+constexpr int iterations = 10'000'000;
+
+template <class F>
+[[gnu::noinline]] std::int64_t call_n(const F &f, int n)
+{
+    std::int64_t sum = 0; // intでは1000万回の合計があふれる(符号付きのオーバーフローは未定義動作)
+    for (int i = 0; i < n; i++)
+    {
+        sum += f(i);
+    }
+    return sum;
+}
+
+template <class Wrapper>
+[[gnu::noinline]] int construct_and_call(int a, int b, int c, int d)
+{
+    // 4つのintと1つのポインタ(24バイト)をキャプチャ。libstdc++のstd::functionの内部バッファ(16バイト)には入らない
+    int sum = 0;
+    const int *p = &sum;
+    Wrapper w = [a, b, c, d, p](int x)
+    { return a + b + c + d + x + (p != nullptr); };
+    sum += w(1);
+    return sum;
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 使い方
+        function_with_callback(5, [](int x)
+                               { cout << "std::function : " << x << endl; });
+        function_with_callback_ref(5, [](int x)
+                                   { cout << "function_ref  : " << x << endl; });
+
+        button b;
+        int clicked = 0;
+        b.on_click([&clicked](int x)
+                   { clicked += x; });
+        b.click(3);
+        b.click(4);
+        cout << "clicked : " << clicked << endl; // 7
+
+        // 16バイトを超えるキャプチャはコンパイルエラーになる
+        // double d1{}, d2{}, d3{};
+        // b.on_click([d1, d2, d3](int) {}); // error: static assertion failed: inplace_function: キャプチャが大きすぎる
+
+        cout << "sizeof(std::function<void(int)>)       : " << sizeof(std::function<void(int)>) << endl;
+        cout << "sizeof(inplace_function<void(int), 16>) : " << sizeof(inplace_function<void(int), 16>) << endl;
+        cout << "sizeof(function_ref<void(int)>)         : " << sizeof(function_ref<void(int)>) << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        cout << "call (" << iterations << " times)" << endl;
+        int k = 3;
+        auto lambda = [k](int x)
+        { return x * k; };
+
+        std::function<int(int)> sf = lambda;
+        inplace_function<int(int), 16> ipf = lambda;
+        function_ref<int(int)> fr = lambda;
+
+        double t;
+        // ラムダを直接渡すとインライン展開され、ループごと合計の式に置き換わることがある(ほぼ0 ns)
+        t = bench::best_of(5, [&]
+                           { bench::do_not_optimize(call_n(lambda, iterations)); });
+        bench::report_ns("raw lambda", t, iterations);
+        t = bench::best_of(5, [&]
+                           { bench::do_not_optimize(call_n(sf, iterations)); });
+        bench::report_ns("std::function", t, iterations);
+        t = bench::best_of(5, [&]
+                           { bench::do_not_optimize(call_n(ipf, iterations)); });
+        bench::report_ns("inplace_function", t, iterations);
+        t = bench::best_of(5, [&]
+                           { bench::do_not_optimize(call_n(fr, iterations)); });
+        bench::report_ns("function_ref", t, iterations);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        cout << "construct + call (" << iterations << " times, 24-byte capture)" << endl;
+        auto run = [](auto construct)
+        {
+            return bench::best_of(5, [&]
+                                  {
+                for (int i = 0; i < iterations; i++)
+                    bench::do_not_optimize(construct(i, 2, 3, 4)); });
+        };
+        double t;
+        t = run([](int a, int b, int c, int d)
+                { int sum = 0; const int *p = &sum; auto w = [a, b, c, d, p](int x) { return a + b + c + d + x + (p != nullptr); }; return w(1); });
+        bench::report_ns("raw lambda", t, iterations);
+        t = run(construct_and_call<std::function<int(int)>>);
+        bench::report_ns("std::function (heap allocation)", t, iterations);
+        t = run(construct_and_call<inplace_function<int(int), 32>>);
+        bench::report_ns("inplace_function", t, iterations);
+    }
+}
+
+// Q1: inplace_functionの容量はどう決める？
+//   -> 実際に渡すラムダのキャプチャの大きさに合わせる。足りなければコンパイルエラーで分かる
+// Q2: function_refをメンバ変数に持っていい？
+//   -> 参照先のラムダより長生きしないことが保証できる場合だけ。基本は引数専用
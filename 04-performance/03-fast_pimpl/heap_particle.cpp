@@ -0,0 +1,49 @@
+/// 比較用: unique_ptr版のPimpl(実装)
+#include "heap_particle.h"
+
+class heap_particle::impl
+{
+public:
+    impl(std::string_view label, double x, double y)
+        : label_(label), x_(x), y_(y) {}
+
+    std::string label_;
+    double x_;
+    double y_;
+};
+
+heap_particle::heap_particle(std::string_view label, double x, double y)
+    : pimpl_(std::make_unique<impl>(label, x, y))
+{
+}
+
+heap_particle::~heap_particle() = default;
+
+// unique_ptrはコピーできないので中身を複製する
+heap_particle::heap_particle(const heap_particle &other)
+    : pimpl_(std::make_unique<impl>(*other.pimpl_))
+{
+}
+
+heap_particle::heap_particle(heap_particle &&other) noexcept = default;
+
+heap_particle &heap_particle::operator=(const heap_particle &other)
+{
+    if (pimpl_)
+        *pimpl_ = *other.pimpl_;
+    else // ムーブ後の空の状態から代入される場合
+        pimpl_ = std::make_unique<impl>(*other.pimpl_);
+    return *this;
+}
+
+heap_particle &heap_particle::operator=(heap_particle &&other) noexcept = default;
+
+const std::string &heap_particle::label() const noexcept { return pimpl_->label_; }
+double heap_particle::x() const noexcept { return pimpl_->x_; }
+double heap_particle::y() const noexcept { return pimpl_->y_; }
+
+void heap_particle::move_by(double dx, double dy) noexcept
+{
+    pimpl_->x_ += dx;
+    pimpl_->y_ += dy;
+}
@@ -0,0 +1,27 @@
+/// 比較用: 03-technique/05-pimpl.md と同じunique_ptr版のPimpl(ヘッダ)
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+class heap_particle
+{
+public:
+    heap_particle(std::string_view label, double x, double y);
+
+    ~heap_particle();
+    heap_particle(const heap_particle &other);
+    heap_particle(heap_particle &&other) noexcept;
+    heap_particle &operator=(const heap_particle &other);
+    heap_particle &operator=(heap_particle &&other) noexcept;
+
+    const std::string &label() const noexcept;
+    double x() const noexcept;
+    double y() const noexcept;
+    void move_by(double dx, double dy) noexcept;
+
+private:
+    class impl;
+    std::unique_ptr<impl> pimpl_;
+};
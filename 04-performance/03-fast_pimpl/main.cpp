@@ -0,0 +1,74 @@
+/// Fast Pimplとunique_ptr版Pimplの比較
+// * ビルド: g++ -std=c++20 -O2 -march=native main.cpp particle.cpp heap_particle.cpp
+// * どちらもヘッダから実装クラスの定義を隠している点は同じ。違いはメモリ配置だけ
+//   - heap_particle: [unique_ptr] → ヒープ上の[impl]
+//   - particle     : [impl]がオブジェクトの中に直接入っている
+
+#include "../bench.h"
+#include "heap_particle.h"
+#include "particle.h"
+
+#include <iostream>
+#include <vector>
+
+constexpr int count = 1'000'000;
+
+template <class Particle>
+void run_benchmark(const char *name)
+{
+    std::vector<Particle> v;
+    v.reserve(count);
+
+    std::cout << name << " (sizeof: " << sizeof(Particle) << ")" << std::endl;
+
+    double t = bench::best_of(3, [&]
+                              {
+        v.clear();
+        for (int i = 0; i < count; i++)
+            v.emplace_back("p", i, -i); });
+    bench::report_ns("construct", t, count);
+
+    t = bench::best_of(5, [&]
+                       {
+        double sum = 0;
+        for (const auto &p : v)
+            sum += p.x() + p.y();
+        bench::do_not_optimize(sum); });
+    bench::report_ns("access", t, count);
+
+    t = bench::best_of(5, [&]
+                       {
+        for (auto &p : v)
+            p.move_by(1.0, 2.0);
+        bench::clobber_memory(); });
+    bench::report_ns("modify", t, count);
+
+    t = bench::best_of(3, [&]
+                       {
+        auto copy = v;
+        bench::do_not_optimize(copy.data()); });
+    bench::report_ns("copy (incl. destruct)", t, count);
+}
+
+int main()
+{
+    using namespace std;
+    {
+        // 使い方はどちらも同じ
+        particle a{"a", 1.0, 2.0};
+        particle b = a;    // コピー
+        b.move_by(0.5, 0.5);
+        particle c = std::move(b); // ムーブ
+        cout << a.label() << ": " << a.x() << ", " << a.y() << endl; // a: 1, 2
+        cout << c.label() << ": " << c.x() << ", " << c.y() << endl; // a: 1.5, 2.5
+    }
+    cout << "-------------------------------------" << endl;
+    run_benchmark<heap_particle>("heap_particle (unique_ptr pimpl)");
+    run_benchmark<particle>("particle (fast pimpl)");
+}
+
+// Q1: Fast Pimplの欠点は？
+//   -> 実装クラスの大きさが変わるとヘッダの数値を直す必要がある(=ヘッダを使う側の再コンパイルが必要)。
+//      ただし数値を直し忘れてもstatic_assertで必ず気付ける
+// Q2: 大きさを多めに確保しておけば直さなくて済むのでは？
+//   -> それもできるが、ここでは無駄を見逃さないよう一致を要求している
@@ -0,0 +1,35 @@
+/// Fast Pimpl版のクラス(実装)
+#include "particle.h"
+
+class particle::impl
+{
+public:
+    impl(std::string_view label, double x, double y)
+        : label_(label), x_(x), y_(y) {}
+
+    std::string label_;
+    double x_;
+    double y_;
+};
+
+particle::particle(std::string_view label, double x, double y)
+    : pimpl_(label, x, y)
+{
+}
+
+// 中身はfast_pimplに任せるが、定義はimplが見えるここに書く必要がある
+particle::~particle() = default;
+particle::particle(const particle &other) = default;
+particle::particle(particle &&other) noexcept = default;
+particle &particle::operator=(const particle &other) = default;
+particle &particle::operator=(particle &&other) noexcept = default;
+
+const std::string &particle::label() const noexcept { return pimpl_->label_; }
+double particle::x() const noexcept { return pimpl_->x_; }
+double particle::y() const noexcept { return pimpl_->y_; }
+
+void particle::move_by(double dx, double dy) noexcept
+{
+    pimpl_->x_ += dx;
+    pimpl_->y_ += dy;
+}
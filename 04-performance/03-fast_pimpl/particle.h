@@ -0,0 +1,37 @@
+/// Fast Pimpl版のクラス(ヘッダ)
+// * 実装クラスparticle::implの中身はparticle.cppにしかない
+// * ヘッダに書くのは大きさとアラインメントの数値だけ
+#pragma once
+
+#include "../fast_pimpl.h"
+
+#include <string>
+#include <string_view>
+
+class particle
+{
+public:
+    particle(std::string_view label, double x, double y);
+
+    // 特殊メンバ関数は実装クラスの定義が見えるparticle.cppで定義する
+    ~particle();
+    particle(const particle &other);
+    particle(particle &&other) noexcept;
+    particle &operator=(const particle &other);
+    particle &operator=(particle &&other) noexcept;
+
+    const std::string &label() const noexcept;
+    double x() const noexcept;
+    double y() const noexcept;
+    void move_by(double dx, double dy) noexcept;
+
+private:
+    class impl;
+    // sizeof(impl), alignof(impl)と一致している必要がある(違うとparticle.cppのコンパイルでエラー)
+    // libstdc++/MSVCではstd::stringが32バイトなので48。libc++では24バイトなので40になる
+#if defined(_LIBCPP_VERSION)
+    fast_pimpl<impl, 40, 8> pimpl_;
+#else
+    fast_pimpl<impl, 48, 8> pimpl_;
+#endif
+};
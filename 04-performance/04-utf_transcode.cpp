@@ -0,0 +1,147 @@
+/// UTF-8/16/32の相互変換
+// * 02-advanced/03-character-2.cpp では std::u8string / std::u16string / std::u32string を並べただけで、
+//   相互に変換する方法がなかった(codecvtは非推奨)。utf_transcode.h でそれを補う
+// * ビルド: g++ -std=c++20 -O2 -march=native 04-utf_transcode.cpp
+
+#include "bench.h"
+#include "utf_transcode.h"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// @brief ベンチマーク用の文章を作る。ascii_ratioはASCII文字の割合(0～100)
+std::u8string make_corpus(std::size_t bytes, int ascii_ratio)
+{
+    const std::u8string ascii = u8"The quick brown fox jumps over the lazy dog. ";
+    const std::u8string japanese = u8"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。";
+    std::u8string s;
+    s.reserve(bytes + 256);
+    unsigned seed = 1;
+    while (s.size() < bytes)
+    {
+        seed = seed * 1103515245 + 12345;
+        s += ((seed >> 16) % 100 < static_cast<unsigned>(ascii_ratio)) ? ascii : japanese;
+    }
+    return s;
+}
+
+template <class In, class Out, class Fast, class Scalar>
+void bench_direction(const char *name, std::span<const In> in, std::size_t out_capacity, Fast fast, Scalar scalar)
+{
+    std::vector<Out> out_fast(out_capacity), out_scalar(out_capacity);
+    const auto r1 = fast(in, std::span<Out>(out_fast));
+    const auto r2 = scalar(in, std::span<Out>(out_scalar));
+    // SIMD版とスカラー版の結果が一致することを確認しておく
+    assert(r1.ec == utf::status::ok && r2.ec == utf::status::ok && r1.written == r2.written);
+    assert(std::equal(out_fast.begin(), out_fast.begin() + r1.written, out_scalar.begin()));
+
+    const double bytes = static_cast<double>(in.size_bytes());
+    std::printf(" %s\n", name);
+    bench::report_gbps("scalar", bench::best_of(5, [&]
+                                                { bench::do_not_optimize(scalar(in, std::span<Out>(out_scalar))); }),
+                       bytes);
+    bench::report_gbps("simd", bench::best_of(5, [&]
+                                              { bench::do_not_optimize(fast(in, std::span<Out>(out_fast))); }),
+                       bytes);
+}
+
+void run_benchmark(const char *title, const std::u8string &u8)
+{
+    std::cout << title << " (" << u8.size() / (1024 * 1024) << " MiB of UTF-8)" << std::endl;
+    const auto u16 = utf::to_u16string(std::u8string_view(u8));
+    const auto u32 = utf::to_u32string(std::u8string_view(u8));
+    std::span<const char8_t> s8(u8);
+    std::span<const char16_t> s16(u16);
+    std::span<const char32_t> s32(u32);
+
+    std::printf(" validate utf-8\n");
+    const double bytes = static_cast<double>(u8.size());
+    bench::report_gbps("scalar", bench::best_of(5, [&]
+                                                { bench::do_not_optimize(utf::scalar::validate_utf8(s8)); }),
+                       bytes);
+    bench::report_gbps("simd", bench::best_of(5, [&]
+                                              { bench::do_not_optimize(utf::validate_utf8(s8)); }),
+                       bytes);
+
+    bench_direction<char8_t, char16_t>("utf-8  -> utf-16", s8, u8.size(),
+                                       utf::utf8_to_utf16, utf::scalar::utf8_to_utf16);
+    bench_direction<char8_t, char32_t>("utf-8  -> utf-32", s8, u8.size(),
+                                       utf::utf8_to_utf32, utf::scalar::utf8_to_utf32);
+    bench_direction<char16_t, char8_t>("utf-16 -> utf-8", s16, utf::max_utf8_length(u16.size()),
+                                       utf::utf16_to_utf8, utf::scalar::utf16_to_utf8);
+    bench_direction<char16_t, char32_t>("utf-16 -> utf-32", s16, u16.size(),
+                                        utf::utf16_to_utf32, utf::scalar::utf16_to_utf32);
+    bench_direction<char32_t, char8_t>("utf-32 -> utf-8", s32, utf::max_utf8_length(u32.size()),
+                                       utf::utf32_to_utf8, utf::scalar::utf32_to_utf8);
+    bench_direction<char32_t, char16_t>("utf-32 -> utf-16", s32, utf::max_utf16_length(u32.size()),
+                                        utf::utf32_to_utf16, utf::scalar::utf32_to_utf16);
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 03-character-2.cpp と同じ文字列を相互に変換する
+        u8string u8s = u8"abcdあいうえお🍣";
+        u16string u16s = utf::to_u16string(u8string_view(u8s));
+        u32string u32s = utf::to_u32string(u8string_view(u8s));
+        cout << "u8 size: " << u8s.size() << ", u16 size: " << u16s.size() << ", u32 size: " << u32s.size() << endl;
+        // u8 size: 23, u16 size: 11(🍣はサロゲートペア), u32 size: 10
+        assert(u16s == u"abcdあいうえお🍣");
+        assert(u32s == U"abcdあいうえお🍣");
+        assert(utf::to_u8string(u16string_view(u16s)) == u8s);
+        assert(utf::to_u16string(u32string_view(u32s)) == u16s);
+        assert(utf::to_u32string(u16string_view(u16s)) == u32s);
+        assert(utf::to_u8string(u32string_view(u32s)) == u8s);
+
+        // バッファを自分で用意する場合(メモリ確保なし)
+        char16_t buffer[64];
+        auto r = utf::utf8_to_utf16(u8s, buffer);
+        cout << "read: " << r.read << ", written: " << r.written << endl; // read: 23, written: 11
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 不正なシーケンスの検出
+        auto check = [](const char *name, std::u8string_view s, utf::status expected)
+        {
+            const auto r = utf::validate_utf8(std::span<const char8_t>(s.data(), s.size()));
+            const auto r2 = utf::scalar::validate_utf8(std::span<const char8_t>(s.data(), s.size()));
+            assert(r.ec == expected && r2.ec == expected && r.read == r2.read);
+            cout << name << ": error at " << r.read << endl;
+        };
+        check("overlong '/'      ", u8"abc\xC0\xAF", utf::status::invalid_sequence);
+        check("surrogate U+D800  ", u8"abc\xED\xA0\x80", utf::status::surrogate);
+        check("over U+10FFFF     ", u8"abc\xF4\x90\x80\x80", utf::status::invalid_sequence);
+        check("truncated         ", u8"abcあ\xE3\x81", utf::status::truncated);
+        check("stray continuation", u8"0123456789abcdef0123456789abcdef\x80", utf::status::invalid_sequence);
+
+        const char16_t lone[] = {u'a', 0xDC00, u'b'};
+        char8_t out[16];
+        auto r = utf::utf16_to_utf8(lone, out);
+        assert(r.ec == utf::status::surrogate && r.read == 1);
+
+        // 出力が足りない場合は、書けたところまでで止まる
+        char16_t small[3];
+        r = utf::utf8_to_utf16(std::u8string_view(u8"abcdあいうえお"), small);
+        assert(r.ec == utf::status::output_full && r.read == 3 && r.written == 3);
+        cout << "all checks passed" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        constexpr std::size_t size = 16 * 1024 * 1024;
+        run_benchmark("ASCII 100%", make_corpus(size, 100));
+        run_benchmark("ASCII 90% + Japanese 10%", make_corpus(size, 90));
+        run_benchmark("Japanese 100%", make_corpus(size, 0));
+    }
+}
+
+// Q1: 日本語だけの文章ではSIMD版が速くならないのはなぜ？
+//   -> SIMDで処理しているのはASCIIの連続(UTF-16/32同士ではサロゲートを含まない連続)だけのため。
+//      UTF-16⇔UTF-32はほとんどの日本語がBMP内なので速くなる
+// Q2: wstringとの変換は？
+//   -> wchar_tの大きさが環境で違う(Windowsは2、macOS/Linuxは4)ので、
+//      reinterpret_castせずchar16_t/char32_tの配列にコピーしてから使う
@@ -0,0 +1,126 @@
+/// 大きなバイナリの16進ダンプ
+// * 02-advanced/03-character-2.cpp の dump() と同じことを、メモリ確保なしで高速に行う
+// * ビルド: g++ -std=c++20 -O2 -march=native 05-hexdump.cpp
+// * 使い方: ./a.out [ファイル名]  (ファイル名を指定するとそのファイルをダンプする)
+
+#include "bench.h"
+#include "hexdump.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// @brief 比較用: 03-character-2.cpp の dump() と同じやり方(1バイトずつiostreamへ)
+void dump_iostream(std::ostream &os, std::span<const std::byte> data)
+{
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        os << " " << std::setfill('0') << std::setw(2) << std::hex << std::to_integer<int>(data[i]);
+        if (i % 16 == 15)
+            os << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    if (argc > 1)
+    {
+        // 指定されたファイルを少しずつ読みながら標準出力へダンプする
+        return hexdump::dump_file(argv[1], STDOUT_FILENO) ? 0 : 1;
+    }
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 03-character-2.cpp の文字列をダンプする
+        u8string u8s = u8"abcdあいうえお";
+        u32string u32s = U"abcdあいうえお";
+        char out[hexdump::required_size(64)];
+
+        auto n = hexdump::format(as_bytes(span(u8s)), out);
+        cout << "std::u8string" << endl
+             << string_view(out, n);
+        n = hexdump::format(as_bytes(span(u32s)), out);
+        cout << "std::u32string" << endl
+             << string_view(out, n);
+        n = hexdump::format(as_bytes(span(u8s)), out, 0, {.offset = false, .ascii = false});
+        cout << "std::u8string (no gutters)" << endl
+             << string_view(out, n);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // SIMD版とスカラー版で結果が一致することを確認する(端数の行も含めて)
+        vector<std::byte> data(1000);
+        mt19937 rng{1};
+        for (auto &b : data)
+            b = static_cast<std::byte>(rng());
+        vector<char> a(hexdump::required_size(data.size())), b(a.size());
+        for (auto opt : {hexdump::options{true, true}, hexdump::options{false, false}, hexdump::options{true, false}})
+        {
+            for (std::size_t len : {0, 1, 8, 9, 16, 17, 999, 1000})
+            {
+                auto sub = span<const std::byte>(data).first(len);
+                auto na = hexdump::format(sub, a, 0, opt, true);
+                auto nb = hexdump::format(sub, b, 0, opt, false);
+                assert(na == nb && equal(a.begin(), a.begin() + na, b.begin()));
+            }
+        }
+        cout << "simd == scalar: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 速度比較
+        constexpr std::size_t size = 32 * 1024 * 1024;
+        vector<std::byte> data(size);
+        mt19937 rng{2};
+        for (auto &b : data)
+            b = static_cast<std::byte>(rng());
+        vector<char> out(hexdump::required_size(size));
+
+        auto report = [](const char *name, double sec, double bytes)
+        { printf("  %-40s %10.1f MB/s\n", name, bytes / sec / 1e6); };
+
+        {
+            // iostream版は遅いので1/8の大きさで測る
+            auto part = span<const std::byte>(data).first(size / 8);
+            double t = bench::best_of(3, [&]
+                                      {
+                ostringstream os;
+                dump_iostream(os, part);
+                bench::do_not_optimize(os.tellp()); });
+            report("iostream (like 03-character-2.cpp)", t, part.size());
+        }
+        double t = bench::best_of(5, [&]
+                                  { bench::do_not_optimize(hexdump::format(data, out, 0, {}, false)); });
+        report("hexdump::format (scalar)", t, size);
+        t = bench::best_of(5, [&]
+                           { bench::do_not_optimize(hexdump::format(data, out, 0, {}, true)); });
+        report("hexdump::format (simd)", t, size);
+
+        // ファイルから読みながら/dev/nullへ書き出す
+        const char *path = "hexdump_bench.bin";
+        if (FILE *fp = fopen(path, "wb"))
+        {
+            fwrite(data.data(), 1, data.size(), fp);
+            fclose(fp);
+            const int null_fd = ::open("/dev/null", O_WRONLY);
+            t = bench::best_of(3, [&]
+                               { bench::do_not_optimize(hexdump::dump_file(path, null_fd)); });
+            report("hexdump::dump_file -> /dev/null", t, size);
+            ::close(null_fd);
+            remove(path);
+        }
+    }
+}
+
+// Q1: 元のdump()はどこが遅い？
+//   -> 1バイトごとにoperator<<を4回呼び、setfill/setw/hexの書式状態を毎回たどる。
+//      さらにstd::endlは毎行flushする。ここでは行を配列に組み立ててから、まとめて書き出している
+// Q2: SSSE3が使えない環境では？
+//   -> 256要素の表(0x00→"00"…0xff→"ff")を引くスカラー版になる。それでもiostreamよりずっと速い
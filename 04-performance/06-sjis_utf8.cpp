@@ -0,0 +1,172 @@
+/// Shift_JIS(CP932) ⇄ UTF-8 の変換
+// * 02-advanced/03-character-2.cpp のコメントにある「SJISだと14バイト、UTF-8だと19バイト」を実際に変換して確かめる
+// * 古いシステムから届くShift_JISのデータを、少しずつ(チャンク単位で)UTF-8へ変換する
+// * ビルド: g++ -std=c++20 -O2 -march=native 06-sjis_utf8.cpp
+// * 表を作り直すとき: python3 gen_sjis_table.py > sjis_table.h
+
+#include "bench.h"
+#include "sjis.h"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if __has_include(<iconv.h>)
+#include <iconv.h>
+#define HAS_ICONV 1
+#endif
+
+/// @brief 一度に全部変換する(出力は最大サイズで確保しておく)
+std::u8string to_utf8(std::string_view sjis, sjis::error_policy policy = sjis::error_policy::replace)
+{
+    std::u8string out(sjis::max_utf8_length(sjis.size()), u8'\0');
+    sjis::decoder d{policy};
+    const auto r = d.convert(sjis, out, true);
+    out.resize(r.ec == sjis::status::ok ? r.written : 0);
+    return out;
+}
+
+std::string to_sjis(std::u8string_view utf8, sjis::error_policy policy = sjis::error_policy::replace)
+{
+    std::string out(sjis::max_sjis_length(utf8.size()), '\0');
+    sjis::encoder e{policy};
+    const auto r = e.convert(utf8, out, true);
+    out.resize(r.ec == sjis::status::ok ? r.written : 0);
+    return out;
+}
+
+/// @brief 1バイトずつ渡して変換する(チャンクの境界で文字が切れても結果が変わらないことの確認用)
+template <class Converter, class Out, class In>
+std::basic_string<Out> convert_bytewise(std::basic_string_view<In> in)
+{
+    Converter c;
+    std::basic_string<Out> out;
+    Out buffer[8];
+    for (std::size_t i = 0; i <= in.size(); i++)
+    {
+        const bool last = i == in.size();
+        const auto r = c.convert(in.substr(i, last ? 0 : 1), buffer, last);
+        assert(r.ec == sjis::status::ok);
+        out.append(buffer, r.written);
+    }
+    return out;
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        const u8string u8s = u8"abcdあいうえお";
+        const string s = to_sjis(u8s);
+        cout << "utf-8: " << u8s.size() << " bytes, shift_jis: " << s.size() << " bytes" << endl; // 19, 14
+        assert(to_utf8(s) == u8s);
+
+        // 機種依存文字(NEC特殊文字、IBM拡張文字)や半角カナも往復できる
+        const u8string ext = u8"①㈱№Ⅹⅹ髙﨑ｱｲｳｴｵ";
+        assert(to_utf8(to_sjis(ext)) == ext);
+
+        // WAVE DASH(U+301C)はCP932では0x8160(FULLWIDTH TILDE U+FF5E)になる
+        assert(to_utf8(to_sjis(u8"〜")) == u8"～");
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // エラーの扱い
+        const string broken = "abc\x82"       // 2バイト文字の途中で終わる
+                              "\x82\xa0"      // あ
+                              "\xff"          // 不正なバイト
+                              "\x81\x20xyz";  // 2バイト目が不正(ASCIIなので読み直す)
+        const auto replaced = to_utf8(broken.substr(4));
+        assert(replaced == u8"あ�� xyz");
+        cout << "replace: " << string_view(reinterpret_cast<const char *>(replaced.data()), replaced.size()) << endl;
+
+        sjis::decoder strict{sjis::error_policy::strict};
+        char8_t out[64];
+        auto r = strict.convert(broken.substr(4), out, true);
+        cout << "strict : error at " << r.read << endl; // 2 (0xffの位置)
+        assert(r.ec == sjis::status::invalid_sequence && r.read == 2);
+
+        // Shift_JISにない文字
+        assert(to_sjis(u8"寿司🍣") == "\x8e\xf5\x8e\x69?");
+        sjis::encoder strict_e{sjis::error_policy::strict};
+        char sjis_out[64];
+        const u8string_view sushi = u8"寿司🍣";
+        auto r2 = strict_e.convert(sushi, sjis_out, true);
+        assert(r2.ec == sjis::status::unmappable && r2.read == 6 && r2.written == 4);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 1バイトずつ渡しても、まとめて渡した場合と結果が同じになる
+        const u8string text = u8"ASCII 混在テキスト｡ｶﾀｶﾅ①\xE3\x81 broken \xF0\x9F\x8D\xA3 end\xE3";
+        const string s = to_sjis(text);
+        assert((convert_bytewise<sjis::encoder, char>(u8string_view(text)) == s));
+        assert((convert_bytewise<sjis::decoder, char8_t>(string_view(s)) == to_utf8(s)));
+        const string broken = "\x82\xa0\x82\x20\xff\x81";
+        assert((convert_bytewise<sjis::decoder, char8_t>(string_view(broken)) == to_utf8(broken)));
+        cout << "streaming == one-shot: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 大きな日本語の文章で速度を測る(64KiBずつ変換する)
+        const u8string paragraph =
+            u8"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。"
+            u8"何でも薄暗いじめじめした所でニャーニャー泣いていた事だけは記憶している。"
+            u8"吾輩はここで始めて人間というものを見た。(Natsume Soseki, 1905)\n";
+        u8string corpus;
+        while (corpus.size() < 64 * 1024 * 1024)
+            corpus += paragraph;
+        const string sjis_corpus = to_sjis(corpus);
+        assert(to_utf8(sjis_corpus) == corpus);
+
+        constexpr std::size_t chunk = 64 * 1024;
+        vector<char8_t> u8buf(sjis::max_utf8_length(chunk));
+        vector<char> sjbuf(sjis::max_sjis_length(chunk));
+
+        cout << "shift_jis corpus: " << sjis_corpus.size() / (1024 * 1024) << " MiB" << endl;
+        double t = bench::best_of(3, [&]
+                                  {
+            sjis::decoder d;
+            for (std::size_t i = 0; i < sjis_corpus.size(); i += chunk)
+            {
+                auto part = string_view(sjis_corpus).substr(i, chunk);
+                bench::do_not_optimize(d.convert(part, u8buf, i + chunk >= sjis_corpus.size()));
+            } });
+        bench::report_gbps("shift_jis -> utf-8", t, sjis_corpus.size());
+        t = bench::best_of(3, [&]
+                           {
+            sjis::encoder e;
+            for (std::size_t i = 0; i < corpus.size(); i += chunk)
+            {
+                auto part = u8string_view(corpus).substr(i, chunk);
+                bench::do_not_optimize(e.convert(part, sjbuf, i + chunk >= corpus.size()));
+            } });
+        bench::report_gbps("utf-8 -> shift_jis (per utf-8 byte)", t, corpus.size());
+
+#if defined(HAS_ICONV)
+        // 比較: iconv(glibcなど)
+        if (iconv_t cd = iconv_open("UTF-8", "CP932"); cd != reinterpret_cast<iconv_t>(-1))
+        {
+            t = bench::best_of(3, [&]
+                               {
+                for (std::size_t i = 0; i < sjis_corpus.size(); i += chunk)
+                {
+                    char *src = const_cast<char *>(sjis_corpus.data() + i);
+                    std::size_t src_left = std::min(chunk, sjis_corpus.size() - i);
+                    char *dst = reinterpret_cast<char *>(u8buf.data());
+                    std::size_t dst_left = u8buf.size();
+                    iconv(cd, &src, &src_left, &dst, &dst_left); // 2バイト文字が境界で切れた分は簡単のため無視
+                } });
+            bench::report_gbps("iconv shift_jis -> utf-8", t, sjis_corpus.size());
+            iconv_close(cd);
+        }
+#endif
+    }
+}
+
+// Q1: 逆引き表(UTF-8→Shift_JIS)をソースに書かないのはなぜ？
+//   -> 順引き表からconstexprのコンストラクタで作れるため。実行時の初期化コストもない
+// Q2: 同じ文字が複数のコードにある場合はどれになる？
+//   -> Windows(WideCharToMultiByte)と同じく、NEC特殊文字(0x87xx)とIBM拡張文字(0xFAxx～)を優先し、
+//      NEC選定IBM拡張文字(0xED/0xEExx)は使わない
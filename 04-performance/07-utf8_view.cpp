@@ -0,0 +1,172 @@
+/// UTF-8文字列の文字数と「n文字目」
+// * 02-advanced/03-character-2.cpp のとおり u8string::size() はバイト数なので、文字数や文字単位の位置は
+//   別に数える必要がある。utf8_view.h でそれをSIMDで速く行う
+// * ビルド: g++ -std=c++20 -O2 -march=native 07-utf8_view.cpp
+
+#include "bench.h"
+#include "utf8_view.h"
+#include "utf_transcode.h"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// @brief ベンチマーク用の文章を作る。ascii_ratioはASCII文字の割合(0～100)
+std::u8string make_corpus(std::size_t bytes, int ascii_ratio)
+{
+    const std::u8string ascii = u8"The quick brown fox jumps over the lazy dog. ";
+    const std::u8string japanese = u8"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。";
+    std::u8string s;
+    s.reserve(bytes + 256);
+    unsigned seed = 1;
+    while (s.size() < bytes)
+    {
+        seed = seed * 1103515245 + 12345;
+        s += ((seed >> 16) % 100 < static_cast<unsigned>(ascii_ratio)) ? ascii : japanese;
+    }
+    return s;
+}
+
+void run_benchmark(const char *title, const std::u8string &text)
+{
+    std::cout << title << " (" << text.size() / (1024 * 1024) << " MiB of UTF-8)" << std::endl;
+    const std::u8string_view sv(text);
+    const double bytes = static_cast<double>(text.size());
+    assert(utf::count_code_points(sv, true) == utf::count_code_points(sv, false));
+
+    std::printf(" count code points\n");
+    bench::report_gbps("scalar", bench::best_of(5, [&]
+                                                { bench::do_not_optimize(utf::count_code_points(sv, false)); }),
+                       bytes);
+    bench::report_gbps("simd", bench::best_of(5, [&]
+                                              { bench::do_not_optimize(utf::count_code_points(sv, true)); }),
+                       bytes);
+
+    // ランダムな文字位置のバイト位置を求める
+    const utf::utf8_view view(sv);
+    const std::size_t chars = view.size();
+    std::vector<std::size_t> positions(200);
+    std::mt19937_64 rng(42);
+    for (auto &p : positions)
+        p = rng() % chars;
+
+    std::printf(" seek to random character (%zu seeks)\n", positions.size());
+    auto seek_scalar = [&]
+    {
+        for (auto p : positions)
+        {
+            std::size_t remain;
+            bench::do_not_optimize(utf::detail::find_char(sv.data(), sv.size(), p, remain, false));
+        }
+    };
+    auto seek_simd = [&]
+    {
+        for (auto p : positions)
+            bench::do_not_optimize(view.byte_offset(p));
+    };
+    bench::report_ns("scalar scan", bench::best_of(3, seek_scalar), static_cast<double>(positions.size()));
+    bench::report_ns("simd scan", bench::best_of(3, seek_simd), static_cast<double>(positions.size()));
+    for (std::size_t stride : {64, 256, 4096})
+    {
+        const utf::utf8_index index(view, stride);
+        for (auto p : positions)
+            assert(index.byte_offset(p) == view.byte_offset(p));
+        char name[64];
+        std::snprintf(name, sizeof(name), "index (stride %zu, %zu KiB)", stride, index.memory_usage() / 1024);
+        bench::report_ns(name, bench::best_of(5, [&]
+                                              {
+                                                  for (auto p : positions)
+                                                      bench::do_not_optimize(index.byte_offset(p)); }),
+                         static_cast<double>(positions.size()));
+    }
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 03-character-2.cpp と同じ文字列
+        u8string u8s = u8"abcdあいうえお";
+        utf::utf8_view v(u8s);
+        cout << "bytes: " << v.size_bytes() << ", characters: " << v.size() << endl; // bytes: 19, characters: 9
+        assert(v.size_bytes() == 19 && v.size() == 9);
+
+        // 文字単位の部分文字列
+        assert(v.substr(4, 2).bytes() == u8"あい");
+        assert(v.substr(6).bytes() == u8"うえお");
+        assert(v.byte_offset(5) == 7);
+        assert(v.byte_offset(100) == v.size_bytes());
+
+        // バイト数の上限で切り詰めても文字の途中では切れない
+        assert(v.truncate_bytes(8).bytes() == u8"abcdあ"); // "い"の2バイト目までは入らない
+        assert(v.truncate_bytes(10).bytes() == u8"abcdあい");
+        assert(v.truncate_chars(5).bytes() == u8"abcdあ");
+        for (std::size_t n = 0; n <= u8s.size(); n++)
+        {
+            auto t = v.truncate_bytes(n).bytes();
+            assert(t.size() <= n && utf::validate_utf8(std::span<const char8_t>(t.data(), t.size())).ec == utf::status::ok);
+        }
+        cout << "truncate to 8 bytes: " << v.truncate_bytes(8).size() << " characters" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 索引を使った検索が索引なしと一致するか、長い文字列で確認する
+        const auto text = make_corpus(100000, 50);
+        const utf::utf8_view v(text);
+        const auto chars = v.size();
+        const utf::utf8_index index(v, 64);
+        assert(index.size() == chars);
+        for (std::size_t i = 0; i <= chars + 1; i += 7)
+            assert(index.byte_offset(i) == v.byte_offset(i));
+        assert(index.byte_offset(chars) == text.size());
+        assert(index.substr(100, 50).bytes() == v.substr(100, 50).bytes());
+        assert(index.substr(chars - 3, 10).bytes() == v.substr(chars - 3).bytes());
+        bool rejected = false;
+        try
+        {
+            const utf::utf8_index zero(v, 0);
+        }
+        catch (const std::invalid_argument &)
+        {
+            rejected = true;
+        }
+        assert(rejected); // strideが0の索引は作れない
+
+        // 0xBF(符号付きで-65)で終わる続きのバイトを含む文字列(み = E3 81 BF, ¿ = C2 BF)。SIMDのループに入る長さにする
+        std::u8string bf;
+        for (int i = 0; i < 40; i++)
+            bf += u8"み¿";
+        const std::u8string_view sv = bf;
+        for (std::size_t len = 0; len <= sv.size(); len++)
+            assert(utf::count_code_points(sv.substr(0, len)) == utf::count_code_points(sv.substr(0, len), false));
+        for (std::size_t i = 0; i <= 81; i++)
+        {
+            std::size_t r1, r2;
+            assert(utf::detail::find_char(sv.data(), sv.size(), i, r1) == utf::detail::find_char(sv.data(), sv.size(), i, r2, false) && r1 == r2);
+        }
+        const utf::utf8_view bv(bf);
+        assert(bv.size() == 80 && bv.byte_offset(10) == 25 && bv.substr(79).bytes() == u8"¿");
+        const utf::utf8_index bi(bv, 3);
+        for (std::size_t i = 0; i <= 80; i++)
+            assert(bi.byte_offset(i) == (i / 2) * 5 + (i % 2) * 3);
+        cout << chars << " characters, all checks passed" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        constexpr std::size_t size = 16 * 1024 * 1024;
+        run_benchmark("ASCII 90% + Japanese 10%", make_corpus(size, 90));
+        run_benchmark("Japanese 100%", make_corpus(size, 0));
+    }
+}
+
+// Q1: 索引のstrideはどう決める？
+//   -> 索引の大きさ(文字数/stride個のsize_t)と、検索ごとに数える量(最大stride文字)の釣り合いで決める。
+//      SIMDで数えるなら数百文字を数えても数十ns程度なので、256前後で十分なことが多い
+// Q2: 文字数は「見た目の文字数」と一致する？
+//   -> 一致しない。コードポイント数なので、結合文字や絵文字の異体字セレクタ・ZWJシーケンスは
+//      複数に数えられる(書記素クラスタ単位で数えるにはUnicodeの規則表が必要)
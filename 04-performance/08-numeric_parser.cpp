@@ -0,0 +1,118 @@
+/// 大きな数値ファイルの並列解析
+// * 05-tips/03-str_to_value.cpp の std::from_chars を、mmapしたファイル全体に並列で使う
+// * ビルド: g++ -std=c++20 -O2 -march=native -pthread 08-numeric_parser.cpp
+// * 使い方: ./a.out [MiB]  (ベンチマーク用に作るファイルの大きさ。省略時は128)
+
+#include "bench.h"
+#include "numeric_parser.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+/// @brief 「整数,小数,整数」の3列のCSVを作る
+void write_csv(const char *path, std::size_t bytes)
+{
+    std::FILE *fp = std::fopen(path, "wb");
+    std::mt19937_64 rng{1};
+    std::string buffer;
+    std::size_t written = 0;
+    while (written < bytes)
+    {
+        buffer.clear();
+        for (int i = 0; i < 10000; i++)
+        {
+            char line[96];
+            const auto a = static_cast<long long>(rng() % 2000000) - 1000000;
+            const double b = static_cast<double>(rng() % 100000000) / 1000.0;
+            const auto c = static_cast<unsigned long long>(rng() >> 20);
+            buffer.append(line, static_cast<std::size_t>(std::snprintf(line, sizeof(line), "%lld,%.3f,%llu\n", a, b, c)));
+        }
+        std::fwrite(buffer.data(), 1, buffer.size(), fp);
+        written += buffer.size();
+    }
+    std::fclose(fp);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+    using numparse::column_type;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 小さな入力で結果の形とエラーの報告を確かめる
+        const column_type schema[] = {column_type::int64, column_type::float64};
+        auto r = numparse::parse("1,0.5\n-20,3.25\r\n300,-1e3", schema);
+        assert(!r.error && r.data.rows == 3);
+        for (std::size_t i = 0; i < r.data.rows; i++)
+            cout << r.data.int64_column(0)[i] << " " << r.data.float64_column(1)[i] << endl;
+
+        r = numparse::parse("1,0.5\n2,0.25\n3,x\n4,1.0\n", schema);
+        cout << "error at line " << r.error.line << ", field " << r.error.field << endl; // error at line 3, field 2
+        assert(r.error.line == 3 && r.error.field == 2 && r.error.ec == std::errc::invalid_argument);
+
+        r = numparse::parse("1,0.5\n99999999999999999999,1\n", schema);
+        assert(r.error.line == 2 && r.error.ec == std::errc::result_out_of_range);
+        r = numparse::parse("1,0.5,7\n", schema); // 列が多すぎる
+        assert(r.error.line == 1 && r.error.field == 2);
+        r = numparse::parse("1\n", schema); // 列が足りない
+        assert(r.error.line == 1 && r.error.field == 1);
+        r = numparse::parse("1,0.5\n", {}); // 列の型が1つもない
+        assert(r.error && r.error.field == 0 && r.error.ec == std::errc::invalid_argument);
+        cout << "all checks passed" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const std::size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 128;
+        const auto path = std::filesystem::temp_directory_path() / "08-numeric_parser.csv";
+        write_csv(path.c_str(), mib * 1024 * 1024);
+
+        numparse::mapped_file file(path.c_str());
+        if (!file.is_open())
+        {
+            cerr << "cannot open " << path << endl;
+            return 1;
+        }
+        const auto text = file.view();
+        const column_type schema[] = {column_type::int64, column_type::float64, column_type::int64};
+        cout << "file: " << text.size() / (1024 * 1024) << " MiB, "
+             << std::thread::hardware_concurrency() << " hardware threads" << endl;
+
+        // SIMD版・並列版(4スレッド)の結果がfrom_chars(1スレッド)と一致することを確認する
+        const auto reference = numparse::parse(text, schema, {.threads = 1, .use_simd = false});
+        const auto fast = numparse::parse(text, schema, {.threads = 4});
+        assert(!reference.error && !fast.error && reference.data.rows == fast.data.rows);
+        for (std::size_t i = 0; i < reference.data.rows; i++)
+        {
+            assert(reference.data.int64_column(0)[i] == fast.data.int64_column(0)[i]);
+            assert(reference.data.float64_column(1)[i] == fast.data.float64_column(1)[i]);
+            assert(reference.data.int64_column(2)[i] == fast.data.int64_column(2)[i]);
+        }
+        cout << reference.data.rows << " rows" << endl;
+
+        const double bytes = static_cast<double>(text.size());
+        auto measure = [&](const char *name, numparse::options opt)
+        {
+            bench::report_gbps(name, bench::best_of(3, [&]
+                                                    { bench::do_not_optimize(numparse::parse(text, schema, opt).data.rows); }),
+                               bytes);
+        };
+        measure("from_chars, 1 thread", {.threads = 1, .use_simd = false});
+        measure("simd, 1 thread", {.threads = 1, .use_simd = true});
+        measure("from_chars, all threads", {.use_simd = false});
+        measure("simd, all threads", {.use_simd = true});
+        std::filesystem::remove(path);
+    }
+}
+
+// Q1: スレッド数を増やしても速くならないのはなぜ？
+//   -> ファイルがページキャッシュに無ければディスクの読み込みが律速になる。
+//      また、出力の列の書き込み(最初に触ったときのページフォールト)もメモリ帯域を使う
+// Q2: 区切り位置を改行に合わせるだけで、引用符で囲まれたCSVにも使える？
+//   -> 使えない。"a\nb"のように値の中に改行があると、チャンクの境界を正しく決められない。
+//      数値だけのファイル(または引用符を使わない形式)を前提にしている
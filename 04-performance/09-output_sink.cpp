@@ -0,0 +1,161 @@
+/// std::cout/std::endl の代わりに使うバッファ付き出力
+// * 01～03のサンプルは std::cout << ... << std::endl で出力しているが、endlは改行のたびにflushするので
+//   大量に出力するループでは遅い。output_sink.h と比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 09-output_sink.cpp
+// * 使い方: ./a.out [個数] [出力先]  (省略時は10^7個を/dev/nullへ)
+
+#include "bench.h"
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+/// @brief 標準出力(fd 1)を一時的に別のファイルへ向ける
+///  std::cout/printfの計測結果が端末の速さに左右されないようにするため
+class redirect_stdout
+{
+public:
+    explicit redirect_stdout(const char *path)
+        : saved_(::dup(STDOUT_FILENO))
+    {
+        // 切り替える前に、それまでの出力を元の出力先へ書き出しておく
+        std::cout.flush();
+        std::fflush(stdout);
+        const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ::dup2(fd, STDOUT_FILENO);
+        ::close(fd);
+    }
+
+    ~redirect_stdout()
+    {
+        std::cout.flush();
+        std::fflush(stdout);
+        ::dup2(saved_, STDOUT_FILENO);
+        ::close(saved_);
+    }
+
+    redirect_stdout(const redirect_stdout &) = delete;
+    redirect_stdout &operator=(const redirect_stdout &) = delete;
+
+private:
+    int saved_;
+};
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 書式の確認: パイプへ書いて読み戻す
+        int fds[2];
+        [[maybe_unused]] const int r = ::pipe(fds);
+        assert(r == 0);
+        {
+            fastio::output_sink out{fds[1], 256};
+            out << "int: " << -42 << ", unsigned: " << 4294967295u << ", char: " << 'x' << '\n';
+            out << "double: " << 0.1 << " " << 1e100 << " " << -2.5f << '\n';
+            out.write(255, 16).put(' ').write(65535, 2).put('\n');
+            out.write(3.14159265, std::chars_format::fixed, 3).put('\n');
+            out.write(1e300, std::chars_format::fixed, 0).put('\n'); // 301桁(バッファより長い)
+            out.write(std::string(300, '=')).put('\n'); // バッファより大きい文字列はwritevでそのまま書く
+            assert(out.flush());
+        }
+        ::close(fds[1]);
+        std::string text;
+        char buf[1024];
+        for (ssize_t n; (n = ::read(fds[0], buf, sizeof(buf))) > 0;)
+            text.append(buf, static_cast<std::size_t>(n));
+        ::close(fds[0]);
+        cout << text.substr(0, text.find('=')) << "(= x" << std::count(text.begin(), text.end(), '=') << ")" << endl;
+        assert(text.starts_with("int: -42, unsigned: 4294967295, char: x\n"
+                                "double: 0.1 1e+100 -2.5\n"
+                                "ff 1111111111111111\n"
+                                "3.142\n"));
+        char big[400];
+        const auto b = std::to_chars(big, big + sizeof(big), 1e300, std::chars_format::fixed, 0);
+        assert(text.find(std::string(big, b.ptr) + '\n') != std::string::npos);
+
+        // それでも書けない値は、捨てずに失敗として報告する(4933桁)
+        const int null_fd = ::open("/dev/null", O_WRONLY);
+        fastio::output_sink huge{null_fd, 256};
+        huge.write(1e4932L, std::chars_format::fixed, 0);
+        assert(huge.failed());
+        ::close(null_fd);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const long count = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 10'000'000;
+        const char *path = argc > 2 ? argv[2] : "/dev/null";
+        std::vector<long> values(static_cast<std::size_t>(count));
+        for (long i = 0; i < count; i++)
+            values[static_cast<std::size_t>(i)] = i * 7919 % 1000003 - 500000;
+
+        std::printf("%ld integers -> %s\n", count, path);
+        auto measure = [&](const char *name, auto &&f)
+        {
+            double sec;
+            {
+                redirect_stdout redirect{path};
+                sec = bench::best_of(1, f);
+            }
+            bench::report_ns(name, sec, static_cast<double>(count));
+        };
+        measure("std::cout << std::endl", [&]
+                {
+                    for (auto v : values)
+                        std::cout << v << std::endl; });
+        measure("std::cout << '\\n'", [&]
+                {
+                    for (auto v : values)
+                        std::cout << v << '\n';
+                    std::cout.flush(); });
+        measure("printf", [&]
+                {
+                    for (auto v : values)
+                        std::printf("%ld\n", v);
+                    std::fflush(stdout); });
+        measure("fastio::output_sink", [&]
+                {
+                    fastio::output_sink out{STDOUT_FILENO};
+                    for (auto v : values)
+                        out << v << '\n'; });
+        measure("fastio::output_sink (1 MiB buffer)", [&]
+                {
+                    fastio::output_sink out{STDOUT_FILENO, 1024 * 1024};
+                    for (auto v : values)
+                        out << v << '\n'; });
+
+        std::printf("%ld doubles -> %s\n", count, path);
+        measure("std::cout << '\\n' (double)", [&]
+                {
+                    for (auto v : values)
+                        std::cout << v * 0.001 << '\n';
+                    std::cout.flush(); });
+        measure("printf(\"%g\")", [&]
+                {
+                    for (auto v : values)
+                        std::printf("%g\n", v * 0.001);
+                    std::fflush(stdout); });
+        measure("fastio::output_sink (double)", [&]
+                {
+                    fastio::output_sink out{STDOUT_FILENO};
+                    for (auto v : values)
+                        out << v * 0.001 << '\n'; });
+    }
+}
+
+// Q1: std::ios::sync_with_stdio(false) を使えばstd::coutも速くなる？
+//   -> '\n'を使う場合はかなり速くなる(stdioとの同期をやめて自前のバッファを使うため)。
+//      ただしendlを使う限り毎行flushされるので、遅さの主な原因は残る
+// Q2: printfの"%g"とoutput_sinkの出力は同じ？
+//   -> 違う。"%g"は有効数字6桁に丸めるが、to_charsの既定は「読み戻すと元の値になる最短の表記」。
+//      同じ書式にしたい場合は write(value, std::chars_format::general, 6) を使う
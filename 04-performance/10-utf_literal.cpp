@@ -0,0 +1,72 @@
+/// 文字列リテラルのコンパイル時変換
+// * 02-advanced/03-character-2.cpp のように同じ文字列を文字型ごとに書く代わりに、
+//   1つのリテラルから他の文字型の文字列をコンパイル時に作る(utf_literal.h)
+// * ビルド: g++ -std=c++20 -O2 10-utf_literal.cpp
+
+#include "utf_literal.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace utf::literals;
+
+// どれもコンパイル時に変換され、結果は静的な配列に置かれる
+constexpr std::u8string_view greeting_u8 = u8"abcdあいうえお🍣";
+constexpr std::u16string_view greeting_u16 = utf::literal_view<char16_t, u8"abcdあいうえお🍣">;
+constexpr std::u32string_view greeting_u32 = u8"abcdあいうえお🍣"_u32;
+constexpr std::wstring_view greeting_w = u8"abcdあいうえお🍣"_w;
+
+// 変換結果はコンパイル時に確かめられる
+static_assert(greeting_u16 == u"abcdあいうえお🍣");
+static_assert(greeting_u32 == U"abcdあいうえお🍣");
+static_assert(greeting_w == L"abcdあいうえお🍣");
+static_assert(greeting_u16.size() == 11); // 🍣はサロゲートペア
+static_assert(u"abcdあいうえお🍣"_u8 == greeting_u8);
+static_assert(U"abcdあいうえお🍣"_u16 == greeting_u16);
+static_assert(L"abcdあいうえお🍣"_u8 == greeting_u8);
+static_assert(utf::literal_array<char16_t, U"あ">.size() == 2); // 終端のnullを含む
+static_assert(utf::literal_array<char16_t, U"あ">.back() == u'\0');
+
+// 不正なシーケンスはコンパイルエラーになる(invalid_unicode_in_literalの呼び出しがエラーとして表示される)
+// constexpr auto bad1 = u8"\xff"_u16;   // UTF-8の不正なバイト
+// constexpr auto bad2 = u"\xD800"_u8;   // 単独のサロゲート
+
+template <class Char>
+void dump(const char *name, std::basic_string_view<Char> s)
+{
+    std::cout << name << "\t: size=" << std::dec << s.size() << " :";
+    for (auto c : s)
+        std::cout << " " << std::setfill('0') << std::setw(sizeof(Char) * 2) << std::hex << static_cast<unsigned long>(c);
+    std::cout << std::endl;
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        dump("u8", greeting_u8);
+        dump("u16", greeting_u16);
+        dump("u32", greeting_u32);
+        dump("wchar_t", greeting_w);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 実行時にはポインタと長さを読むだけ。同じリテラル・同じ型なら同じ配列を指す
+        const auto a = u8"寿司"_u16;
+        const auto b = utf::literal_view<char16_t, u8"寿司">;
+        cout << boolalpha << (a.data() == b.data()) << endl; // true
+        // 終端のnullがあるので、nullで終わる文字列を受け取るAPIにも渡せる
+        const char16_t *p = a.data();
+        cout << (p[a.size()] == u'\0') << endl; // true
+    }
+}
+
+// Q1: constexprではなくconstevalにしているのはなぜ？
+//   -> constexpr関数は実行時にも呼べるため、うっかり実行時の変換になることがある。
+//      constevalならコンパイル時に評価できない使い方はコンパイルエラーになる
+// Q2: "..."(charのリテラル)は変換できる？
+//   -> できるようにしていない。charのリテラルのエンコーディングは-fexec-charsetや/execution-charsetで
+//      変わる(SJISのこともある)ので、u8"..."を使う
@@ -0,0 +1,175 @@
+/// 2/8/16進数の文字列⇔整数の変換
+// * 05-tips/03-str_to_value.cpp の from_chars / to_chars と同じ使い方で、2/8/16進数をSIMDで速く変換する
+// * ビルド: g++ -std=c++20 -O2 -march=native 11-radix_conv.cpp
+
+#include "bench.h"
+#include "radix_conv.h"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief radix版とstd版で、結果(値・ptr・ec)がすべて一致することを確かめる
+template <class T>
+void check_parse(std::string_view s, int base)
+{
+    T a{42}, b{42};
+    const auto ra = radix::from_chars(s.data(), s.data() + s.size(), a, base);
+    const auto rb = std::from_chars(s.data(), s.data() + s.size(), b, base);
+    assert(ra.ptr == rb.ptr && ra.ec == rb.ec && a == b);
+}
+
+template <class T>
+void check_format(T value, int base)
+{
+    char a[80], b[80];
+    const auto ra = radix::to_chars(a, a + sizeof(a), value, base);
+    const auto rb = std::to_chars(b, b + sizeof(b), value, base);
+    assert(ra.ec == rb.ec && std::string_view(a, ra.ptr) == std::string_view(b, rb.ptr));
+    // 出力先が足りない場合
+    const auto len = static_cast<std::size_t>(rb.ptr - b);
+    const auto rc = radix::to_chars(a, a + len - 1, value, base);
+    assert(rc.ec == std::errc::value_too_large && rc.ptr == a + len - 1);
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 03-str_to_value.cpp と同じ例
+        const char str[] = "1111111111111111 is (65535)_10";
+        int value{};
+        if (auto [ptr, ec] = radix::from_chars(std::begin(str), std::end(str), value, 2); ec == std::errc{})
+            cout << value << endl; // 65535
+
+        char out[50]{};
+        if (auto [ptr, ec] = radix::to_chars(std::begin(out), std::end(out), 65535, 2); ec == std::errc{})
+            cout << std::string_view(out, ptr - out) << endl; // 1111111111111111
+        if (auto [ptr, ec] = radix::to_chars(std::begin(out), std::end(out), 0xDEADBEEFu, 16); ec == std::errc{})
+            cout << std::string_view(out, ptr - out) << endl; // deadbeef
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // std版と同じ結果になることを確かめる(エラーの場合も含めて)
+        for (int base : {2, 8, 16})
+        {
+            for (std::string_view s : {"", "0", "-", "-0", "x", "00000000000000000000000000000000000000001",
+                                       "ffffffffffffffff", "10000000000000000", "FfFf", "7fffffffffffffff", "-8000000000000000",
+                                       "-8000000000000001", "1777777777777777777777", "2000000000000000000000",
+                                       "1111111111111111111111111111111111111111111111111111111111111111",
+                                       "11111111111111111111111111111111111111111111111111111111111111111",
+                                       "0123456789abcdefg", "12 34", "1010101010101010101010101010101010101010z"})
+            {
+                check_parse<std::uint64_t>(s, base);
+                check_parse<std::int64_t>(s, base);
+                check_parse<std::uint32_t>(s, base);
+                check_parse<std::int16_t>(s, base);
+                check_parse<std::uint8_t>(s, base);
+            }
+            for (std::uint64_t v : {0ull, 1ull, 7ull, 8ull, 255ull, 0xFFFFFFFFull, 0x8000000000000000ull, ~0ull})
+            {
+                check_format(v, base);
+                check_format(static_cast<std::int64_t>(v), base);
+                check_format(static_cast<std::int32_t>(v), base);
+                check_format(static_cast<std::uint16_t>(v), base);
+                check_format(static_cast<std::int16_t>(v), base);
+                check_format(static_cast<std::int8_t>(v), base);
+            }
+            for (int v : {-32768, -129, -128, -127, -5, -1, 5, 127, 32767})
+            {
+                check_format(static_cast<std::int16_t>(v), base);
+                check_format(static_cast<std::int8_t>(v), base);
+            }
+            std::mt19937_64 rng{1};
+            for (int i = 0; i < 100000; i++)
+            {
+                const auto v = rng() >> (rng() % 64);
+                char buf[80];
+                const auto r = std::to_chars(buf, buf + sizeof(buf), v, base);
+                check_parse<std::uint64_t>(std::string_view(buf, r.ptr), base);
+                check_format(v, base);
+                check_format(static_cast<std::int64_t>(v), base);
+                check_format(static_cast<std::int16_t>(v), base);
+                check_format(static_cast<std::int8_t>(v), base);
+            }
+        }
+        cout << "all checks passed" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 速度比較: 空白区切りの大量の数値を読み込む/書き出す
+        constexpr std::size_t count = 1'000'000;
+        std::vector<std::uint64_t> values(count);
+        std::mt19937_64 rng{2};
+        for (auto &v : values)
+            v = rng() >> (rng() % 64);
+
+        for (int base : {2, 8, 16})
+        {
+            std::string text(count * 66, ' ');
+            char *p = text.data();
+            for (auto v : values)
+            {
+                p = std::to_chars(p, text.data() + text.size(), v, base).ptr;
+                *p++ = ' ';
+            }
+            text.resize(static_cast<std::size_t>(p - text.data()));
+
+            auto parse_all = [&](auto from_chars)
+            {
+                return [&, from_chars]
+                {
+                    const char *q = text.data();
+                    const char *const last = q + text.size();
+                    std::uint64_t sum = 0;
+                    while (q < last)
+                    {
+                        std::uint64_t v;
+                        q = from_chars(q, last, v, base).ptr + 1;
+                        sum += v;
+                    }
+                    bench::do_not_optimize(sum);
+                };
+            };
+            auto format_all = [&](auto to_chars)
+            {
+                return [&, to_chars]
+                {
+                    char *q = text.data();
+                    char *const last = q + text.size();
+                    for (auto v : values)
+                    {
+                        q = to_chars(q, last, v, base).ptr;
+                        *q++ = ' ';
+                    }
+                    bench::clobber_memory();
+                };
+            };
+            auto std_from = [](const char *f, const char *l, std::uint64_t &v, int b)
+            { return std::from_chars(f, l, v, b); };
+            auto radix_from = [](const char *f, const char *l, std::uint64_t &v, int b)
+            { return radix::from_chars(f, l, v, b); };
+            auto std_to = [](char *f, char *l, std::uint64_t v, int b)
+            { return std::to_chars(f, l, v, b); };
+            auto radix_to = [](char *f, char *l, std::uint64_t v, int b)
+            { return radix::to_chars(f, l, v, b); };
+
+            std::printf(" base %d (%.1f digits on average)\n", base, static_cast<double>(text.size()) / count - 1);
+            bench::report_ns("std::from_chars", bench::best_of(5, parse_all(std_from)), count);
+            bench::report_ns("radix::from_chars", bench::best_of(5, parse_all(radix_from)), count);
+            bench::report_ns("std::to_chars", bench::best_of(5, format_all(std_to)), count);
+            bench::report_ns("radix::to_chars", bench::best_of(5, format_all(radix_to)), count);
+        }
+    }
+}
+
+// Q1: 10進数はSIMDにしないの？
+//   -> 10進数は桁ごとの重みが2の累乗ではないので、読み込みは08-numeric_parser.cppのように
+//      掛け算でまとめる必要があり、書き出しも割り算が要る。2/8/16進数はビット操作だけで済む
+// Q2: 16進数の大文字("FF")は読める？
+//   -> 読める(std::from_charsと同じく大文字・小文字の両方を受け付ける)。書き出しは小文字
@@ -0,0 +1,129 @@
+/// バイト順の変換(エンディアン変換)
+// * 01_basic/06-bitcast.cpp の swap_endian_invalid() の代わりに、未定義動作のない変換と
+//   配列をまとめて変換する関数(byte_order.h)を使う
+// * ビルド: g++ -std=c++20 -O2 -march=native 12-endian.cpp
+
+#include "bench.h"
+#include "byte_order.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// 1要素の変換はコンパイル時にもできる
+static_assert(endian::byteswap(std::uint16_t{0x1234}) == 0x3412);
+static_assert(endian::byteswap(std::uint32_t{0x12345678}) == 0x78563412);
+static_assert(endian::byteswap(std::uint64_t{0x0102030405060708}) == 0x0807060504030201);
+static_assert(endian::byteswap(std::int32_t{-2}) == std::int32_t(0xFEFFFFFF));
+static_assert(endian::byteswap(endian::byteswap(1.5)) == 1.5);
+
+/// @brief SIMD版とスカラー版が同じ結果になるか、長さと開始位置(アラインメント)を変えて確かめる
+template <class T>
+void check_equivalence()
+{
+    std::vector<T> source(300);
+    std::mt19937_64 rng{1};
+    for (auto &v : source)
+    {
+        const auto bits = rng();
+        std::memcpy(&v, &bits, sizeof(T));
+    }
+    // 浮動小数点数はNaNも含めてビット単位で比べたいので memcmp を使う(n == 0 では空の vector の data() が nullptr になりうる)
+    const auto same_bytes = [](const T *a, const T *b, std::size_t n)
+    { return n == 0 || std::memcmp(a, b, n * sizeof(T)) == 0; };
+    for (std::size_t offset = 0; offset < 4; offset++)
+    {
+        for (std::size_t n = 0; n + offset <= source.size(); n += 7)
+        {
+            std::span<const T> in(source.data() + offset, n);
+            std::vector<T> expected(n), out(n + 1, T{});
+            for (std::size_t i = 0; i < n; i++)
+                expected[i] = endian::byteswap(in[i]);
+
+            // out-of-place(書きすぎていないかも確かめる)
+            endian::byteswap(in, std::span<T>(out));
+            assert(same_bytes(out.data(), expected.data(), n) && out[n] == T{});
+            // in-place
+            std::vector<T> inplace(in.begin(), in.end());
+            endian::byteswap(std::span<T>(inplace));
+            assert(same_bytes(inplace.data(), expected.data(), n));
+            // スカラー版
+            endian::byteswap(std::span<T>(inplace), false);
+            assert(same_bytes(inplace.data(), in.data(), n));
+        }
+    }
+}
+
+template <class T>
+void run_benchmark(const char *title)
+{
+    constexpr std::size_t bytes = 64 * 1024 * 1024;
+    std::vector<T> in(bytes / sizeof(T)), out(in.size());
+    for (std::size_t i = 0; i < in.size(); i++)
+        in[i] = static_cast<T>(i * 0x9E3779B97F4A7C15ull);
+
+    std::printf(" %s\n", title);
+    bench::report_gbps("scalar, out-of-place", bench::best_of(5, [&]
+                                                              {
+                                                                  endian::byteswap(std::span<const T>(in), std::span<T>(out), false);
+                                                                  bench::clobber_memory(); }),
+                       bytes);
+    bench::report_gbps("simd, out-of-place", bench::best_of(5, [&]
+                                                            {
+                                                                endian::byteswap(std::span<const T>(in), std::span<T>(out));
+                                                                bench::clobber_memory(); }),
+                       bytes);
+    bench::report_gbps("scalar, in-place", bench::best_of(5, [&]
+                                                          {
+                                                              endian::byteswap(std::span<T>(out), false);
+                                                              bench::clobber_memory(); }),
+                       bytes);
+    bench::report_gbps("simd, in-place", bench::best_of(5, [&]
+                                                        {
+                                                            endian::byteswap(std::span<T>(out));
+                                                            bench::clobber_memory(); }),
+                       bytes);
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // ネットワークから受け取ったビッグエンディアンのヘッダを読む
+        const std::byte packet[] = {std::byte{0x12}, std::byte{0x34}, std::byte{0xDE}, std::byte{0xAD},
+                                    std::byte{0xBE}, std::byte{0xEF}};
+        const auto port = endian::load_big<std::uint16_t>(packet);
+        const auto magic = endian::load_big<std::uint32_t>(packet + 2);
+        cout << hex << "port: 0x" << port << ", magic: 0x" << magic << dec << endl; // port: 0x1234, magic: 0xdeadbeef
+
+        std::byte reply[4];
+        endian::store_big(reply, magic);
+        assert(std::memcmp(reply, packet + 2, 4) == 0);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check_equivalence<std::uint16_t>();
+        check_equivalence<std::int32_t>();
+        check_equivalence<std::uint64_t>();
+        check_equivalence<float>();
+        check_equivalence<double>();
+        cout << "simd == scalar: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        run_benchmark<std::uint16_t>("16bit (64 MiB)");
+        run_benchmark<std::uint32_t>("32bit (64 MiB)");
+        run_benchmark<std::uint64_t>("64bit (64 MiB)");
+    }
+}
+
+// Q1: スカラー版もコンパイラが自動でベクトル化しないの？
+//   -> -O3などでは自動ベクトル化されることがある(その場合は差が小さくなる)。
+//      明示的に書いておくと、最適化レベルやコンパイラに関係なく同じ速さになる
+// Q2: floatを変換した値をfloatのまま扱ってよい？
+//   -> バイト順を逆にしたfloatはNaNの特定のビットパターンになることがあり、
+//      コピーの途中で値が変わる環境もある。変換した直後に送受信するか、整数型で持っておく方が安全
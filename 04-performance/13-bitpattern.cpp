@@ -0,0 +1,129 @@
+/// 値のビットパターンを見る
+// * 01_basic/06-casting.cpp の dump_bitpattern の代わりに bitpattern.h を使う
+// * ビルド: g++ -std=c++20 -O2 -march=native 13-bitpattern.cpp
+
+#include "bench.h"
+#include "bitpattern.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+/// @brief 06-casting.cpp の dump_bitpattern と同じ使い方をするためのマクロ
+#define DUMP_BITPATTERN(x) dump(#x, x)
+
+template <class T>
+void dump(const char *name, const T &x)
+{
+    char buf[64];
+    auto r = bitpattern::to_hex(buf, buf + sizeof(buf), x, bitpattern::byte_order::memory);
+    std::cout << name << " : " << std::string_view(buf, r.ptr) << " (memory) / ";
+    r = bitpattern::to_hex(buf, buf + sizeof(buf), x);
+    std::cout << std::string_view(buf, r.ptr) << " (value)" << std::endl;
+}
+
+template <class T>
+void dump_fields(const char *name, T x)
+{
+    char buf[80];
+    const auto r = bitpattern::to_fields(buf, buf + sizeof(buf), x);
+    const auto f = bitpattern::decompose(x);
+    static const char *const categories[] = {"zero", "subnormal", "normal", "infinity", "nan"};
+    std::cout << name << "\t: " << std::string_view(buf, r.ptr) << "  (" << categories[static_cast<int>(f.category())]
+              << ", exponent " << f.unbiased_exponent() << ")" << std::endl;
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 06-casting.cpp と同じ値
+        uint32_t x = 0xDEADBEEF;
+        DUMP_BITPATTERN(x); // x : efbeadde (memory) / deadbeef (value)
+
+        int x_int = (int)x;
+        DUMP_BITPATTERN(x_int);
+
+        uint16_t x_uint16 = (uint16_t)x;
+        DUMP_BITPATTERN(x_uint16); // x_uint16 : efbe (memory) / beef (value)
+
+        float x_float = (float)x;
+        DUMP_BITPATTERN(x_float); // x_float : bfad5e4f (memory) / 4f5eadbf (value)
+
+        // printf("%x")では先頭の0が落ちていたが、常に2桁ずつ書く
+        uint32_t small = 0x0A000B01;
+        DUMP_BITPATTERN(small); // small : 010b000a (memory) / 0a000b01 (value)
+
+        char bits[64];
+        auto r = bitpattern::to_bits(bits, bits + sizeof(bits), x_uint16, bitpattern::byte_order::value, true);
+        cout << "x_uint16 bits : " << string_view(bits, r.ptr) << endl; // 10111110 11101111
+
+        // バッファが足りなければ value_too_large
+        r = bitpattern::to_bits(bits, bits + 8, x);
+        assert(r.ec == errc::value_too_large);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 浮動小数点数の符号・指数・仮数
+        dump_fields("1.0f", 1.0f);
+        dump_fields("-2.5f", -2.5f);
+        dump_fields("-0.0f", -0.0f);
+        dump_fields("denorm", std::numeric_limits<float>::denorm_min());
+        dump_fields("inf", std::numeric_limits<float>::infinity());
+        dump_fields("nan", std::numeric_limits<float>::quiet_NaN());
+        dump_fields("pi", 3.141592653589793);
+
+        constexpr auto f = bitpattern::decompose(1.0);
+        static_assert(!f.sign && f.exponent == 1023 && f.mantissa == 0 && f.unbiased_exponent() == 0);
+        static_assert(bitpattern::decompose(-0.75f).sign && bitpattern::decompose(-0.75f).unbiased_exponent() == -1);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 配列をまとめて書く
+        const float values[] = {1.0f, 0.5f, -2.0f, 0.1f};
+        char buf[bitpattern::hex_array_length<float>(4)];
+        const auto r = bitpattern::to_hex_array(buf, buf + sizeof(buf), std::span<const float>(values));
+        cout << string_view(buf, r.ptr) << endl; // 3f800000 3f000000 c0000000 3dcccccd
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 速度比較: 100万個のdoubleを16進で書く
+        constexpr std::size_t count = 1'000'000;
+        std::vector<double> values(count);
+        for (std::size_t i = 0; i < count; i++)
+            values[i] = std::sin(static_cast<double>(i));
+        std::vector<char> out(bitpattern::hex_array_length<double>(count) + 1);
+
+        const auto printf_sec = bench::best_of(5, [&]
+                                               {
+                                                   // 06-casting.cpp と同じく1バイトずつ書式化する(%02xで先頭の0は残す)
+                                                   char *p = out.data();
+                                                   for (auto v : values)
+                                                   {
+                                                       unsigned char a[sizeof(double)];
+                                                       std::memcpy(a, &v, sizeof(double));
+                                                       for (auto b : a)
+                                                           p += std::snprintf(p, 3, "%02x", b);
+                                                       *p++ = ' ';
+                                                   }
+                                                   bench::clobber_memory(); });
+        const auto array_sec = bench::best_of(5, [&]
+                                              {
+                                                  bitpattern::to_hex_array(out.data(), out.data() + out.size(), std::span<const double>(values),
+                                                                           ' ', bitpattern::byte_order::memory);
+                                                  bench::clobber_memory(); });
+        bench::report_ns("snprintf(\"%02x\") per byte", printf_sec, count);
+        bench::report_ns("bitpattern::to_hex_array", array_sec, count);
+    }
+}
+
+// Q1: byte_order::memory と byte_order::value のどちらを使えばよい？
+//   -> ファイルや通信で送るバイト列と比べるならmemory、値(0xDEADBEEFなど)と比べるならvalue。
+//      浮動小数点数の符号・指数・仮数はvalueの並びで読む
+// Q2: 構造体も渡せる？
+//   -> trivially copyableなら渡せる。ただしパディングのバイトは不定値なので、実行ごとに違って見えることがある
@@ -0,0 +1,199 @@
+/// Nビット整数の詰め込み配列
+// * 01_basic/01-cstdint.cpp の整数型は8bit単位なので、3～12bitの値でもuint16_tなどで持つことになる。
+//   packed_array.h で必要なビット数だけ使って持ち、メモリ使用量と展開の速さを std::vector<uint16_t> と比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 14-packed_array.cpp
+
+#include "bench.h"
+#include "packed_array.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/// @brief SIMD版とスカラー版、get/setが同じ結果になるか確かめる
+template <unsigned Bits>
+void check()
+{
+    std::mt19937 rng{Bits};
+    std::vector<std::uint32_t> values(1000);
+    for (auto &v : values)
+        v = rng() & packed::packed_array<Bits>::max_value;
+
+    packed::packed_array<Bits> simd(values), scalar;
+    scalar.assign(values, false);
+    for (std::size_t i = 0; i < values.size(); i++)
+        assert(simd[i] == values[i] && scalar[i] == values[i]);
+
+    // 開始位置と長さを変えて展開する(8個単位の境界からずれていてもよい)
+    for (std::size_t first = 0; first < 20; first++)
+    {
+        for (std::size_t n = 0; first + n <= values.size(); n += 37)
+        {
+            std::vector<std::uint32_t> out(n), out_scalar(n);
+            simd.unpack(first, out);
+            simd.unpack(first, out_scalar, false);
+            assert(std::equal(out.begin(), out.end(), values.begin() + first));
+            assert(out == out_scalar);
+        }
+    }
+
+    // setは隣の値を壊さない
+    simd.set(5, packed::packed_array<Bits>::max_value);
+    simd.set(6, 0);
+    assert(simd[4] == values[4] && simd[5] == packed::packed_array<Bits>::max_value && simd[6] == 0 && simd[7] == values[7]);
+}
+
+/// @brief delta_packed が元の列に戻るか確かめる。最後のブロックが半端なものや、差が17ビット以上のものも含める
+void check_delta()
+{
+    for (const std::uint32_t step : {0u, 3u, 100'000u, 40'000'000u})
+    {
+        for (const std::size_t n : {0u, 1u, 7u, 128u, 129u, 300u, 1001u})
+        {
+            std::vector<std::uint32_t> sorted(n);
+            for (std::size_t i = 0; i < n; i++)
+                sorted[i] = static_cast<std::uint32_t>(i) * step;
+            const packed::delta_packed delta(sorted);
+            std::vector<std::uint32_t> out(n), out_scalar(n);
+            delta.decode(out);
+            delta.decode(out_scalar, false);
+            assert(out == sorted && out_scalar == sorted);
+            for (std::size_t i = 0; i < n; i++)
+                assert(delta[i] == sorted[i]);
+        }
+    }
+}
+
+template <unsigned Bits>
+void run_benchmark(std::size_t count)
+{
+    std::mt19937 rng{1};
+    std::vector<std::uint32_t> values(count);
+    for (auto &v : values)
+        v = rng() & packed::packed_array<Bits>::max_value;
+
+    const std::vector<std::uint16_t> plain(values.begin(), values.end());
+    const packed::packed_array<Bits> packed(values);
+    std::vector<std::uint32_t> out(count);
+
+    std::printf(" %u bit: vector<uint16_t> %zu KiB, packed_array %zu KiB (%.1f%%)\n", Bits,
+                plain.size() * sizeof(std::uint16_t) / 1024, packed.memory_usage() / 1024,
+                100.0 * static_cast<double>(packed.memory_usage()) / static_cast<double>(plain.size() * sizeof(std::uint16_t)));
+
+    // uint32_tの配列へ展開する速さ
+    bench::report_ns("  decode vector<uint16_t>", bench::best_of(5, [&]
+                                                                   {
+                                                                       std::copy(plain.begin(), plain.end(), out.begin());
+                                                                       bench::clobber_memory(); }),
+                     count);
+    bench::report_ns("  decode packed, scalar", bench::best_of(5, [&]
+                                                                 {
+                                                                     packed.unpack(0, out, false);
+                                                                     bench::clobber_memory(); }),
+                     count);
+    bench::report_ns("  decode packed, simd", bench::best_of(5, [&]
+                                                               {
+                                                                   packed.unpack(0, out);
+                                                                   bench::clobber_memory(); }),
+                     count);
+
+    // ランダムな位置の読み出し
+    std::vector<std::uint32_t> positions(1'000'000);
+    for (auto &p : positions)
+        p = static_cast<std::uint32_t>(rng() % count);
+    bench::report_ns("  random get vector<uint16_t>", bench::best_of(5, [&]
+                                                                       {
+                                                                           std::uint32_t sum = 0;
+                                                                           for (auto p : positions)
+                                                                               sum += plain[p];
+                                                                           bench::do_not_optimize(sum); }),
+                     positions.size());
+    bench::report_ns("  random get packed_array", bench::best_of(5, [&]
+                                                                   {
+                                                                       std::uint32_t sum = 0;
+                                                                       for (auto p : positions)
+                                                                           sum += packed[p];
+                                                                       bench::do_not_optimize(sum); }),
+                     positions.size());
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 12bitの値(0～4095)を持つ
+        packed::packed_array<12> a(10);
+        a.set(0, 4095);
+        a.set(1, 1234);
+        a.set(9, 5000); // 12bitに収まらない上位ビットは捨てられる(5000 & 4095 = 904)
+        cout << a[0] << " " << a[1] << " " << a[2] << " " << a[9] << endl; // 4095 1234 0 904
+        static_assert(packed::packed_array<12>::max_value == 4095);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check<1>();
+        check<3>();
+        check<5>();
+        check<7>();
+        check<8>();
+        check<12>();
+        check<14>();
+        check<17>();
+        check<32>();
+        check_delta();
+        cout << "simd == scalar: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 昇順の列(タイムスタンプや転置インデックスの文書番号など)は差分にすると小さな値になる
+        std::mt19937 rng{2};
+        std::vector<std::uint32_t> sorted(10'000'000);
+        std::uint32_t t = 1'700'000'000;
+        for (auto &v : sorted)
+        {
+            t += rng() % 100;
+            v = t;
+        }
+        const packed::delta_packed delta(sorted);
+        std::vector<std::uint32_t> out(sorted.size());
+        delta.decode(out);
+        assert(out == sorted);
+        for (std::size_t i = 0; i < sorted.size(); i += 9973)
+            assert(delta[i] == sorted[i]);
+
+        std::printf(" sorted 10^7: vector<uint32_t> %zu KiB, delta_packed %zu KiB (%.1f%%)\n",
+                    sorted.size() * sizeof(std::uint32_t) / 1024, delta.memory_usage() / 1024,
+                    100.0 * static_cast<double>(delta.memory_usage()) / static_cast<double>(sorted.size() * sizeof(std::uint32_t)));
+        bench::report_ns("  decode delta_packed, scalar", bench::best_of(5, [&]
+                                                                           {
+                                                                               delta.decode(out, false);
+                                                                               bench::clobber_memory(); }),
+                         sorted.size());
+        bench::report_ns("  decode delta_packed, simd", bench::best_of(5, [&]
+                                                                         {
+                                                                             delta.decode(out);
+                                                                             bench::clobber_memory(); }),
+                         sorted.size());
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        constexpr std::size_t count = 10'000'000;
+        run_benchmark<3>(count);
+        run_benchmark<7>(count);
+        run_benchmark<12>(count);
+    }
+}
+
+// Q1: std::vector<bool> や std::bitset と何が違う？
+//   -> どちらも1bit単位。packed_array は1要素をBitsビットの整数として読み書きする。
+//      Bitsはコンパイル時に決まるので、シフト量やマスクは定数になる
+// Q2: 展開せずにランダムアクセスすると遅くならない？
+//   -> 1回の読み出しは8バイト読んでシフトとマスクをするだけ。配列全体がキャッシュに収まりやすくなる分、
+//      大きな配列では vector<uint16_t> より速くなることもある
+// Q3: delta_packed の途中の値だけ読みたい
+//   -> operator[] はブロック(128個)の先頭から差分を足していく。頻繁に読むなら decode してから使う
@@ -0,0 +1,274 @@
+/// intN_t / int_leastN_t / int_fastN_t / intmax_t のどれが速いかを測る
+// * 01_basic/01-cstdint.cpp では int_fastN_t を「もっとも高速に演算できる整数型」と説明しているが、
+//   「速い」は処理系が決めた目安でしかない(glibcのx86-64では int_fast16_t も int_fast32_t も64bit)。
+//   配列に入れると大きくなってキャッシュに収まらなくなる分、かえって遅くなることもある
+// * 代表的な処理(ループ・総和・配列の添字・除算・ハッシュ)を、ビット幅ごとの3種類の型と要素数ごとに測り、
+//   この環境でどの型が最も速かったかを表示する。構造体のメンバの型を選ぶときの根拠にする
+// * ビルド: g++ -std=c++20 -O2 -march=native 15-int_width.cpp
+//   実行: ./a.out [最大要素数のlog2(既定は22)]
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    template <class T>
+    struct candidate
+    {
+        using type = T;
+        const char *name;
+    };
+
+    /// @brief ビット幅ごとに比べる型(同じ型の別名のこともあるので、表示するときに示す)
+    const auto candidates = std::tuple{
+        candidate<std::int8_t>{"int8_t"},
+        candidate<std::int_least8_t>{"int_least8_t"},
+        candidate<std::int_fast8_t>{"int_fast8_t"},
+        candidate<std::int16_t>{"int16_t"},
+        candidate<std::int_least16_t>{"int_least16_t"},
+        candidate<std::int_fast16_t>{"int_fast16_t"},
+        candidate<std::int32_t>{"int32_t"},
+        candidate<std::int_least32_t>{"int_least32_t"},
+        candidate<std::int_fast32_t>{"int_fast32_t"},
+        candidate<std::int64_t>{"int64_t"},
+        candidate<std::int_least64_t>{"int_least64_t"},
+        candidate<std::int_fast64_t>{"int_fast64_t"},
+        candidate<std::intmax_t>{"intmax_t"},
+    };
+    constexpr int group_size[] = {3, 3, 3, 4}; // 8/16/32/64bitの順(64bitにはintmax_tも入れる)
+
+    /// @brief 符号なし整数で計算して桁あふれを折り返す(C++20では符号付きへの変換も剰余で定義されている)
+    template <class T, class V>
+    constexpr T wrap(V v) noexcept
+    {
+        return static_cast<T>(static_cast<std::make_unsigned_t<T>>(v));
+    }
+
+    template <class T>
+    using unsigned_t = std::make_unsigned_t<T>;
+
+    //
+    // 計測する処理。どれも要素数nの配列を1回なめる
+    //
+
+    /// @brief 各要素を書き換えるループ(ベクトル化されると1命令で処理できる要素数が型の大きさで変わる)
+    template <class T>
+    void kernel_loop(std::vector<T> &a)
+    {
+        for (auto &x : a)
+            x = wrap<T>(unsigned_t<T>(x) * 3u + 1u);
+    }
+
+    /// @brief 総和
+    template <class T>
+    T kernel_sum(const std::vector<T> &a)
+    {
+        T acc = 0;
+        for (auto x : a)
+            acc = wrap<T>(unsigned_t<T>(acc) + unsigned_t<T>(x));
+        return acc;
+    }
+
+    /// @brief T型の添字で表を引く(符号拡張やアドレス計算の違いが出る)
+    template <class T>
+    T kernel_index(const std::vector<T> &table, const std::vector<T> &index)
+    {
+        T acc = 0;
+        for (auto i : index)
+            acc = wrap<T>(unsigned_t<T>(acc) + unsigned_t<T>(table[i]));
+        return acc;
+    }
+
+    /// @brief 要素ごとに違う値で割る(除算命令の速さはオペランドの大きさで変わる)
+    template <class T>
+    T kernel_div(const std::vector<T> &a, const std::vector<T> &d)
+    {
+        T acc = 0;
+        for (std::size_t i = 0; i < a.size(); i++)
+            acc = wrap<T>(unsigned_t<T>(acc) + unsigned_t<T>(a[i] / d[i]));
+        return acc;
+    }
+
+    /// @brief FNV-1a風のハッシュ(乗算の依存チェーン)
+    template <class T>
+    T kernel_hash(const std::vector<T> &a)
+    {
+        constexpr auto prime = static_cast<unsigned_t<T>>(0x100000001B3ull); // 下位ビットは奇数
+        unsigned_t<T> h = static_cast<unsigned_t<T>>(0xCBF29CE484222325ull);
+        for (auto x : a)
+            h = static_cast<unsigned_t<T>>((h ^ unsigned_t<T>(x)) * prime);
+        return static_cast<T>(h);
+    }
+
+    constexpr const char *kernel_names[] = {"loop", "sum", "index", "div", "hash"};
+    constexpr int kernel_count = std::size(kernel_names);
+
+    /// @brief 型Tで各処理を実行し、1要素あたりの時間[ns]を返す
+    template <class T>
+    std::vector<double> measure(std::size_t n, std::size_t total)
+    {
+        std::mt19937_64 rng{n};
+        // 表の大きさはどの型でも添字にできる128要素にそろえ、添字の配列を読む速さと添字の計算の違いだけを比べる
+        constexpr std::size_t table_size = 128;
+        std::vector<T> a(n), d(n), index(n), table(table_size);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            a[i] = static_cast<T>(rng() % static_cast<std::uint64_t>(std::numeric_limits<T>::max()));
+            d[i] = static_cast<T>(1 + rng() % 100);
+            index[i] = static_cast<T>(rng() % table_size);
+        }
+        for (auto &t : table)
+            t = static_cast<T>(rng() & 0x7F);
+
+        // 小さな配列は何周もして、1回の計測がtotal要素分になるようにする
+        const std::size_t rounds = std::max<std::size_t>(1, total / n);
+        const auto run = [&](auto &&f)
+        {
+            return bench::best_of(3, [&]
+                                  {
+                                      for (std::size_t r = 0; r < rounds; r++)
+                                          f();
+                                      bench::clobber_memory(); }) *
+                   1e9 / static_cast<double>(rounds * n);
+        };
+        return {
+            run([&]
+                { kernel_loop(a); bench::do_not_optimize(a.data()); }),
+            run([&]
+                { bench::do_not_optimize(kernel_sum(a)); }),
+            run([&]
+                { bench::do_not_optimize(kernel_index(table, index)); }),
+            run([&]
+                { bench::do_not_optimize(kernel_div(a, d)); }),
+            run([&]
+                { bench::do_not_optimize(kernel_hash(a)); }),
+        };
+    }
+
+    struct result
+    {
+        std::string name;
+        std::string alias;      // 同じ型の別名なら、先に出てきた名前
+        std::vector<double> ns; // 処理ごとの1要素あたりの時間
+    };
+
+    /// @brief 同じ型の別名を探す(int_least8_t は int8_t と同じ、など)
+    template <class T>
+    std::string find_alias(const char *self)
+    {
+        std::string alias;
+        bool reached = false; // 自分より前に出てきた名前だけを探す
+        std::apply([&](auto... c)
+                   { ((reached = reached || std::string(c.name) == self,
+                       !reached && alias.empty() && std::is_same_v<T, typename decltype(c)::type> ? (void)(alias = c.name) : (void)0),
+                      ...); },
+                   candidates);
+        return alias;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    const int max_log2 = argc > 1 ? std::atoi(argv[1]) : 22;
+    // L1に収まる大きさ、L2/L3に収まる大きさ、メモリまで行く大きさ
+    std::vector<std::size_t> sizes;
+    for (int e : {10, 16, max_log2})
+        if (e <= max_log2 && (sizes.empty() || sizes.back() < (std::size_t{1} << e)))
+            sizes.push_back(std::size_t{1} << e);
+
+    cout << "-------------------------------------" << endl;
+    {
+        // この環境での各型の大きさ
+        std::apply([](auto... c)
+                   { ((std::printf(" %-14s %zu bytes%s\n", c.name, sizeof(typename decltype(c)::type),
+                                   find_alias<typename decltype(c)::type>(c.name).empty()
+                                       ? ""
+                                       : (" (= " + find_alias<typename decltype(c)::type>(c.name) + ")").c_str())),
+                      ...); },
+                   candidates);
+    }
+
+    // summary[size][kernel] = 最も速かった型
+    std::vector<std::vector<std::string>> summary(sizes.size(), std::vector<std::string>(kernel_count));
+    for (std::size_t s = 0; s < sizes.size(); s++)
+    {
+        const auto n = sizes[s];
+        const std::size_t total = std::max<std::size_t>(n, std::size_t{1} << 22);
+        std::vector<result> results;
+        const auto measure_one = [&](auto c)
+        {
+            using T = typename decltype(c)::type;
+            auto alias = find_alias<T>(c.name);
+            // 別名は同じ型なので測り直さない(同じコードを測った誤差で「速い」と出ないように)
+            auto ns = alias.empty() ? measure<T>(n, total)
+                                    : std::find_if(results.begin(), results.end(), [&](auto &r)
+                                                   { return r.name == alias; })
+                                          ->ns;
+            results.push_back({c.name, std::move(alias), std::move(ns)});
+        };
+        std::apply([&](auto... c)
+                   { (measure_one(c), ...); },
+                   candidates);
+
+        cout << "-------------------------------------" << endl;
+        std::printf(" n = %zu elements (ns/element, * = fastest in the width, aliases share a result)\n", n);
+        for (int k = 0; k < kernel_count; k++)
+        {
+            std::printf("  [%s]\n", kernel_names[k]);
+            std::size_t first = 0;
+            for (int g : group_size)
+            {
+                const auto best = std::min_element(results.begin() + first, results.begin() + first + g, [&](auto &x, auto &y)
+                                                   { return x.ns[k] < y.ns[k]; });
+                std::printf("   ");
+                for (std::size_t i = first; i < first + g; i++)
+                    std::printf(" %14s %7.3f%c", results[i].name.c_str(), results[i].ns[k], results.begin() + i == best ? '*' : ' ');
+                std::printf("\n");
+                first += g;
+            }
+            const auto best = std::min_element(results.begin(), results.end(), [&](auto &x, auto &y)
+                                               { return x.ns[k] < y.ns[k]; });
+            summary[s][k] = best->name;
+        }
+    }
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 処理と要素数ごとに、全体で最も速かった型(値の範囲が足りるなら、小さい型ほど有利になりやすい)
+        std::printf(" %-8s", "");
+        for (auto n : sizes)
+            std::printf(" %16zu", n);
+        std::printf("\n");
+        for (int k = 0; k < kernel_count; k++)
+        {
+            std::printf(" %-8s", kernel_names[k]);
+            for (std::size_t s = 0; s < sizes.size(); s++)
+                std::printf(" %16s", summary[s][k].c_str());
+            std::printf("\n");
+        }
+    }
+}
+
+// Q1: int_fast16_t が64bitなのはなぜ？
+//   -> 処理系(ABI)が決めている。x86-64のglibcでは「レジスタの大きさで計算すると余計な命令が要らない」として
+//      16/32bitのfast型を64bitにしているが、配列にすると4倍/2倍のメモリを使う。
+//      macOSでは16bit、MSVCでは32bitで、移植先によって大きさが変わる
+// Q2: 結局どれを使えばよい？
+//   -> 配列や構造体のメンバは値の範囲が収まる最小の intN_t(メモリとキャッシュを節約)、
+//      ループの添字や一時変数は int や std::size_t で十分なことが多い。迷ったらこのベンチマークを動かして決める
+// Q3: 除算はなぜ型で速さが違う？
+//   -> x86-64の除算命令はオペランドの大きさで遅延が変わる(64bitは32bitより遅いCPUが多い)。
+//      8/16bitの値はint(32bit)に格上げされてから割るので、32bitの除算と同じになる
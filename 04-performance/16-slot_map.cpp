@@ -0,0 +1,189 @@
+/// 32bitハンドルとタグ付きポインタ
+// * 01_basic/01-cstdint.cpp のようにポインタの値(intptr_t)をIDにする代わりに、slot_map.h の32bitハンドルを使う。
+//   メモリ使用量と検索の速さを std::unordered_map<intptr_t, T*> と比べる
+// * tagged_ptr.h でポインタの空きビットにフラグを入れる
+// * ビルド: g++ -std=c++20 -O2 -march=native 16-slot_map.cpp alloc_tracker.cpp
+
+#include "alloc_tracker.h"
+#include "bench.h"
+#include "slot_map.h"
+#include "tagged_ptr.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct entity
+{
+    float x, y, z;
+    float vx, vy, vz;
+};
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        slot::slot_map<std::string> names;
+        const auto a = names.insert("alice");
+        const auto b = names.insert("bob");
+        const auto c = names.insert("carol");
+        cout << "handle: " << sizeof(a) << " bytes, a = " << *names.find(a) << endl; // handle: 4 bytes, a = alice
+
+        names.erase(b);
+        assert(names.find(b) == nullptr); // 削除済みのハンドルはnullptrになる
+        const auto d = names.insert("dave"); // bのスロットを再利用するが、世代が違う
+        assert(d.index() == b.index() && d.generation() == b.generation() + 1);
+        assert(names.find(b) == nullptr && *names.find(d) == "dave" && names[c] == "carol");
+
+        // 要素は詰めて並んでいるので、走査は配列をなめるだけ
+        for (const auto &name : names)
+            cout << name << " ";
+        cout << endl; // alice carol dave
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 世代番号を使い切ったスロットは再利用しない(スロット番号28bit、世代4bitで試す)
+        slot::slot_map<int, 28> m;
+        auto h = m.insert(0);
+        const auto first = h;
+        for (int i = 1; i < 20; i++)
+        {
+            m.erase(h);
+            h = m.insert(i);
+        }
+        cout << "slot " << h.index() << ", generation " << h.generation() << endl; // slot 1, generation 5
+        assert(!m.contains(first) && h.index() == 1);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // ポインタ + フラグ2つ
+        struct node_ref
+        {
+            entity *p;
+            bool selected;
+            bool dirty;
+        };
+        entity e{};
+        tagged::tagged_ptr<entity> t(&e);
+        t.set_flag(0, true); // selected
+        t.set_flag(1, true); // dirty
+        t->x = 1.5f;
+        cout << "pointer + bool x2: " << sizeof(node_ref) << " bytes, tagged_ptr: " << sizeof(t) << " bytes" << endl;
+        cout << "tag bits: " << tagged::tagged_ptr<entity>::tag_bits << ", tag: " << t.tag() << ", x: " << e.x << endl; // tag bits: 2, tag: 3, x: 1.5
+        assert(t.get() == &e && t.flag(0) && t.flag(1));
+
+        // アラインメントを大きくすると使えるビットも増える
+        struct alignas(16) aligned16
+        {
+            int v;
+        };
+        static_assert(tagged::tagged_ptr<aligned16>::tag_bits == 4);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        constexpr std::size_t count = 1'000'000;
+        std::mt19937 rng{1};
+
+        // ポインタの値をIDにする方法
+        std::vector<std::unique_ptr<entity>> owners;
+        std::unordered_map<std::intptr_t, entity *> by_id;
+        std::vector<std::intptr_t> ids;
+        std::size_t map_bytes = 0;
+        {
+            alloc_tracker::alloc_scope scope{"unordered_map", false};
+            owners.reserve(count);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                owners.push_back(std::make_unique<entity>(entity{float(i), 0, 0, 1, 1, 1}));
+                by_id.emplace(reinterpret_cast<std::intptr_t>(owners.back().get()), owners.back().get());
+            }
+            map_bytes = static_cast<std::size_t>(scope.delta().live_bytes());
+        }
+        // slot_map
+        slot::slot_map<entity> entities;
+        std::vector<slot::slot_map<entity>::handle> handles;
+        std::size_t slot_bytes = 0;
+        {
+            alloc_tracker::alloc_scope scope{"slot_map", false};
+            for (std::size_t i = 0; i < count; i++)
+                handles.push_back(entities.insert(entity{float(i), 0, 0, 1, 1, 1}));
+            slot_bytes = static_cast<std::size_t>(scope.delta().live_bytes()) - handles.capacity() * sizeof(handles[0]);
+        }
+        for (auto &o : owners)
+            ids.push_back(reinterpret_cast<std::intptr_t>(o.get()));
+
+        std::printf(" %zu entities (entity: %zu bytes)\n", count, sizeof(entity));
+        std::printf("  %-40s %10.1f MiB (id: %zu bytes)\n", "unique_ptr + unordered_map<intptr_t, T*>", map_bytes / 1048576.0, sizeof(ids[0]));
+        std::printf("  %-40s %10.1f MiB (id: %zu bytes)\n", "slot_map", slot_bytes / 1048576.0, sizeof(handles[0]));
+
+        // 同じ順序(ランダム)でIDから引く
+        std::vector<std::uint32_t> order(count);
+        for (auto &o : order)
+            o = static_cast<std::uint32_t>(rng() % count);
+        bench::report_ns("lookup unordered_map", bench::best_of(5, [&]
+                                                                {
+                                                                    float sum = 0;
+                                                                    for (auto i : order)
+                                                                        sum += by_id.find(ids[i])->second->x;
+                                                                    bench::do_not_optimize(sum); }),
+                         count);
+        bench::report_ns("lookup slot_map", bench::best_of(5, [&]
+                                                           {
+                                                               float sum = 0;
+                                                               for (auto i : order)
+                                                                   sum += entities.find(handles[i])->x;
+                                                               bench::do_not_optimize(sum); }),
+                         count);
+
+        // 全要素を更新する
+        bench::report_ns("iterate unordered_map", bench::best_of(5, [&]
+                                                                 {
+                                                                     for (auto &[id, e] : by_id)
+                                                                         e->x += e->vx;
+                                                                     bench::clobber_memory(); }),
+                         count);
+        bench::report_ns("iterate slot_map", bench::best_of(5, [&]
+                                                            {
+                                                                for (auto &e : entities)
+                                                                    e.x += e.vx;
+                                                                bench::clobber_memory(); }),
+                         count);
+
+        // 半分を削除して入れ直す
+        bench::report_ns("erase + insert unordered_map", bench::best_of(1, [&]
+                                                                        {
+                                                                            for (std::size_t i = 0; i < count; i += 2)
+                                                                            {
+                                                                                by_id.erase(ids[i]);
+                                                                                owners[i] = std::make_unique<entity>();
+                                                                                ids[i] = reinterpret_cast<std::intptr_t>(owners[i].get());
+                                                                                by_id.emplace(ids[i], owners[i].get());
+                                                                            } }),
+                         count / 2);
+        bench::report_ns("erase + insert slot_map", bench::best_of(1, [&]
+                                                                   {
+                                                                       for (std::size_t i = 0; i < count; i += 2)
+                                                                       {
+                                                                           entities.erase(handles[i]);
+                                                                           handles[i] = entities.insert(entity{});
+                                                                       } }),
+                         count / 2);
+        assert(entities.size() == count && entities.find(handles[0]) != nullptr);
+    }
+}
+
+// Q1: ハンドルを32bitにすると何がうれしい？
+//   -> 参照する側の構造体が小さくなる(ポインタ8バイト→4バイト)。また、ハンドルは実行ごとに同じ値になるので、
+//      ファイルへの保存や通信、ログの比較にも使える
+// Q2: 要素へのポインタを持っておいてもよい？
+//   -> 削除や挿入で要素が移動するので、ポインタは次の変更までしか使えない。長く持つならハンドルを持つ
+// Q3: tagged_ptr のタグはどのくらい使える？
+//   -> 空いているのはアラインメントの分だけ(alignof(T)が8なら3bit)。x86-64の上位16bitも普通は使われていないが、
+//      5レベルページングなどで使われることがあり、移植性がないのでここでは使わない
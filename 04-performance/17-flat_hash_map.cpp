@@ -0,0 +1,270 @@
+/// オープンアドレス法のハッシュマップ
+// * 01_basic/02-auto.cpp の std::map<std::string, int> と同じ使い方で、要素を配列に直接置く flat_hash_map.h を使う
+// * 挿入・検索(あり/なし)・走査の速さを std::map / std::unordered_map と要素数ごとに比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 17-flat_hash_map.cpp
+//   実行: ./a.out [最大要素数のlog10(既定は6。8にすると10^8要素まで測るが、数GBのメモリを使う)]
+
+#include "bench.h"
+#include "flat_hash_map.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @brief 挿入・削除を繰り返して std::unordered_map と同じ内容になるか確かめる
+void check_against_std()
+{
+    std::mt19937_64 rng{1};
+    flat::flat_hash_map<std::uint64_t, std::uint64_t> m;
+    std::unordered_map<std::uint64_t, std::uint64_t> expected;
+    for (int i = 0; i < 200'000; i++)
+    {
+        const auto key = rng() % 5000; // 同じキーの挿入・削除が何度も起きる範囲
+        switch (rng() % 3)
+        {
+        case 0:
+            m[key] = static_cast<std::uint64_t>(i);
+            expected[key] = static_cast<std::uint64_t>(i);
+            break;
+        case 1:
+            assert(m.erase(key) == expected.erase(key));
+            break;
+        default:
+        {
+            const auto it = m.find(key);
+            const auto e = expected.find(key);
+            assert((it == m.end()) == (e == expected.end()));
+            assert(it == m.end() || it->second == e->second);
+        }
+        }
+    }
+    assert(m.size() == expected.size());
+    std::size_t visited = 0;
+    for (const auto &[key, value] : m)
+    {
+        assert(expected.at(key) == value);
+        visited++;
+    }
+    assert(visited == expected.size());
+
+    // 全部消してから入れ直しても(削除済みの印だらけでも)使える
+    for (const auto &[key, value] : expected)
+        m.erase(key);
+    assert(m.empty());
+    for (std::uint64_t k = 0; k < 10'000; k++)
+        m.try_emplace(k, k);
+    assert(m.size() == 10'000 && m.find(9'999)->second == 9'999);
+}
+
+/// @brief コピーの回数を数え、決めた回数でコピーが例外を投げるキー
+struct counted_key
+{
+    static inline int copies_left = -1; // 0になったら次のコピーで例外(-1なら無制限)
+    std::string name;
+    explicit counted_key(int k) : name("a long key to force heap allocation " + std::to_string(k)) {}
+    counted_key(counted_key &&) noexcept = default;
+    counted_key(const counted_key &other) : name(other.name)
+    {
+        if (copies_left == 0)
+            throw std::runtime_error("copy");
+        if (copies_left > 0)
+            copies_left--;
+    }
+    bool operator==(const counted_key &other) const noexcept { return name == other.name; }
+};
+
+struct counted_hash
+{
+    std::size_t operator()(const counted_key &k) const noexcept { return std::hash<std::string>{}(k.name); }
+};
+
+/// @brief 値の構築や作り直しが例外を投げても、挿入しかけた要素が残らない
+void check_exception_safety()
+{
+    struct throwing
+    {
+        int value;
+        explicit throwing(int v) : value(v)
+        {
+            if (v < 0)
+                throw std::invalid_argument("negative");
+        }
+    };
+    flat::flat_hash_map<int, throwing> m;
+    m.try_emplace(1, 10);
+    for (int k = 2; k < 100; k++)
+    {
+        try
+        {
+            m.try_emplace(k, -1);
+            assert(false);
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+        assert(m.size() == 1 && !m.contains(k));
+    }
+    for (int k = 2; k < 100; k++) // 容量を使い切るまで入れても壊れていない
+        m.try_emplace(k, k);
+    assert(m.size() == 99 && m.find(1)->second.value == 10 && m.find(99)->second.value == 99);
+
+    // 作り直しの途中でキーのコピーが例外を投げても、元の表が残る
+    flat::flat_hash_map<counted_key, std::string, counted_hash> keys;
+    const int n = 14; // 容量16の表は14個(7/8)で一杯になり、次の挿入で作り直す
+    for (int k = 0; k < n; k++)
+        keys.try_emplace(counted_key(k), std::string(40, 'v'));
+    const auto capacity = keys.capacity();
+    assert(capacity == 16);
+    counted_key::copies_left = 3;
+    try
+    {
+        keys.try_emplace(counted_key(n), "x");
+        assert(false);
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    counted_key::copies_left = -1;
+    assert(keys.size() == static_cast<std::size_t>(n) && keys.capacity() == capacity);
+    for (int k = 0; k < n; k++)
+        assert(keys.contains(counted_key(k)) && keys.find(counted_key(k))->second == std::string(40, 'v'));
+    assert(!keys.contains(counted_key(n)));
+    keys.try_emplace(counted_key(n), "x"); // 例外がなければ作り直せる
+    assert(keys.size() == static_cast<std::size_t>(n + 1) && keys.capacity() > capacity);
+}
+
+template <class Map>
+void run_benchmark(const char *name, const std::vector<std::uint64_t> &keys, const std::vector<std::uint64_t> &misses)
+{
+    const std::size_t n = keys.size();
+    // 小さいときは何度も繰り返して、1回の計測が約100万操作になるようにする
+    const std::size_t rounds = std::max<std::size_t>(1, 1'000'000 / n);
+    const int repeats = n >= 10'000'000 ? 1 : 3;
+
+    const auto insert_sec = bench::best_of(repeats, [&]
+                                           {
+                                               for (std::size_t r = 0; r < rounds; r++)
+                                               {
+                                                   Map m;
+                                                   for (auto k : keys)
+                                                       m.emplace(k, k);
+                                                   bench::do_not_optimize(m.size());
+                                               } });
+    Map m;
+    for (auto k : keys)
+        m.emplace(k, k);
+
+    // 挿入とは別の順序で引く
+    std::vector<std::uint64_t> hits(keys.rbegin(), keys.rend());
+    const auto hit_sec = bench::best_of(repeats, [&]
+                                        {
+                                            std::uint64_t sum = 0;
+                                            for (std::size_t r = 0; r < rounds; r++)
+                                                for (auto k : hits)
+                                                    sum += m.find(k)->second;
+                                            bench::do_not_optimize(sum); });
+    const auto miss_sec = bench::best_of(repeats, [&]
+                                         {
+                                             std::size_t found = 0;
+                                             for (std::size_t r = 0; r < rounds; r++)
+                                                 for (auto k : misses)
+                                                     found += m.find(k) != m.end();
+                                             bench::do_not_optimize(found); });
+    const auto iterate_sec = bench::best_of(repeats, [&]
+                                            {
+                                                std::uint64_t sum = 0;
+                                                for (std::size_t r = 0; r < rounds; r++)
+                                                    for (const auto &[key, value] : m)
+                                                        sum += value;
+                                                bench::do_not_optimize(sum); });
+
+    const double ops = static_cast<double>(rounds * n);
+    std::printf("  %-14s %10.2f %10.2f %10.2f %10.2f\n", name, insert_sec * 1e9 / ops, hit_sec * 1e9 / ops,
+                miss_sec * 1e9 / ops, iterate_sec * 1e9 / ops);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 02-auto.cpp と同じ使い方
+        flat::flat_hash_map<std::string, int> m = {{"a", 1}, {"c", 3}};
+        m["b"] = 2;
+        for (const auto &[key, value] : m) // 順序はハッシュ値で決まる(std::mapのようにキー順にはならない)
+            cout << key << "=" << value << " ";
+        cout << endl;
+
+        // std::string_view で引いても std::string の一時オブジェクトを作らない
+        const std::string_view line = "key=c";
+        const auto it = m.find(line.substr(4));
+        cout << "find(\"c\"): " << it->second << ", contains(\"z\"): " << m.contains("z") << endl; // find("c"): 3, contains("z"): 0
+        // 挿入するときだけ std::string を作る
+        m.try_emplace(line.substr(0, 3), 10);
+        assert(m.size() == 4 && m.find(std::string("key"))->second == 10);
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 容量の制御: 先にreserveしておけば作り直し(全要素の入れ直し)が起きない
+        flat::flat_hash_map<int, int> m;
+        m.reserve(1000);
+        const auto capacity = m.capacity();
+        for (int i = 0; i < 1000; i++)
+            m[i] = i;
+        cout << "capacity: " << capacity << " -> " << m.capacity() << ", load factor: " << m.load_factor() << endl; // capacity: 2048 -> 2048
+        for (int i = 0; i < 900; i++)
+            m.erase(i);
+        m.rehash(0); // 要素数に合わせて縮める
+        cout << "after erase + rehash(0): size " << m.size() << ", capacity " << m.capacity() << endl; // size 100, capacity 128
+        assert(m.size() == 100 && m.find(950)->second == 950 && !m.contains(10));
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check_against_std();
+        check_exception_safety();
+        cout << "same as std::unordered_map: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const int max_log10 = argc > 1 ? std::atoi(argv[1]) : 6;
+        std::mt19937_64 rng{2};
+        std::printf("  %-14s %10s %10s %10s %10s  (ns/op)\n", "", "insert", "hit", "miss", "iterate");
+        for (int e = 3; e <= max_log10; e++)
+        {
+            std::size_t n = 1;
+            for (int i = 0; i < e; i++)
+                n *= 10;
+            // 奇数のキーを入れて、偶数のキーで「ない」場合を測る
+            std::vector<std::uint64_t> keys(n), misses(n);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                keys[i] = rng() | 1;
+                misses[i] = rng() & ~std::uint64_t{1};
+            }
+            std::printf(" 10^%d elements\n", e);
+            run_benchmark<std::map<std::uint64_t, std::uint64_t>>("std::map", keys, misses);
+            run_benchmark<std::unordered_map<std::uint64_t, std::uint64_t>>("unordered_map", keys, misses);
+            run_benchmark<flat::flat_hash_map<std::uint64_t, std::uint64_t>>("flat_hash_map", keys, misses);
+        }
+    }
+}
+
+// Q1: std::unordered_map の代わりにいつでも使える？
+//   -> 挿入や作り直しで要素が移動するので、要素へのポインタや参照、イテレータは挿入のたびに無効になる
+//      (std::unordered_map は要素のアドレスが変わらない)。アドレスを保持したいなら値を unique_ptr にするか、
+//      16-slot_map.cpp のハンドルを使う
+// Q2: なぜ制御バイトにハッシュ値の7bitを入れる？
+//   -> 7bitが一致しない位置はキーを読まずに除外できる(はずれる確率は1/128)。
+//      キーの比較(文字列なら特に)とキー配列へのメモリアクセスがほとんど起きない
+// Q3: 削除が多いと遅くなる？
+//   -> 削除済みの印は検索を止めないので、印が増えると探す範囲が伸びる。印が空き位置を使い切ったら
+//      同じ容量で作り直して消える。大量に消した後は rehash(0) で縮めるとよい
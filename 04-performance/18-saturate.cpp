@@ -0,0 +1,196 @@
+/// 画素・サンプルの配列をまとめて範囲に丸める
+// * 05-tips/01-clamp.cpp の std::clamp(x, 0, 255) を1フレーム分の全画素に対して行う場合に、
+//   saturate.h のSIMD版(pack命令の飽和、min/max)と std::clamp のループを比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 18-saturate.cpp
+
+#include "bench.h"
+#include "saturate.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/// @brief 境界付近の値と範囲外の値を多めに含む入力を作る
+template <class T>
+std::vector<T> make_input(std::size_t n, std::uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    std::vector<T> v(n);
+    for (auto &x : v)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            switch (rng() % 4)
+            {
+            case 0:
+                x = static_cast<T>(std::uniform_real_distribution<double>(-300.0, 300.0)(rng));
+                break;
+            case 1:
+                x = static_cast<T>(std::uniform_real_distribution<double>(-1e6, 1e6)(rng));
+                break;
+            case 2:
+                x = static_cast<T>(static_cast<int>(rng() % 600) - 300) + T(0.5); // ちょうど中間(偶数への丸め)
+                break;
+            default:
+            {
+                const T special[] = {std::numeric_limits<T>::quiet_NaN(), std::numeric_limits<T>::infinity(),
+                                     -std::numeric_limits<T>::infinity(), T(32767.5), T(-32768.5), T(-0.0), T(255.49),
+                                     T(3e9), T(-3e9), T(2147483648.0), T(-2147483648.0), T(2147483520.0), T(1e19)};
+                x = special[rng() % std::size(special)];
+            }
+            }
+        }
+        else
+        {
+            switch (rng() % 3)
+            {
+            case 0:
+                x = static_cast<T>(static_cast<int>(rng() % 600) - 300);
+                break;
+            case 1:
+                x = static_cast<T>(static_cast<int>(rng() % 70000) - 35000);
+                break;
+            default:
+                x = static_cast<T>(rng());
+            }
+        }
+    }
+    return v;
+}
+
+/// @brief SIMD版がスカラー版(std::clamp)と同じ結果になるか、長さを変えて確かめる
+template <class To, class From>
+void check_saturate()
+{
+    const auto input = make_input<From>(1000, 1);
+    for (std::size_t n = 0; n <= input.size(); n += 13)
+    {
+        std::span<const From> in(input.data(), n);
+        std::vector<To> out(n + 1, To{42}), expected(n);
+        saturate::saturate_cast(in, std::span<To>(out));
+        for (std::size_t i = 0; i < n; i++)
+        {
+            if constexpr (std::is_floating_point_v<From>)
+                expected[i] = in[i] != in[i] ? To{0} : static_cast<To>(std::clamp<long double>(std::nearbyint(static_cast<long double>(in[i])), std::numeric_limits<To>::min(), std::numeric_limits<To>::max()));
+            else
+                expected[i] = static_cast<To>(std::clamp<std::int64_t>(in[i], std::numeric_limits<To>::min(), std::numeric_limits<To>::max()));
+            assert(out[i] == expected[i]);
+        }
+        assert(out[n] == To{42}); // 書きすぎていない
+    }
+}
+
+template <class T>
+void check_clamp(T lo, T hi)
+{
+    const auto input = make_input<T>(1000, 2);
+    for (std::size_t n = 0; n <= input.size(); n += 13)
+    {
+        std::vector<T> out(n);
+        saturate::clamp(std::span<const T>(input.data(), n), std::span<T>(out), lo, hi);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const auto e = std::clamp(input[i], lo, hi);
+            assert(out[i] == e || (e != e && out[i] != out[i])); // NaNはNaNのまま
+        }
+    }
+}
+
+/// @brief 1秒あたりの処理画素数[Gpixel/s]を表示する
+void report_gpixel(const char *name, double sec, double pixels)
+{
+    std::printf("  %-40s %10.3f Gpixel/s\n", name, pixels / sec / 1e9);
+}
+
+template <class To, class From>
+void run_saturate_benchmark(const char *title, const std::vector<From> &in)
+{
+    std::vector<To> out(in.size());
+    std::printf(" %s\n", title);
+    report_gpixel("scalar", bench::best_of(5, [&]
+                                            {
+                                                saturate::saturate_cast(std::span<const From>(in), std::span<To>(out), false);
+                                                bench::clobber_memory(); }),
+                  static_cast<double>(in.size()));
+    report_gpixel("simd", bench::best_of(5, [&]
+                                          {
+                                              saturate::saturate_cast(std::span<const From>(in), std::span<To>(out));
+                                              bench::clobber_memory(); }),
+                  static_cast<double>(in.size()));
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 1要素の変換(05-tips/01-clamp.cpp と同じ値)
+        static_assert(saturate::saturate_cast<std::uint8_t>(300) == 255);
+        static_assert(saturate::saturate_cast<std::uint8_t>(-5) == 0);
+        static_assert(saturate::saturate_cast<std::int16_t>(40000u) == 32767);
+        cout << int(saturate::saturate_cast<std::uint8_t>(127.5f)) << " " << saturate::saturate_cast<std::int16_t>(-1e9f) << endl; // 128 -32768
+
+        // 配列(画素)をまとめて
+        const std::int32_t pixels[] = {-20, 0, 128, 255, 256, 300, 70000, -70000};
+        std::uint8_t out[std::size(pixels)];
+        saturate::saturate_cast(std::span<const std::int32_t>(pixels), std::span<std::uint8_t>(out));
+        for (auto p : out)
+            cout << int(p) << " ";
+        cout << endl; // 0 0 128 255 255 255 255 0
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check_saturate<std::uint8_t, std::int32_t>();
+        check_saturate<std::int16_t, std::int32_t>();
+        check_saturate<std::uint8_t, std::int16_t>();
+        check_saturate<std::int16_t, float>();
+        check_saturate<std::uint8_t, float>();
+        check_saturate<std::int8_t, std::int64_t>(); // SIMD版のない組み合わせ
+        check_saturate<std::int32_t, float>();        // 最大値がfloatで正確に表せない組み合わせ
+        check_saturate<std::uint32_t, float>();
+        check_saturate<std::int64_t, double>();
+        assert(saturate::saturate_cast<std::int32_t>(3e9f) == std::numeric_limits<std::int32_t>::max());
+        assert(saturate::saturate_cast<std::int32_t>(-3e9f) == std::numeric_limits<std::int32_t>::min());
+        check_clamp<std::int32_t>(0, 255);
+        check_clamp<std::int16_t>(-1000, 1000);
+        check_clamp<float>(-1.0f, 1.0f);
+        cout << "simd == std::clamp: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 4Kの画像(3840x2160)4枚分
+        constexpr std::size_t count = 3840 * 2160 * 4;
+        const auto i32 = make_input<std::int32_t>(count, 3);
+        const auto i16 = make_input<std::int16_t>(count, 4);
+        const auto f32 = make_input<float>(count, 5);
+
+        run_saturate_benchmark<std::uint8_t>("int32 -> uint8", i32);
+        run_saturate_benchmark<std::int16_t>("int32 -> int16", i32);
+        run_saturate_benchmark<std::uint8_t>("int16 -> uint8", i16);
+        run_saturate_benchmark<std::int16_t>("float -> int16 (audio)", f32);
+        run_saturate_benchmark<std::uint8_t>("float -> uint8", f32);
+
+        std::vector<std::int32_t> out(count);
+        std::printf(" clamp int32 to [0, 255]\n");
+        report_gpixel("std::clamp", bench::best_of(5, [&]
+                                                   {
+                                                       saturate::clamp(std::span<const std::int32_t>(i32), std::span<std::int32_t>(out), 0, 255, false);
+                                                       bench::clobber_memory(); }),
+                      static_cast<double>(count));
+        report_gpixel("simd", bench::best_of(5, [&]
+                                             {
+                                                 saturate::clamp(std::span<const std::int32_t>(i32), std::span<std::int32_t>(out), 0, 255);
+                                                 bench::clobber_memory(); }),
+                      static_cast<double>(count));
+    }
+}
+
+// Q1: std::clamp のループもコンパイラが自動でベクトル化しないの？
+//   -> 同じ型のclampは -O2 (GCC12以降) でもベクトル化されることが多く、差は小さい。
+//      一方、小さい型への変換(飽和付きのpack)や、NaNと丸めを含むfloatからの変換は自動ではほとんどベクトル化されない
+// Q2: floatから整数への丸め方は？
+//   -> 既定の丸めモード(最も近い整数、中間なら偶数)。std::nearbyint と _mm_cvtps_epi32 は同じ丸めモードに従う。
+//      0.5を切り上げたい場合は、変換前に値をずらすか std::round を使う(遅くなる)
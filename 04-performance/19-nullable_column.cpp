@@ -0,0 +1,149 @@
+/// 無効値を持てる列
+// * 01_basic/07-optional.cpp の safe_divide() の結果を大量に持つとき、std::vector<std::optional<int>> と
+//   nullable_column.h (値の配列 + 有効ビット)のメモリ使用量と走査の速さを比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 19-nullable_column.cpp
+
+#include "bench.h"
+#include "nullable_column.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+/// @brief 07-optional.cpp と同じ
+std::optional<int> safe_divide(int a, int b)
+{
+    if (b == 0)
+        return std::nullopt;
+    return a / b;
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        columnar::nullable_column<int> results;
+        results.push_back(safe_divide(9, 3));
+        results.push_back(safe_divide(9, 0));
+        results.push_back(safe_divide(10, 5));
+        cout << "size: " << results.size() << ", nulls: " << results.null_count() << endl; // size: 3, nulls: 1
+        cout << "results[1].value_or(-1): " << results.value_or(1, -1) << endl;            // -1
+        results.for_each_valid([](std::size_t i, int v)
+                               { cout << "[" << i << "] " << v << " "; });
+        cout << endl; // [0] 3 [2] 2
+
+        cout << "sizeof(optional<int>): " << sizeof(std::optional<int>) << " bytes" << endl; // 8 bytes
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // std::vector<std::optional<int>> と同じ結果になるか確かめる(64要素の境界をまたぐ長さで)
+        std::mt19937 rng{1};
+        for (std::size_t n : {0, 1, 63, 64, 65, 200, 1000})
+        {
+            std::vector<std::optional<int>> expected(n);
+            for (auto &e : expected)
+                e = rng() % 4 == 0 ? std::nullopt : std::optional<int>(static_cast<int>(rng() % 1000) - 500);
+            // 全部有効・全部無効のブロックも作る
+            if (n >= 192)
+            {
+                std::fill(expected.begin(), expected.begin() + 64, 7);
+                std::fill(expected.begin() + 64, expected.begin() + 128, std::nullopt);
+            }
+            columnar::nullable_column<int> column{std::span<const std::optional<int>>(expected)};
+            if (n > 10)
+            {
+                column.set(5, std::nullopt);
+                expected[5] = std::nullopt;
+                column.set(6, 42);
+                expected[6] = 42;
+            }
+
+            std::vector<int> simd(n), scalar(n);
+            column.value_or(std::span<int>(simd), -1);
+            column.value_or(std::span<int>(scalar), -1, false);
+            long long sum = 0;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                assert(column[i] == expected[i]);
+                assert(simd[i] == expected[i].value_or(-1) && scalar[i] == simd[i]);
+                sum += expected[i].value_or(0);
+            }
+            assert(column.null_count() == static_cast<std::size_t>(std::count(expected.begin(), expected.end(), std::nullopt)));
+            assert(column.sum<long long>() == sum);
+        }
+        cout << "same as vector<optional<int>>: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 1000万回の割り算の結果(1割はゼロ除算)
+        constexpr std::size_t count = 10'000'000;
+        std::mt19937 rng{2};
+        std::vector<int> a(count), b(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            a[i] = static_cast<int>(rng() % 100000);
+            b[i] = rng() % 10 == 0 ? 0 : static_cast<int>(rng() % 100 + 1);
+        }
+
+        std::vector<std::optional<int>> optionals;
+        optionals.reserve(count);
+        columnar::nullable_column<int> column;
+        column.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            optionals.push_back(safe_divide(a[i], b[i]));
+            column.push_back(safe_divide(a[i], b[i]));
+        }
+
+        std::printf("  %-40s %10.1f MiB\n", "vector<optional<int>>", optionals.capacity() * sizeof(optionals[0]) / 1048576.0);
+        std::printf("  %-40s %10.1f MiB\n", "nullable_column<int>", column.memory_usage() / 1048576.0);
+
+        bench::report_ns("sum optional", bench::best_of(5, [&]
+                                                        {
+                                                            long long sum = 0;
+                                                            for (const auto &r : optionals)
+                                                                if (r)
+                                                                    sum += *r;
+                                                            bench::do_not_optimize(sum); }),
+                         count);
+        bench::report_ns("sum nullable_column", bench::best_of(5, [&]
+                                                               { bench::do_not_optimize(column.sum<long long>()); }),
+                         count);
+        bench::report_ns("null count optional", bench::best_of(5, [&]
+                                                               { bench::do_not_optimize(std::count(optionals.begin(), optionals.end(), std::nullopt)); }),
+                         count);
+        bench::report_ns("null count nullable_column", bench::best_of(5, [&]
+                                                                      { bench::do_not_optimize(column.null_count()); }),
+                         count);
+
+        std::vector<int> out(count);
+        bench::report_ns("value_or(-1) optional", bench::best_of(5, [&]
+                                                                 {
+                                                                     for (std::size_t i = 0; i < count; i++)
+                                                                         out[i] = optionals[i].value_or(-1);
+                                                                     bench::clobber_memory(); }),
+                         count);
+        bench::report_ns("value_or(-1) nullable_column, scalar", bench::best_of(5, [&]
+                                                                                {
+                                                                                    column.value_or(std::span<int>(out), -1, false);
+                                                                                    bench::clobber_memory(); }),
+                         count);
+        bench::report_ns("value_or(-1) nullable_column, simd", bench::best_of(5, [&]
+                                                                              {
+                                                                                  column.value_or(std::span<int>(out), -1);
+                                                                                  bench::clobber_memory(); }),
+                         count);
+    }
+}
+
+// Q1: 無効な位置の値を T{} にしておくのはなぜ？
+//   -> 総和のように「無効なら0として扱えばよい」処理は、有無を見ずに値の配列だけをSIMDで足せる。
+//      最大値・最小値のように T{} では困る処理は、for_each_block で有効ビットを見てから使う
+// Q2: std::optional<T> を返す関数の結果をそのまま入れられる？
+//   -> push_back(std::optional<T>) で入れられる。1要素を読むときも operator[] が std::optional<T> を返す
@@ -0,0 +1,182 @@
+/// 同じ数で大量に割る
+// * 01_basic/07-optional.cpp の safe_divide(a, b) を、大きな配列を少数の決まった数で割る処理に使う場合に、
+//   除算命令(/)と int_divisor.h (逆数を前計算して乗算とシフトにする)を比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 20-int_divisor.cpp
+// * 実行: ./a.out [要素数(既定 4000000)]
+
+#include "bench.h"
+#include "int_divisor.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+/// @brief 07-optional.cpp と同じ
+std::optional<int> safe_divide(int a, int b)
+{
+    if (b == 0)
+        return std::nullopt;
+    return a / b;
+}
+
+/// @brief 確かめる割る数(小さい数、2のべき乗とその前後、最大値・最小値付近、乱数)
+template <class T>
+std::vector<T> test_divisors(std::mt19937_64 &rng)
+{
+    using limits = std::numeric_limits<T>;
+    std::vector<T> ds;
+    for (int d = 0; d <= 300; d++)
+        ds.push_back(static_cast<T>(d));
+    for (int k = 2; k < static_cast<int>(sizeof(T) * 8); k++)
+        for (int delta = -1; delta <= 1; delta++)
+            ds.push_back(static_cast<T>((std::make_unsigned_t<T>{1} << k) + delta));
+    for (T d : {limits::max(), static_cast<T>(limits::max() - 1), limits::min(), static_cast<T>(limits::min() + 1)})
+        ds.push_back(d);
+    for (int i = 0; i < 200; i++)
+        ds.push_back(static_cast<T>(rng() >> (rng() % (sizeof(T) * 8)))); // 大きさをばらけさせる
+    if constexpr (std::is_signed_v<T>)
+    {
+        const auto n = ds.size();
+        for (std::size_t i = 0; i < n; i++)
+            if (ds[i] != limits::min())
+                ds.push_back(static_cast<T>(-ds[i]));
+    }
+    return ds;
+}
+
+/// @brief 割られる数(0付近、最大値・最小値付近、乱数)
+template <class T>
+std::vector<T> test_numerators(std::mt19937_64 &rng)
+{
+    using limits = std::numeric_limits<T>;
+    std::vector<T> ns;
+    for (int n = -50; n <= 50; n++)
+        ns.push_back(static_cast<T>(n));
+    for (int i = 0; i < 50; i++)
+    {
+        ns.push_back(static_cast<T>(limits::max() - i));
+        ns.push_back(static_cast<T>(limits::min() + i));
+    }
+    for (int i = 0; i < 300; i++)
+        ns.push_back(static_cast<T>(rng() >> (rng() % (sizeof(T) * 8))));
+    return ns;
+}
+
+/// @brief / と同じ結果になるか確かめる(0で割る、最小値を-1で割る場合は無効になること)
+template <class T>
+void check()
+{
+    std::mt19937_64 rng{sizeof(T) * 2 + std::is_signed_v<T>};
+    const auto numerators = test_numerators<T>(rng);
+    std::vector<T> simd(numerators.size()), scalar(numerators.size());
+    for (T d : test_divisors<T>(rng))
+    {
+        const fastdiv::divisor<T> divisor{d};
+        std::size_t valid = 0;
+        for (T n : numerators)
+        {
+            const auto q = divisor.try_divide(n);
+            const bool invalid = d == 0 || (std::is_signed_v<T> && d == T(-1) && n == std::numeric_limits<T>::min());
+            assert(q.has_value() == !invalid);
+            if (!invalid)
+            {
+                assert(*q == n / d);
+                valid++;
+            }
+        }
+        assert(fastdiv::divide(std::span<const T>(numerators), divisor, std::span<T>(simd), T{42}) == valid);
+        assert(fastdiv::divide(std::span<const T>(numerators), divisor, std::span<T>(scalar), T{42}, false) == valid);
+        for (std::size_t i = 0; i < numerators.size(); i++)
+        {
+            const auto q = divisor.try_divide(numerators[i]);
+            assert(simd[i] == q.value_or(T{42}) && scalar[i] == simd[i]);
+        }
+    }
+}
+
+template <class T>
+void run_benchmark(const char *title, std::size_t count, std::mt19937_64 &rng)
+{
+    std::vector<T> in(count), out(count);
+    for (auto &x : in)
+        x = static_cast<T>(rng());
+    // 割る数は実行時に決まる(コンパイラが定数として最適化できない)
+    const T d = static_cast<T>(rng() % 1000 + 3);
+    const fastdiv::divisor<T> divisor{d};
+
+    std::printf(" %s / %lld\n", title, static_cast<long long>(d));
+    bench::report_ns("operator/", bench::best_of(5, [&]
+                                                 {
+                                                     for (std::size_t i = 0; i < count; i++)
+                                                         out[i] = in[i] / d;
+                                                     bench::clobber_memory(); }),
+                     count);
+    bench::report_ns("divisor, scalar", bench::best_of(5, [&]
+                                                       {
+                                                           fastdiv::divide(std::span<const T>(in), divisor, std::span<T>(out), T{}, false);
+                                                           bench::clobber_memory(); }),
+                     count);
+    bench::report_ns("divisor, simd", bench::best_of(5, [&]
+                                                     {
+                                                         fastdiv::divide(std::span<const T>(in), divisor, std::span<T>(out));
+                                                         bench::clobber_memory(); }),
+                     count);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        const fastdiv::divisor<int> by7{7};
+        cout << 100 / by7 << " " << -100 / by7 << endl; // 14 -14
+
+        // safe_divide と同じく、割れなければ std::nullopt
+        const fastdiv::divisor<int> by0{0};
+        cout << safe_divide(9, 0).value_or(-1) << " " << by0.try_divide(9).value_or(-1) << endl; // -1 -1
+        cout << fastdiv::divisor<int>{-1}.try_divide(std::numeric_limits<int>::min()).has_value() << endl; // 0
+
+        // 配列をまとめて割る。割れない要素はfallback(-1)にして、割れた要素の数を返す
+        const int a[] = {10, 20, 30, -40};
+        int out[std::size(a)];
+        cout << fastdiv::divide(std::span<const int>(a), fastdiv::divisor<int>{3}, std::span<int>(out), -1) << ": "; // 4
+        for (auto q : out)
+            cout << q << " ";
+        cout << endl; // 3 6 10 -13
+        cout << fastdiv::divide(std::span<const int>(a), by0, std::span<int>(out), -1) << ": "; // 0
+        for (auto q : out)
+            cout << q << " ";
+        cout << endl; // -1 -1 -1 -1
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check<std::int32_t>();
+        check<std::uint32_t>();
+        check<std::int64_t>();
+        check<std::uint64_t>();
+        cout << "same as operator/: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4'000'000;
+        std::mt19937_64 rng{1};
+        run_benchmark<std::int32_t>("int32", count, rng);
+        run_benchmark<std::uint32_t>("uint32", count, rng);
+        run_benchmark<std::int64_t>("int64", count, rng);
+        run_benchmark<std::uint64_t>("uint64", count, rng);
+    }
+}
+
+// Q1: 割る数が定数なら？
+//   -> コンパイラが同じ変換(乗算とシフト)をするので、divisor を使う必要はない。
+//      divisor が役に立つのは、割る数が実行時に決まり、同じ数で何度も割る場合
+// Q2: 割る数を作るコストは？
+//   -> 除算1回(64bitは128bitの除算)程度。数回しか割らないなら / のほうが速い
+// Q3: 64bitのSIMD版がないのはなぜ？
+//   -> AVX2には64bit×64bitの積の上位を求める命令がない。スカラーでも乗算(mul)は除算(div)よりずっと速い
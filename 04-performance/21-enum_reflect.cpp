@@ -0,0 +1,371 @@
+/// 列挙子の名前と文字列の相互変換
+// * 01_basic/03-scoped_enum.cpp の Diretion / Status / ScopedColor を enum_reflect.h で名前にし、
+//   プロトコルのヘッダ名のような列挙型で、手書きの switch / if と std::unordered_map の変換と速さを比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 21-enum_reflect.cpp
+
+#include "bench.h"
+#include "enum_reflect.h"
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 03-scoped_enum.cpp と同じ
+enum struct ScopedColor
+{
+    red,
+    green = 1,
+    blue
+};
+
+enum class Diretion
+{
+    up,
+    down,
+    left,
+    right
+};
+
+enum class Status : std::uint8_t
+{
+    good,
+    bad = 127
+};
+
+// 基になる型が32bit以上でも、既定では[0, 255](符号付きなら[-128, 127])から探す
+enum class Permission : std::uint32_t
+{
+    read = 1,
+    write = 2,
+    execute = 4,
+    all = 0xFFFFFFFF // 範囲外なので名前にならない
+};
+
+enum class Offset : std::int64_t
+{
+    begin = -1,
+    end = 1
+};
+
+// 基になる型を指定しない古い enum は範囲を指定する
+enum Color
+{
+    red,
+    green,
+    blue = 2
+};
+
+template <>
+struct enum_reflect::enum_range<Color>
+{
+    static constexpr int min = 0;
+    static constexpr int max = 3;
+};
+
+// HTTPのヘッダ名(を識別子にしたもの)
+enum class header : std::uint8_t
+{
+    accept,
+    accept_encoding,
+    accept_language,
+    authorization,
+    cache_control,
+    connection,
+    content_encoding,
+    content_length,
+    content_type,
+    cookie,
+    date,
+    etag,
+    expires,
+    host,
+    if_modified_since,
+    if_none_match,
+    last_modified,
+    location,
+    origin,
+    referer,
+    server,
+    set_cookie,
+    transfer_encoding,
+    upgrade,
+    user_agent,
+    vary,
+    via,
+};
+
+/// @brief 手書きの switch
+std::string_view to_string_switch(header h) noexcept
+{
+    switch (h)
+    {
+    case header::accept:
+        return "accept";
+    case header::accept_encoding:
+        return "accept_encoding";
+    case header::accept_language:
+        return "accept_language";
+    case header::authorization:
+        return "authorization";
+    case header::cache_control:
+        return "cache_control";
+    case header::connection:
+        return "connection";
+    case header::content_encoding:
+        return "content_encoding";
+    case header::content_length:
+        return "content_length";
+    case header::content_type:
+        return "content_type";
+    case header::cookie:
+        return "cookie";
+    case header::date:
+        return "date";
+    case header::etag:
+        return "etag";
+    case header::expires:
+        return "expires";
+    case header::host:
+        return "host";
+    case header::if_modified_since:
+        return "if_modified_since";
+    case header::if_none_match:
+        return "if_none_match";
+    case header::last_modified:
+        return "last_modified";
+    case header::location:
+        return "location";
+    case header::origin:
+        return "origin";
+    case header::referer:
+        return "referer";
+    case header::server:
+        return "server";
+    case header::set_cookie:
+        return "set_cookie";
+    case header::transfer_encoding:
+        return "transfer_encoding";
+    case header::upgrade:
+        return "upgrade";
+    case header::user_agent:
+        return "user_agent";
+    case header::vary:
+        return "vary";
+    case header::via:
+        return "via";
+    }
+    return {};
+}
+
+/// @brief 手書きの if の連なり(文字列では switch できないので、よくある書き方)
+std::optional<header> from_string_if(std::string_view s) noexcept
+{
+    if (s == "accept")
+        return header::accept;
+    if (s == "accept_encoding")
+        return header::accept_encoding;
+    if (s == "accept_language")
+        return header::accept_language;
+    if (s == "authorization")
+        return header::authorization;
+    if (s == "cache_control")
+        return header::cache_control;
+    if (s == "connection")
+        return header::connection;
+    if (s == "content_encoding")
+        return header::content_encoding;
+    if (s == "content_length")
+        return header::content_length;
+    if (s == "content_type")
+        return header::content_type;
+    if (s == "cookie")
+        return header::cookie;
+    if (s == "date")
+        return header::date;
+    if (s == "etag")
+        return header::etag;
+    if (s == "expires")
+        return header::expires;
+    if (s == "host")
+        return header::host;
+    if (s == "if_modified_since")
+        return header::if_modified_since;
+    if (s == "if_none_match")
+        return header::if_none_match;
+    if (s == "last_modified")
+        return header::last_modified;
+    if (s == "location")
+        return header::location;
+    if (s == "origin")
+        return header::origin;
+    if (s == "referer")
+        return header::referer;
+    if (s == "server")
+        return header::server;
+    if (s == "set_cookie")
+        return header::set_cookie;
+    if (s == "transfer_encoding")
+        return header::transfer_encoding;
+    if (s == "upgrade")
+        return header::upgrade;
+    if (s == "user_agent")
+        return header::user_agent;
+    if (s == "vary")
+        return header::vary;
+    if (s == "via")
+        return header::via;
+    return std::nullopt;
+}
+
+// コンパイル時に変換できる
+static_assert(enum_reflect::count<header> == 27);
+static_assert(enum_reflect::to_string(header::content_type) == "content_type");
+static_assert(enum_reflect::from_string<header>("user_agent") == header::user_agent);
+static_assert(!enum_reflect::from_string<header>("x_forwarded_for"));
+static_assert(enum_reflect::to_string(static_cast<Status>(5)).empty());
+static_assert(enum_reflect::count<Permission> == 3 && enum_reflect::to_string(Permission::execute) == "execute");
+static_assert(enum_reflect::to_string(Permission::all).empty());
+static_assert(enum_reflect::from_string<Offset>("begin") == Offset::begin);
+
+// 1バイトの命令コードのように列挙子が多くても(ここでは256個の op_00～op_ff)表を作れる
+#define OPCODES_16(p) p##0, p##1, p##2, p##3, p##4, p##5, p##6, p##7, p##8, p##9, p##a, p##b, p##c, p##d, p##e, p##f
+enum class opcode : std::uint8_t
+{
+    OPCODES_16(op_0), OPCODES_16(op_1), OPCODES_16(op_2), OPCODES_16(op_3),
+    OPCODES_16(op_4), OPCODES_16(op_5), OPCODES_16(op_6), OPCODES_16(op_7),
+    OPCODES_16(op_8), OPCODES_16(op_9), OPCODES_16(op_a), OPCODES_16(op_b),
+    OPCODES_16(op_c), OPCODES_16(op_d), OPCODES_16(op_e), OPCODES_16(op_f)
+};
+#undef OPCODES_16
+
+static_assert(enum_reflect::count<opcode> == 256);
+static_assert([]
+              {
+                  for (auto op : enum_reflect::values<opcode>)
+                      if (enum_reflect::from_string<opcode>(enum_reflect::to_string(op)) != op)
+                          return false;
+                  return !enum_reflect::from_string<opcode>("op_100");
+              }());
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // static_cast<int> せずに名前で表示できる
+        for (auto d : enum_reflect::values<Diretion>)
+            cout << enum_reflect::to_string(d) << "=" << static_cast<int>(d) << " ";
+        cout << endl; // up=0 down=1 left=2 right=3
+
+        for (auto s : enum_reflect::values<Status>)
+            cout << enum_reflect::to_string(s) << "=" << int(enum_reflect::to_underlying(s)) << " ";
+        cout << endl; // good=0 bad=127
+
+        for (auto name : enum_reflect::names<ScopedColor>)
+            cout << name << " ";
+        cout << endl; // red green blue
+        cout << enum_reflect::to_string(blue) << endl; // blue
+
+        // 文字列から(見つからなければ std::nullopt)
+        const auto d = enum_reflect::from_string<Diretion>("left");
+        cout << (d == Diretion::left) << " " << enum_reflect::from_string<Diretion>("Left").has_value() << endl; // 1 0
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 手書きの変換と同じ結果になるか確かめる
+        for (auto h : enum_reflect::values<header>)
+        {
+            const auto name = enum_reflect::to_string(h);
+            assert(name == to_string_switch(h));
+            assert(enum_reflect::from_string<header>(name) == h);
+            assert(enum_reflect::index_of(h) == static_cast<std::size_t>(h));
+            for (std::size_t n = 0; n < name.size(); n++)
+                assert(enum_reflect::from_string<header>(name.substr(0, n)) == from_string_if(name.substr(0, n))); // 途中まで
+        }
+        assert(!enum_reflect::from_string<header>(""));
+        cout << "same as switch: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 100万個のヘッダ名(1割は知らない名前)
+        constexpr std::size_t count = 1'000'000;
+        const std::string unknown[] = {"x_request_id", "dnt", "x_forwarded_for", "pragma", "range"};
+        std::mt19937 rng{1};
+        std::vector<std::string> texts(count);
+        std::vector<header> headers(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            headers[i] = enum_reflect::values<header>[rng() % enum_reflect::count<header>];
+            texts[i] = rng() % 10 == 0 ? unknown[rng() % std::size(unknown)] : std::string(enum_reflect::to_string(headers[i]));
+        }
+
+        std::unordered_map<std::string_view, header> by_name;
+        std::unordered_map<header, std::string_view> by_value;
+        for (auto h : enum_reflect::values<header>)
+        {
+            by_name.emplace(to_string_switch(h), h);
+            by_value.emplace(h, to_string_switch(h));
+        }
+
+        cout << " to_string" << endl;
+        bench::report_ns("switch", bench::best_of(5, [&]
+                                                  {
+                                                      std::size_t n = 0;
+                                                      for (auto h : headers)
+                                                          n += to_string_switch(h).size();
+                                                      bench::do_not_optimize(n); }),
+                         count);
+        bench::report_ns("unordered_map", bench::best_of(5, [&]
+                                                         {
+                                                             std::size_t n = 0;
+                                                             for (auto h : headers)
+                                                                 n += by_value.find(h)->second.size();
+                                                             bench::do_not_optimize(n); }),
+                         count);
+        bench::report_ns("enum_reflect", bench::best_of(5, [&]
+                                                        {
+                                                            std::size_t n = 0;
+                                                            for (auto h : headers)
+                                                                n += enum_reflect::to_string(h).size();
+                                                            bench::do_not_optimize(n); }),
+                         count);
+
+        cout << " from_string" << endl;
+        bench::report_ns("if", bench::best_of(5, [&]
+                                              {
+                                                  unsigned n = 0;
+                                                  for (const auto &t : texts)
+                                                      n += from_string_if(t).has_value();
+                                                  bench::do_not_optimize(n); }),
+                         count);
+        bench::report_ns("unordered_map", bench::best_of(5, [&]
+                                                         {
+                                                             unsigned n = 0;
+                                                             for (const auto &t : texts)
+                                                                 n += by_name.count(t);
+                                                             bench::do_not_optimize(n); }),
+                         count);
+        bench::report_ns("enum_reflect", bench::best_of(5, [&]
+                                                        {
+                                                            unsigned n = 0;
+                                                            for (const auto &t : texts)
+                                                                n += enum_reflect::from_string<header>(t).has_value();
+                                                            bench::do_not_optimize(n); }),
+                         count);
+    }
+}
+
+// Q1: どんな列挙型でも使える？
+//   -> 値が enum_range の範囲(既定で[-128, 127]または[0, 255])にある列挙子だけが見つかる。
+//      フラグのように大きな値を使う列挙型は範囲を特殊化する(範囲を広げるほどコンパイルが遅くなる)
+// Q2: 名前はどこに置かれる？
+//   -> コンパイル時に作った char の配列(静的な定数)。to_string が返す string_view はプログラムの終わりまで有効
+// Q3: C++26 では？
+//   -> 静的リフレクション(^^E と std::meta::enumerators_of)で、__PRETTY_FUNCTION__ を解析せずに同じことができる
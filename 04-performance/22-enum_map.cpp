@@ -0,0 +1,238 @@
+/// 列挙型をキーにした表と集合
+// * 01_basic/03-scoped_enum.cpp の Status / Diretion ごとの表を enum_map.h の enum_map / enum_set で持ち、
+//   std::map / std::set と速さを比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 22-enum_map.cpp
+
+#include "bench.h"
+#include "enum_map.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// 03-scoped_enum.cpp と同じ
+enum class Diretion
+{
+    up,
+    down,
+    left,
+    right
+};
+
+enum class Status : std::uint8_t
+{
+    good,
+    bad = 127
+};
+
+// 21-enum_reflect.cpp と同じHTTPのヘッダ名
+enum class header : std::uint8_t
+{
+    accept,
+    accept_encoding,
+    accept_language,
+    authorization,
+    cache_control,
+    connection,
+    content_encoding,
+    content_length,
+    content_type,
+    cookie,
+    date,
+    etag,
+    expires,
+    host,
+    if_modified_since,
+    if_none_match,
+    last_modified,
+    location,
+    origin,
+    referer,
+    server,
+    set_cookie,
+    transfer_encoding,
+    upgrade,
+    user_agent,
+    vary,
+    via,
+};
+
+// コンパイル時に表を作れる
+constexpr enum_reflect::enum_map<Diretion, int> dx{{Diretion::left, -1}, {Diretion::right, 1}};
+constexpr enum_reflect::enum_map<Diretion, int> dy{{Diretion::up, -1}, {Diretion::down, 1}};
+static_assert(dx[Diretion::left] == -1 && dy[Diretion::left] == 0);
+
+constexpr enum_reflect::enum_set<Diretion> horizontal{Diretion::left, Diretion::right};
+static_assert((~horizontal).contains(Diretion::up) && (~horizontal).size() == 2);
+static_assert(sizeof(enum_reflect::enum_set<header>) == 8);
+// 列挙子でない値(受け取ったバイト列をキャストしたものなど)は含まれない
+static_assert(!(~horizontal).contains(static_cast<Diretion>(4)) && !(~horizontal).contains(static_cast<Diretion>(-1)));
+static_assert(!(~enum_reflect::enum_set<header>{}).contains(static_cast<header>(200)));
+
+/// @brief std::map / std::set と同じ結果になるか、ランダムな操作で確かめる
+template <class E>
+void check(std::uint32_t seed)
+{
+    const auto &keys = enum_reflect::values<E>;
+    std::mt19937 rng{seed};
+    enum_reflect::enum_map<E, int> map;
+    std::map<E, int> expected_map;
+    enum_reflect::enum_set<E> set, other;
+    std::set<E> expected_set, expected_other;
+    for (int i = 0; i < 10000; i++)
+    {
+        const auto key = keys[rng() % keys.size()];
+        const int value = static_cast<int>(rng() % 100);
+        map[key] += value;
+        expected_map[key] += value;
+        switch (rng() % 3)
+        {
+        case 0:
+            assert(set.insert(key) == expected_set.insert(key).second);
+            break;
+        case 1:
+            assert(set.erase(key) == (expected_set.erase(key) == 1));
+            break;
+        default:
+            other.insert(key);
+            expected_other.insert(key);
+        }
+        assert(set.contains(key) == expected_set.contains(key));
+        assert(set.size() == expected_set.size());
+        assert(std::equal(set.begin(), set.end(), expected_set.begin(), expected_set.end())); // 同じ順
+        if (i % 100 == 0)
+        {
+            std::set<E> u(expected_set), n, d;
+            u.insert(expected_other.begin(), expected_other.end());
+            std::set_intersection(expected_set.begin(), expected_set.end(), expected_other.begin(), expected_other.end(), std::inserter(n, n.end()));
+            std::set_difference(expected_set.begin(), expected_set.end(), expected_other.begin(), expected_other.end(), std::inserter(d, d.end()));
+            const auto su = set | other, sn = set & other, sd = set - other;
+            assert(std::equal(su.begin(), su.end(), u.begin(), u.end()));
+            assert(std::equal(sn.begin(), sn.end(), n.begin(), n.end()));
+            assert(std::equal(sd.begin(), sd.end(), d.begin(), d.end()));
+            assert((set | other).includes(set) && (set ^ other) == (su - sn));
+            other.clear();
+            expected_other.clear();
+        }
+    }
+    for (auto [key, value] : map)
+        assert(value == expected_map[key]);
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        // 状態ごとの表(std::map<Status, std::string> の代わり)
+        enum_reflect::enum_map<Status, std::string> messages{{Status::good, "ok"}, {Status::bad, "error"}};
+        for (const auto &[status, message] : messages)
+            cout << enum_reflect::to_string(status) << ": " << message << endl; // good: ok / bad: error
+        cout << "sizeof: " << sizeof(messages) << " bytes (std::string x 2)" << endl;
+
+        // 列挙子でない値は at が例外を投げる
+        try
+        {
+            messages.at(static_cast<Status>(5));
+        }
+        catch (const std::out_of_range &e)
+        {
+            cout << e.what() << endl;
+        }
+
+        // 方向ごとの移動量と、方向の集合
+        int x = 0, y = 0;
+        for (auto d : {Diretion::up, Diretion::left, Diretion::left, Diretion::down})
+        {
+            x += dx[d];
+            y += dy[d];
+        }
+        cout << "x, y: " << x << ", " << y << endl; // -2, 0
+
+        enum_reflect::enum_set<Diretion> pressed{Diretion::up, Diretion::right};
+        for (auto d : pressed & horizontal)
+            cout << enum_reflect::to_string(d) << " ";
+        cout << endl; // right
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check<Diretion>(1);
+        check<Status>(2); // 値が飛んでいる列挙型
+        check<header>(3);
+        cout << "same as std::map / std::set: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // 100万件のリクエスト。それぞれ8個のヘッダを持つ(重複もある)
+        constexpr std::size_t count = 1'000'000;
+        constexpr auto n = enum_reflect::count<header>;
+        std::mt19937 rng{4};
+        std::vector<header> events(count * 8);
+        for (auto &e : events)
+            e = enum_reflect::values<header>[rng() % n];
+
+        cout << " count by header" << endl;
+        bench::report_ns("std::map", bench::best_of(5, [&]
+                                                    {
+                                                        std::map<header, int> counts;
+                                                        for (auto e : events)
+                                                            counts[e]++;
+                                                        bench::do_not_optimize(counts); }),
+                         static_cast<double>(events.size()));
+        bench::report_ns("enum_map", bench::best_of(5, [&]
+                                                    {
+                                                        enum_reflect::enum_map<header, int> counts;
+                                                        for (auto e : events)
+                                                            counts[e]++;
+                                                        bench::do_not_optimize(counts); }),
+                         static_cast<double>(events.size()));
+
+        // 各リクエストのヘッダの集合を作り、必須のヘッダが揃っているか調べ、全体の和集合を求める
+        const std::set<header> required_set{header::host, header::user_agent};
+        constexpr enum_reflect::enum_set<header> required{header::host, header::user_agent};
+        cout << " header set per request (insert x8, includes, union)" << endl;
+        bench::report_ns("std::set", bench::best_of(5, [&]
+                                                    {
+                                                        std::set<header> seen_all;
+                                                        std::size_t complete = 0;
+                                                        for (std::size_t r = 0; r < count; r++)
+                                                        {
+                                                            std::set<header> s(events.begin() + r * 8, events.begin() + r * 8 + 8);
+                                                            complete += std::includes(s.begin(), s.end(), required_set.begin(), required_set.end());
+                                                            seen_all.insert(s.begin(), s.end());
+                                                        }
+                                                        bench::do_not_optimize(complete);
+                                                        bench::do_not_optimize(seen_all); }),
+                         count);
+        bench::report_ns("enum_set", bench::best_of(5, [&]
+                                                    {
+                                                        enum_reflect::enum_set<header> seen_all;
+                                                        std::size_t complete = 0;
+                                                        for (std::size_t r = 0; r < count; r++)
+                                                        {
+                                                            enum_reflect::enum_set<header> s;
+                                                            for (std::size_t i = r * 8; i < r * 8 + 8; i++)
+                                                                s.insert(events[i]);
+                                                            complete += s.includes(required);
+                                                            seen_all |= s;
+                                                        }
+                                                        bench::do_not_optimize(complete);
+                                                        bench::do_not_optimize(seen_all); }),
+                         count);
+    }
+}
+
+// Q1: std::array<T, N> に static_cast<std::size_t>(key) で添字を付けるのと何が違う？
+//   -> 値が0から連続していれば同じ(enum_map もその場合は引き算だけ)。値が飛んでいる(Status::bad = 127)場合も
+//      列挙子の数の大きさで済み、列挙子の追加でNを直し忘れることもない
+// Q2: 列挙子が多い(数百)場合は？
+//   -> enum_set は64要素ごとに uint64_t が1つ増えるだけ。enum_map は列挙子の数 × sizeof(T) になるので、
+//      ほとんどのキーが使われない表なら std::map や flat_hash_map のほうが小さい
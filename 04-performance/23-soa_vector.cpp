@@ -0,0 +1,189 @@
+/// 色の配列をチャンネルごとの配列で持つ
+// * 01_basic/03-scoped_enum.cpp の get_rgb() が返す (r, g, b) を大量に持つとき、
+//   構造体の配列(std::vector<rgb>)と soa_vector.h の soa_vector<int, int, int> で、
+//   1チャンネルだけを処理する場合と全チャンネルを処理する場合の速さを比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 23-soa_vector.cpp
+// * 実行: ./a.out [画素数(既定 4000000)]
+
+#include "bench.h"
+#include "soa_vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/// @brief 03-scoped_enum.cpp と同じ
+std::tuple<int, int, int> get_rgb()
+{
+    return std::make_tuple(38, 64, 47);
+}
+
+struct rgb
+{
+    int r, g, b;
+    friend bool operator==(const rgb &, const rgb &) = default;
+};
+
+/// @brief std::vector<std::tuple> と同じ結果になるか、ランダムな操作で確かめる
+void check()
+{
+    std::mt19937 rng{1};
+    soa::soa_vector<int, std::string, std::uint8_t> v; // ムーブで中身が移る型も混ぜる
+    std::vector<std::tuple<int, std::string, std::uint8_t>> expected;
+    for (int i = 0; i < 20000; i++)
+    {
+        switch (rng() % 8)
+        {
+        case 0:
+            if (!v.empty())
+            {
+                v.pop_back();
+                expected.pop_back();
+            }
+            break;
+        case 1:
+        {
+            const auto n = rng() % (v.size() + 10);
+            v.resize(n);
+            expected.resize(n);
+            break;
+        }
+        default:
+        {
+            const int x = static_cast<int>(rng());
+            auto s = std::string(rng() % 40, 'a' + static_cast<char>(x & 7)); // 長い文字列はヒープに置かれる
+            const auto b = static_cast<std::uint8_t>(x);
+            expected.emplace_back(x, s, b);
+            v.emplace_back(x, std::move(s), b);
+        }
+        }
+        assert(v.size() == expected.size());
+        if (!v.empty())
+            assert(v.back() == expected.back());
+    }
+    const auto copy = v;
+    assert(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+    // 各列の先頭はキャッシュライン境界
+    assert(reinterpret_cast<std::uintptr_t>(v.column<0>().data()) % 64 == 0);
+    assert(reinterpret_cast<std::uintptr_t>(v.column<1>().data()) % 64 == 0);
+    assert(reinterpret_cast<std::uintptr_t>(v.column<2>().data()) % 64 == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        soa::soa_vector<int, int, int> colors;
+        colors.push_back(get_rgb());
+        colors.emplace_back(255, 128, 0);
+
+        // 構造化束縛で分解できる。r, g, b は要素への参照
+        auto [r, g, b] = colors[0];
+        cout << "r/g/b : " << r << "/" << g << "/" << b << endl; // 38/64/47
+        r = 100;
+        cout << "colors[0] r: " << std::get<0>(colors[0]) << endl; // 100
+
+        // 値として取り出すときは tuple<int, int, int> へ変換する
+        std::tuple<int, int, int> copy = colors[1];
+        std::get<0>(copy) = 0; // コンテナの中身は変わらない
+        for (auto [r2, g2, b2] : colors)
+            cout << r2 << "/" << g2 << "/" << b2 << " ";
+        cout << endl; // 100/64/47 255/128/0
+
+        // チャンネルごとの配列
+        for (int &red : colors.column<0>())
+            red /= 2;
+        cout << "red: " << colors.column<0>()[0] << ", " << colors.column<0>()[1] << endl; // 50, 127
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check();
+        cout << "same as vector<tuple>: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4'000'000;
+        std::mt19937 rng{2};
+        std::vector<rgb> aos(count);
+        soa::soa_vector<int, int, int> soa(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            aos[i] = {static_cast<int>(rng() % 256), static_cast<int>(rng() % 256), static_cast<int>(rng() % 256)};
+            soa[i] = std::tuple{aos[i].r, aos[i].g, aos[i].b};
+        }
+        const auto channel_bytes = static_cast<double>(count * sizeof(int));
+
+        // 1チャンネルだけを読み書きする(赤を明るくする)
+        cout << " brighten red (read+write 1 channel)" << endl;
+        bench::report_gbps("vector<rgb>", bench::best_of(5, [&]
+                                                         {
+                                                             for (auto &p : aos)
+                                                                 p.r = std::min(p.r + 10, 255);
+                                                             bench::clobber_memory(); }),
+                           channel_bytes * 2);
+        bench::report_gbps("soa_vector", bench::best_of(5, [&]
+                                                        {
+                                                            for (int &r : soa.column<0>())
+                                                                r = std::min(r + 10, 255);
+                                                            bench::clobber_memory(); }),
+                           channel_bytes * 2);
+
+        // 1チャンネルだけを読む(緑の合計)
+        cout << " sum green (read 1 channel)" << endl;
+        bench::report_gbps("vector<rgb>", bench::best_of(5, [&]
+                                                         {
+                                                             long long sum = 0;
+                                                             for (const auto &p : aos)
+                                                                 sum += p.g;
+                                                             bench::do_not_optimize(sum); }),
+                           channel_bytes);
+        bench::report_gbps("soa_vector", bench::best_of(5, [&]
+                                                        {
+                                                            long long sum = 0;
+                                                            for (int g : soa.column<1>())
+                                                                sum += g;
+                                                            bench::do_not_optimize(sum); }),
+                           channel_bytes);
+
+        // 全チャンネルを読む(グレースケール)。読む量は同じで、差はSIMDにしやすいかどうかだけ
+        std::vector<int> gray(count);
+        cout << " grayscale (read 3 channels, write 1)" << endl;
+        bench::report_gbps("vector<rgb>", bench::best_of(5, [&]
+                                                         {
+                                                             for (std::size_t i = 0; i < count; i++)
+                                                                 gray[i] = (aos[i].r * 77 + aos[i].g * 150 + aos[i].b * 29) >> 8;
+                                                             bench::clobber_memory(); }),
+                           channel_bytes * 4);
+        bench::report_gbps("soa_vector", bench::best_of(5, [&]
+                                                        {
+                                                            const auto r = soa.column<0>(), g = soa.column<1>(), b = soa.column<2>();
+                                                            for (std::size_t i = 0; i < count; i++)
+                                                                gray[i] = (r[i] * 77 + g[i] * 150 + b[i] * 29) >> 8;
+                                                            bench::clobber_memory(); }),
+                           channel_bytes * 4);
+        bench::report_gbps("soa_vector, operator[]", bench::best_of(5, [&]
+                                                                    {
+                                                                        for (std::size_t i = 0; i < count; i++)
+                                                                        {
+                                                                            const auto [r, g, b] = soa[i];
+                                                                            gray[i] = (r * 77 + g * 150 + b * 29) >> 8;
+                                                                        }
+                                                                        bench::clobber_memory(); }),
+                           channel_bytes * 4);
+    }
+}
+
+// Q1: 構造体の配列(AoS)とどちらを使うべき？
+//   -> 多くの処理が一部のメンバーだけを触るならSoA。いつも全メンバーを一緒に使う(1要素ずつ取り出して渡す)ならAoSで十分。
+//      SoAは列ごとにSIMDで処理しやすい(saturate.h の clamp に column<0>() をそのまま渡せる)
+// Q2: v[i] が本物の参照でないと困ることは？
+//   -> auto& r = v[i] と書けない(一時オブジェクトなので auto か auto&& で受ける)。
+//      要素を入れ替えるアルゴリズム(std::sort など)は使えないので、並べ替えは添字の配列を作ってから行う
@@ -0,0 +1,239 @@
+/// 多数の購読者へイベントを配る
+// * 01_basic/04-lambda.cpp の function_with_callback のようにコールバックを1つ受けるのではなく、
+//   数百の購読者へ同じイベントを配る場合に、std::vector<std::function<void(int)>> と
+//   event_dispatcher.h の dispatcher<void(int)> (購読者のキャプチャを1本の配列に並べる)を比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native 24-event_dispatcher.cpp
+
+#include "bench.h"
+#include "event_dispatcher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/// @brief 購読者の中から、ほかの購読者を外したり新しい購読者をつないだりする
+struct harness
+{
+    events::dispatcher<void(int)> d;
+    std::vector<events::connection> connections; // 購読者の番号ごとの接続
+    std::vector<int> log;                         // 呼ばれた購読者の番号
+
+    void add()
+    {
+        const int who = static_cast<int>(connections.size());
+        connections.emplace_back();
+        connections[who] = d.connect([this, who](int x)
+                                     { on_event(who, x); });
+    }
+
+    void on_event(int who, int x)
+    {
+        log.push_back(who);
+        if (who % 5 == 0 && who + 1 < static_cast<int>(connections.size()))
+            d.disconnect(connections[who + 1]);
+        if (who % 7 == 0 && x == 3 && connections.size() < 500)
+            add();
+    }
+};
+
+/// @brief harness と同じ規則で動く素朴な実装(配り始めたときの購読者を順に呼び、途中でつないだものは後で加える)
+struct model
+{
+    std::vector<int> order;
+    std::vector<bool> alive;
+    std::vector<int> log;
+
+    void add()
+    {
+        order.push_back(static_cast<int>(alive.size()));
+        alive.push_back(true);
+    }
+
+    void emit(int x)
+    {
+        std::vector<int> added;
+        const std::size_t n = order.size();
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const int who = order[i];
+            if (!alive[who])
+                continue;
+            log.push_back(who);
+            if (who % 5 == 0 && who + 1 < static_cast<int>(alive.size()))
+                alive[who + 1] = false;
+            if (who % 7 == 0 && x == 3 && alive.size() < 500)
+            {
+                added.push_back(static_cast<int>(alive.size()));
+                alive.push_back(true);
+            }
+        }
+        std::erase_if(order, [&](int who)
+                      { return !alive[who]; });
+        for (int who : added)
+            if (alive[who])
+                order.push_back(who);
+    }
+};
+
+/// @brief ランダムな接続・切断(配っている最中のものも含む)で、呼ばれた購読者の順が素朴な実装と同じか確かめる
+void check()
+{
+    std::mt19937 rng{1};
+    harness h;
+    model m;
+    for (int step = 0; step < 5000; step++)
+    {
+        switch (rng() % 4)
+        {
+        case 0:
+            h.add();
+            m.add();
+            break;
+        case 1:
+            if (!m.alive.empty())
+            {
+                const auto who = rng() % m.alive.size();
+                assert(h.d.disconnect(h.connections[who]) == m.alive[who]);
+                assert(!h.d.connected(h.connections[who]));
+                m.alive[who] = false;
+                std::erase(m.order, static_cast<int>(who));
+            }
+            break;
+        default:
+        {
+            const int x = static_cast<int>(rng() % 10);
+            h.d.emit(x);
+            m.emit(x);
+            assert(h.log == m.log);
+            if (x == 5) // イベントの配列で配っても、購読者ごとの呼ばれ方は同じ
+            {
+                const int xs[] = {1, 2};
+                h.d.emit_each(std::span<const int>(xs));
+                m.emit(1);
+                m.emit(2);
+                std::sort(h.log.begin(), h.log.end());
+                std::sort(m.log.begin(), m.log.end());
+                assert(h.log == m.log);
+            }
+            h.log.clear();
+            m.log.clear();
+        }
+        }
+        assert(h.d.size() == m.order.size());
+    }
+}
+
+/// @brief subscribers個の購読者に10万個のイベントを配る。購読者のキャプチャは24バイト(std::function はヒープに置く)
+void run_benchmark(int subscribers)
+{
+    constexpr int event_count = 100'000;
+    std::printf(" %d subscribers\n", subscribers);
+    std::vector<long long> sums(subscribers);
+    std::vector<int> events(event_count);
+    for (int i = 0; i < event_count; i++)
+        events[i] = i % 1000;
+
+    std::vector<std::function<void(int)>> functions;
+    std::vector<std::unique_ptr<std::string>> noise; // std::function の確保が散らばるように、間に別の確保を挟む
+    events::dispatcher<void(int)> dispatcher;
+    dispatcher.reserve(subscribers);
+    const auto subscribe = [&](auto f)
+    {
+        functions.push_back(f);
+        noise.push_back(std::make_unique<std::string>(100, 'x'));
+        dispatcher.connect(f);
+    };
+    for (int s = 0; s < subscribers; s++)
+    {
+        // 3種類の購読者を混ぜる(呼び先が入れ替わる)
+        long long *sum = &sums[s];
+        const int k = s + 1, bias = s * 3, limit = 500 + s;
+        switch (s % 3)
+        {
+        case 0:
+            subscribe([sum, k, bias, limit](int x)
+                      { *sum += x < limit ? x * k : bias; });
+            break;
+        case 1:
+            subscribe([sum, k, bias, limit](int x)
+                      { *sum = std::max<long long>(*sum, (x ^ k) + bias + limit); });
+            break;
+        default:
+            subscribe([sum, k, bias, limit](int x)
+                      { *sum += (x & k) == 0 ? limit : bias; });
+        }
+    }
+
+    const double calls = static_cast<double>(subscribers) * event_count;
+    bench::report_ns("vector<std::function>", bench::best_of(3, [&]
+                                                             {
+                                                                 for (int e : events)
+                                                                     for (const auto &f : functions)
+                                                                         f(e);
+                                                                 bench::clobber_memory(); }),
+                     calls);
+    bench::report_ns("dispatcher::emit", bench::best_of(3, [&]
+                                                        {
+                                                            for (int e : events)
+                                                                dispatcher.emit(e);
+                                                            bench::clobber_memory(); }),
+                     calls);
+    bench::report_ns("dispatcher::emit_each", bench::best_of(3, [&]
+                                                             {
+                                                                 dispatcher.emit_each(std::span<const int>(events));
+                                                                 bench::clobber_memory(); }),
+                     calls);
+    std::printf("  %-40s %10zu bytes\n", "dispatcher memory", dispatcher.memory_usage());
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        events::dispatcher<void(int)> clicked;
+        int total = 0;
+        const auto a = clicked.connect([&](int x)
+                                       { total += x; });
+        clicked.connect([](int x)
+                        { cout << "clicked: " << x << endl; });
+
+        // 1回だけ呼ばれる購読者(呼ばれている最中に自分を外す)
+        events::connection once;
+        once = clicked.connect([&](int x)
+                               {
+                                   cout << "once: " << x << endl;
+                                   clicked.disconnect(once); });
+
+        clicked.emit(5);  // clicked: 5 / once: 5
+        clicked.emit(10); // clicked: 10
+        clicked.disconnect(a);
+        clicked.emit(100);                                                    // clicked: 100
+        cout << "total: " << total << ", subscribers: " << clicked.size() << endl; // total: 15, subscribers: 1
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check();
+        cout << "random connect / disconnect: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        run_benchmark(256);
+        run_benchmark(4096);
+    }
+}
+
+// Q1: std::function の配列と比べて何が速くなる？
+//   -> 購読者ごとのヒープ確保がなくなり、つなぐ・外すが速く、メモリも散らばらない。
+//      1イベントずつ配る速さは、購読者がキャッシュに収まる間は std::function とほぼ同じ。
+//      emit_each は同じ購読者を続けて呼ぶので、間接呼び出しの分岐予測が当たりやすく速い
+// Q2: 購読者の中から emit を呼んでもよい？
+//   -> よい(入れ子で配る)。つなぐ・外すの反映は一番外側の emit が終わってから行う
+// Q3: 別スレッドから connect / emit してよい？
+//   -> いけない。スレッドをまたぐ場合は mutex で守るか、スレッドごとに dispatcher を持つ
@@ -0,0 +1,182 @@
+/// キャプチャするラムダをCのコールバックに渡す
+// * 01_basic/04-lambda.cpp の some_function_with_c_callback(void (*)(int)) に、c_callback.h を使って
+//   キャプチャするラムダを渡し、呼び出しのコストを直接の関数ポインタと比べる
+// * ビルド: g++ -std=c++20 -O2 -march=native -pthread 25-c_callback.cpp
+
+#include "bench.h"
+#include "c_callback.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Cのライブラリの関数のつもり(インライン展開させない)
+extern "C"
+{
+    /// @brief 04-lambda.cpp と同じ。関数ポインタだけを受ける
+    [[gnu::noinline]] void some_function_with_c_callback(void (*completion_handler)(int))
+    {
+        int long_process_result = 42;
+        completion_handler(long_process_result);
+    }
+
+    /// @brief 関数ポインタと context を受ける(多くのCのAPIの形)
+    [[gnu::noinline]] void some_function_with_c_callback_ctx(void (*completion_handler)(void *, int), void *context)
+    {
+        int long_process_result = 42;
+        completion_handler(context, long_process_result);
+    }
+
+    // ベンチマーク用: コールバックをn回呼ぶ
+    [[gnu::noinline]] void for_each_index(int n, void (*callback)(int))
+    {
+        for (int i = 0; i < n; i++)
+            callback(i);
+    }
+
+    [[gnu::noinline]] void for_each_index_ctx(int n, void (*callback)(void *, int), void *context)
+    {
+        for (int i = 0; i < n; i++)
+            callback(context, i);
+    }
+}
+
+[[gnu::noinline]] void for_each_index_function(int n, const std::function<void(int)> &callback)
+{
+    for (int i = 0; i < n; i++)
+        callback(i);
+}
+
+namespace
+{
+    long long global_sum = 0; // キャプチャできないときの逃げ道
+    void add_to_global(int x) { global_sum += x; }
+}
+
+/// @brief 複数のスレッドから割り当てと返却を繰り返し、それぞれの関数ポインタが自分のラムダを呼ぶか確かめる
+void check_thread_safety()
+{
+    using pool = ccallback::thunk_pool<void(int), 16, 32, struct check_tag>;
+    constexpr int threads = 4;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t]
+                             {
+                                 for (int i = 0; i < 20000; i++)
+                                 {
+                                     long long local = 0;
+                                     auto th = pool::acquire([&local, t](int x)
+                                                             { local += x + t; });
+                                     if (!th)
+                                         continue; // 使い切っていたらやり直す
+                                     th.get()(i);
+                                     assert(local == i + t);
+                                 } });
+    }
+    for (auto &w : workers)
+        w.join();
+    assert(pool::in_use() == 0);
+
+    // 使い切ると空の thunk が返る
+    std::vector<pool::thunk> all;
+    for (std::size_t i = 0; i < pool::capacity(); i++)
+        all.push_back(pool::acquire([](int) {}));
+    assert(pool::in_use() == pool::capacity() && !pool::acquire([](int) {}));
+    all.pop_back();
+    assert(pool::acquire([](int) {})); // 1つ返すとまた割り当てられる(この一時オブジェクトはすぐ返却される)
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << "-------------------------------------" << endl;
+    {
+        int base = 100;
+
+        // context を受けるAPI: ラムダのアドレスを context にして渡す(確保なし)
+        auto on_done = [&](int result)
+        { cout << "ctx: " << base + result << endl; };
+        const auto cb = ccallback::bind_context_first<void(int)>(on_done);
+        some_function_with_c_callback_ctx(cb.fn, cb.context); // ctx: 142
+
+        // 関数ポインタだけを受けるAPI: プールから関数ポインタを借りる。th が破棄されると返却される
+        {
+            auto th = ccallback::thunk_pool<void(int)>::acquire([&](int result)
+                                                                { cout << "thunk: " << base * 2 + result << endl; });
+            some_function_with_c_callback(th.get()); // thunk: 242
+            cout << "in use: " << ccallback::thunk_pool<void(int)>::in_use() << endl; // 1
+        }
+        cout << "in use: " << ccallback::thunk_pool<void(int)>::in_use() << endl; // 0
+
+        // 標準Cライブラリの qsort(比較関数に context を渡せない)で、比較の回数を数える
+        int values[] = {5, 3, 9, 1, 7, 2, 8};
+        int comparisons = 0;
+        auto cmp = ccallback::thunk_pool<int(const void *, const void *), 4>::acquire(
+            [&comparisons](const void *a, const void *b)
+            {
+                comparisons++;
+                const int x = *static_cast<const int *>(a), y = *static_cast<const int *>(b);
+                return (x > y) - (x < y);
+            });
+        std::qsort(values, std::size(values), sizeof(int), cmp.get());
+        for (int v : values)
+            cout << v << " ";
+        cout << "(" << comparisons << " comparisons)" << endl; // 1 2 3 5 7 8 9
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        check_thread_safety();
+        cout << "thread safety: ok" << endl;
+    }
+    cout << "-------------------------------------" << endl;
+    {
+        // Cの関数からコールバックを1億回呼ぶ
+        constexpr int count = 100'000'000;
+        long long sum = 0;
+        const int bias = 1;
+        auto add = [&sum, bias](int x)
+        { sum += x + bias; };
+
+        bench::report_ns("function pointer + global", bench::best_of(3, [&]
+                                                                     {
+                                                                         global_sum = 0;
+                                                                         for_each_index(count, &add_to_global);
+                                                                         bench::do_not_optimize(global_sum); }),
+                         count);
+        bench::report_ns("bind_context_first", bench::best_of(3, [&]
+                                                              {
+                                                                  sum = 0;
+                                                                  const auto cb = ccallback::bind_context_first<void(int)>(add);
+                                                                  for_each_index_ctx(count, cb.fn, cb.context);
+                                                                  bench::do_not_optimize(sum); }),
+                         count);
+        bench::report_ns("thunk_pool", bench::best_of(3, [&]
+                                                      {
+                                                          sum = 0;
+                                                          auto th = ccallback::thunk_pool<void(int)>::acquire(add);
+                                                          for_each_index(count, th.get());
+                                                          bench::do_not_optimize(sum); }),
+                         count);
+        bench::report_ns("std::function", bench::best_of(3, [&]
+                                                         {
+                                                             sum = 0;
+                                                             for_each_index_function(count, add);
+                                                             bench::do_not_optimize(sum); }),
+                         count);
+    }
+}
+
+// Q1: thunk_pool は間接呼び出しが1段多いが、遅くならない？
+//   -> 借りた関数(call<I>)が置き場所から「ラムダを呼ぶ関数」を読んで呼ぶので2段になるが、
+//      どちらも毎回同じ呼び先なので分岐予測が当たり、直接の関数ポインタとの差はほとんど測れない。
+//      置き場所の数に上限があるので、context を渡せるAPIなら bind_context_first / last を使う
+// Q2: 実行時に機械語を作れば(libffi の closure など)、数の上限はなくせるのでは？
+//   -> できるが、書き込みと実行が両方できるメモリが必要で、それを禁止している環境(iOS、一部のLinuxの設定)がある。
+//      thunk_pool はコンパイル時に作った関数だけを使うので、どこでも動く
+// Q3: thunk を破棄した後にCのライブラリがコールバックを呼んだら？
+//   -> 別のラムダに割り当て直されているかもしれず、未定義動作。登録を解除してから thunk を破棄すること
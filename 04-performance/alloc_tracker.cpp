@@ -0,0 +1,386 @@
+/// メモリ確保の計測ライブラリ(実装)
+// * グローバルな operator new/delete を全て置き換えている
+// * 解放時のバイト数を知るため、確保したブロックの直前にサイズを書き込んでおく
+//   (サイズ付きdeleteが呼ばれない場合でも正しく数えるため)
+// * operator newの中ではoperator newを呼べないので、ここではmalloc/freeと固定長の領域だけを使う
+
+#include "alloc_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <execinfo.h> // backtrace (glibc/macOS)
+
+namespace
+{
+    using alloc_tracker::counters;
+
+    // スレッドごとの状態。定数初期化できるのでthread_localでも初期化コストがかからない
+    struct thread_state
+    {
+        counters total;
+        unsigned sample_tick{};
+        bool in_hook{}; // サンプリング中の再入(backtraceの内部での確保)を防ぐ
+    };
+    thread_local thread_state t_state;
+
+    std::atomic<std::uint64_t> g_allocations{};
+    std::atomic<std::uint64_t> g_deallocations{};
+    std::atomic<std::uint64_t> g_bytes_allocated{};
+    std::atomic<std::uint64_t> g_bytes_freed{};
+
+    //
+    // 確保位置のサンプリング
+    //
+    constexpr int max_frames = 8;
+    constexpr int skip_frames = 2;         // sample_site / operator new の分
+    constexpr std::size_t max_sites = 512; // 2のべき乗にすること
+
+    struct site
+    {
+        std::uint64_t hash;
+        void *frames[max_frames];
+        int depth;
+        std::uint64_t count;
+        std::uint64_t bytes;
+    };
+
+    std::atomic<unsigned> g_sample_every{};
+    unsigned g_last_sample_every{}; // レポート表示用。最後に有効にしたときの間隔
+    std::mutex g_sites_mutex; // std::mutexのlockはメモリ確保しない
+    site g_sites[max_sites]{};
+    std::uint64_t g_dropped_samples{};
+
+    std::uint64_t hash_frames(void *const *frames, int depth) noexcept
+    {
+        // FNV-1a
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < depth; i++)
+        {
+            h ^= reinterpret_cast<std::uintptr_t>(frames[i]);
+            h *= 0x100000001b3ULL;
+        }
+        return h | 1; // 0は空きスロットを表すので使わない
+    }
+
+    [[gnu::noinline]] void sample_site(std::size_t size) noexcept
+    {
+        t_state.in_hook = true;
+        void *frames[max_frames + skip_frames];
+        int depth = backtrace(frames, max_frames + skip_frames) - skip_frames;
+        if (depth > 0)
+        {
+            void **caller = frames + skip_frames;
+            const auto h = hash_frames(caller, depth);
+
+            std::lock_guard lock{g_sites_mutex};
+            auto i = static_cast<std::size_t>(h) & (max_sites - 1);
+            for (std::size_t probe = 0;; probe++, i = (i + 1) & (max_sites - 1))
+            {
+                if (probe == max_sites)
+                {
+                    g_dropped_samples++; // テーブルが満杯
+                    break;
+                }
+                auto &s = g_sites[i];
+                if (s.hash == 0)
+                {
+                    s.hash = h;
+                    s.depth = depth;
+                    std::memcpy(s.frames, caller, sizeof(void *) * depth);
+                }
+                if (s.hash == h)
+                {
+                    s.count++;
+                    s.bytes += size;
+                    break;
+                }
+            }
+        }
+        t_state.in_hook = false;
+    }
+
+    //
+    // 確保と解放
+    //
+    constexpr std::size_t default_prefix = alignof(std::max_align_t);
+
+    void count_allocation(std::size_t size) noexcept
+    {
+        t_state.total.allocations++;
+        t_state.total.bytes_allocated += size;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void count_deallocation(std::size_t size) noexcept
+    {
+        t_state.total.deallocations++;
+        t_state.total.bytes_freed += size;
+        g_deallocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes_freed.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    /// @brief 実際にメモリを確保する。失敗時はnullptrを返す(new_handlerが投げた例外はそのまま伝わる)
+    /// @param prefix ブロック先頭に確保するサイズ記録用の領域。alignと同じ値にしてアラインメントを保つ
+    void *allocate(std::size_t size, std::size_t prefix)
+    {
+        if (size > SIZE_MAX - prefix)
+            return nullptr;
+
+        void *raw = nullptr;
+        for (;;)
+        {
+            if (prefix == default_prefix)
+                raw = std::malloc(size + prefix);
+            else // aligned_allocはサイズがalignの倍数でないといけない
+                raw = std::aligned_alloc(prefix, (size + prefix + prefix - 1) / prefix * prefix);
+            if (raw)
+                break;
+            // 標準のoperator newと同様に、new_handlerがあれば呼んでから再試行する
+            auto handler = std::get_new_handler();
+            if (!handler)
+                return nullptr;
+            handler(); // std::bad_alloc を投げて諦めることもある
+        }
+
+        auto *user = static_cast<unsigned char *>(raw) + prefix;
+        std::memcpy(user - sizeof(std::size_t), &size, sizeof(size));
+
+        if (!t_state.in_hook)
+            count_allocation(size);
+        return user;
+    }
+
+    void deallocate(void *p, std::size_t prefix) noexcept
+    {
+        if (!p)
+            return;
+        auto *user = static_cast<unsigned char *>(p);
+        std::size_t size;
+        std::memcpy(&size, user - sizeof(std::size_t), sizeof(size));
+        if (!t_state.in_hook)
+            count_deallocation(size);
+        std::free(user - prefix);
+    }
+
+    void *allocate_or_throw(std::size_t size, std::size_t prefix)
+    {
+        if (auto *p = allocate(size, prefix))
+            return p;
+        throw std::bad_alloc{};
+    }
+
+    /// @brief nothrow版のoperator new用。new_handlerが投げた例外も受け止めてnullptrを返す
+    void *allocate_nothrow(std::size_t size, std::size_t prefix) noexcept
+    {
+        try
+        {
+            return allocate(size, prefix);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+
+    /// @brief 確保位置のサンプリング。operator newから直接呼ぶこと
+    ///  (backtraceで読み飛ばすフレーム数が変わらないよう、間に関数を挟まない)
+    inline void maybe_sample(void *p, std::size_t size) noexcept
+    {
+        if (!p || t_state.in_hook)
+            return;
+        if (auto every = g_sample_every.load(std::memory_order_relaxed);
+            every != 0 && ++t_state.sample_tick >= every)
+        {
+            t_state.sample_tick = 0;
+            sample_site(size); // 戻ってからpを返すので末尾呼び出しにはならない
+        }
+    }
+
+    std::size_t prefix_of(std::align_val_t al) noexcept
+    {
+        return std::max(static_cast<std::size_t>(al), default_prefix);
+    }
+}
+
+//
+// グローバルな operator new/delete の置き換え
+//
+void *operator new(std::size_t size)
+{
+    auto *p = allocate_or_throw(size, default_prefix);
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new[](std::size_t size)
+{
+    auto *p = allocate_or_throw(size, default_prefix);
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    auto *p = allocate_nothrow(size, default_prefix);
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    auto *p = allocate_nothrow(size, default_prefix);
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new(std::size_t size, std::align_val_t al)
+{
+    auto *p = allocate_or_throw(size, prefix_of(al));
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new[](std::size_t size, std::align_val_t al)
+{
+    auto *p = allocate_or_throw(size, prefix_of(al));
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new(std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept
+{
+    auto *p = allocate_nothrow(size, prefix_of(al));
+    maybe_sample(p, size);
+    return p;
+}
+void *operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept
+{
+    auto *p = allocate_nothrow(size, prefix_of(al));
+    maybe_sample(p, size);
+    return p;
+}
+
+void operator delete(void *p) noexcept { deallocate(p, default_prefix); }
+void operator delete[](void *p) noexcept { deallocate(p, default_prefix); }
+void operator delete(void *p, std::size_t) noexcept { deallocate(p, default_prefix); }
+void operator delete[](void *p, std::size_t) noexcept { deallocate(p, default_prefix); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { deallocate(p, default_prefix); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { deallocate(p, default_prefix); }
+void operator delete(void *p, std::align_val_t al) noexcept { deallocate(p, prefix_of(al)); }
+void operator delete[](void *p, std::align_val_t al) noexcept { deallocate(p, prefix_of(al)); }
+void operator delete(void *p, std::size_t, std::align_val_t al) noexcept { deallocate(p, prefix_of(al)); }
+void operator delete[](void *p, std::size_t, std::align_val_t al) noexcept { deallocate(p, prefix_of(al)); }
+void operator delete(void *p, std::align_val_t al, const std::nothrow_t &) noexcept { deallocate(p, prefix_of(al)); }
+void operator delete[](void *p, std::align_val_t al, const std::nothrow_t &) noexcept { deallocate(p, prefix_of(al)); }
+
+namespace alloc_tracker
+{
+    counters operator-(const counters &lhs, const counters &rhs) noexcept
+    {
+        return {lhs.allocations - rhs.allocations,
+                lhs.deallocations - rhs.deallocations,
+                lhs.bytes_allocated - rhs.bytes_allocated,
+                lhs.bytes_freed - rhs.bytes_freed};
+    }
+
+    counters thread_counters() noexcept
+    {
+        return t_state.total;
+    }
+
+    counters global_counters() noexcept
+    {
+        return {g_allocations.load(std::memory_order_relaxed),
+                g_deallocations.load(std::memory_order_relaxed),
+                g_bytes_allocated.load(std::memory_order_relaxed),
+                g_bytes_freed.load(std::memory_order_relaxed)};
+    }
+
+    alloc_scope::alloc_scope(const char *name, bool report) noexcept
+        : name_(name), report_(report), start_(thread_counters())
+    {
+    }
+
+    alloc_scope::~alloc_scope()
+    {
+        if (!report_)
+            return;
+        const auto d = delta();
+        // iostreamを使うと表示自体が計測結果に混ざることがあるのでprintfで出す
+        std::printf("[%s] new: %llu (%llu bytes) / delete: %llu (%llu bytes)\n",
+                    name_,
+                    static_cast<unsigned long long>(d.allocations),
+                    static_cast<unsigned long long>(d.bytes_allocated),
+                    static_cast<unsigned long long>(d.deallocations),
+                    static_cast<unsigned long long>(d.bytes_freed));
+    }
+
+    counters alloc_scope::delta() const noexcept
+    {
+        return thread_counters() - start_;
+    }
+
+    void enable_sampling(unsigned every_n) noexcept
+    {
+        if (every_n != 0)
+        {
+            // backtraceは初回呼び出し時に内部でライブラリをロード(=メモリ確保)するので先に済ませておく
+            void *dummy[1];
+            t_state.in_hook = true;
+            backtrace(dummy, 1);
+            t_state.in_hook = false;
+        }
+        {
+            std::lock_guard lock{g_sites_mutex};
+            if (every_n != 0)
+                g_last_sample_every = every_n;
+        }
+        g_sample_every.store(every_n, std::memory_order_relaxed);
+    }
+
+    void report_top_sites(std::size_t top_n)
+    {
+        // ロックを持ったまま表示しないよう、作業用の領域にコピーしてから並べ替える
+        // (スタックに置くには大きいのでstaticにしている。同時に複数スレッドから呼ばないこと)
+        static site snapshot[max_sites];
+        std::size_t n = 0;
+        std::uint64_t dropped;
+        unsigned every;
+        {
+            std::lock_guard lock{g_sites_mutex};
+            for (const auto &s : g_sites)
+            {
+                if (s.hash != 0)
+                    snapshot[n++] = s;
+            }
+            dropped = g_dropped_samples;
+            every = g_last_sample_every;
+        }
+        top_n = std::min(top_n, n);
+        std::partial_sort(snapshot, snapshot + top_n, snapshot + n,
+                          [](const site &a, const site &b)
+                          { return a.bytes > b.bytes; });
+
+        std::printf("top %zu allocation sites (1/%u sampled, %llu dropped)\n",
+                    top_n, every, static_cast<unsigned long long>(dropped));
+        for (std::size_t i = 0; i < top_n; i++)
+        {
+            const auto &s = snapshot[i];
+            std::printf("#%zu samples: %llu, sampled bytes: %llu (estimated total: %llu bytes)\n",
+                        i + 1,
+                        static_cast<unsigned long long>(s.count),
+                        static_cast<unsigned long long>(s.bytes),
+                        static_cast<unsigned long long>(s.bytes * every));
+            std::fflush(stdout);
+            backtrace_symbols_fd(s.frames, s.depth, fileno(stdout)); // メモリ確保せずに直接書き出す
+        }
+    }
+
+    void reset_sampling() noexcept
+    {
+        std::lock_guard lock{g_sites_mutex};
+        std::fill(std::begin(g_sites), std::end(g_sites), site{});
+        g_dropped_samples = 0;
+    }
+}
@@ -0,0 +1,75 @@
+/// メモリ確保の計測ライブラリ
+// * グローバルな operator new/delete を置き換えて、スレッドごとに確保回数とバイト数を数える
+// * alloc_tracker.cpp を一緒にリンクするだけで有効になる(置き換えはプログラム全体で1つだけ)
+//
+// 使い方:
+//   {
+//       alloc_tracker::alloc_scope scope{"make_shared"};
+//       auto p = std::make_shared<int>(42);
+//   } // ← スコープを抜けるときに "[make_shared] new: 1 (16 bytes) / delete: 1 (16 bytes)" のように表示
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace alloc_tracker
+{
+    /// @brief 確保・解放の回数とバイト数
+    struct counters
+    {
+        std::uint64_t allocations{};
+        std::uint64_t deallocations{};
+        std::uint64_t bytes_allocated{};
+        std::uint64_t bytes_freed{};
+
+        /// @brief 確保されたまま解放されていないバイト数
+        std::int64_t live_bytes() const noexcept
+        {
+            return static_cast<std::int64_t>(bytes_allocated) - static_cast<std::int64_t>(bytes_freed);
+        }
+    };
+
+    counters operator-(const counters &lhs, const counters &rhs) noexcept;
+
+    /// @brief 呼び出したスレッドでのこれまでの累計
+    counters thread_counters() noexcept;
+
+    /// @brief 全スレッドの累計
+    counters global_counters() noexcept;
+
+    /// @brief スコープ内でのメモリ確保を数えるRAIIクラス
+    ///  コンストラクタ時点のスレッドの累計を覚えておき、差分を求める。
+    ///  (他スレッドでの確保は含まれない)
+    class alloc_scope
+    {
+    public:
+        /// @param name 表示に使う名前。文字列リテラルなどスコープより長生きするものを渡すこと
+        /// @param report trueならデストラクタで結果を標準出力に表示する
+        explicit alloc_scope(const char *name, bool report = true) noexcept;
+        ~alloc_scope();
+
+        alloc_scope(const alloc_scope &) = delete;
+        alloc_scope &operator=(const alloc_scope &) = delete;
+
+        /// @brief コンストラクタからこれまでの差分
+        counters delta() const noexcept;
+
+    private:
+        const char *name_;
+        bool report_;
+        counters start_;
+    };
+
+    /// @brief 確保位置のサンプリングを設定する
+    /// @param every_n n回の確保ごとに1回、呼び出し元のスタックを記録する。0で無効(既定)
+    /// サンプリングはスレッドごとのカウンタで行い、記録には固定長のテーブルを使う
+    /// (記録のためにメモリ確保はしない)
+    void enable_sampling(unsigned every_n) noexcept;
+
+    /// @brief サンプリングした確保位置を、確保バイト数の多い順に標準出力へ表示する
+    /// @param top_n 表示する件数
+    void report_top_sites(std::size_t top_n = 5);
+
+    /// @brief サンプリング結果を破棄する
+    void reset_sampling() noexcept;
+}
@@ -0,0 +1,53 @@
+/// ベンチマーク用の小さな道具
+// * 計測対象が最適化で消されないようにする関数と、時間計測のヘルパーだけを置いている
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+namespace bench
+{
+    /// @brief 値を「使った」ことにして、計算が最適化で消されるのを防ぐ(GCC/Clang)
+    template <class T>
+    inline void do_not_optimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /// @brief メモリへの書き込みが最適化で消されるのを防ぐ(GCC/Clang)
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+
+    /// @brief fをrepeats回実行し、最も速かった1回の所要時間[秒]を返す
+    ///  (最速値を使うのは、他のプロセスや割り込みによるばらつきを除くため)
+    template <class F>
+    double best_of(int repeats, F &&f)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i < repeats; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            auto end = std::chrono::steady_clock::now();
+            double sec = std::chrono::duration<double>(end - start).count();
+            if (sec < best)
+                best = sec;
+        }
+        return best;
+    }
+
+    /// @brief 1回あたりの時間[ns]を表示する
+    inline void report_ns(const char *name, double sec, double iterations)
+    {
+        std::printf("  %-40s %10.3f ns/op\n", name, sec * 1e9 / iterations);
+    }
+
+    /// @brief スループット[GB/s]を表示する
+    inline void report_gbps(const char *name, double sec, double bytes)
+    {
+        std::printf("  %-40s %10.3f GB/s\n", name, bytes / sec / 1e9);
+    }
+}
@@ -0,0 +1,222 @@
+/// 値のビットパターンを文字列にする
+// * 01_basic/06-casting.cpp の dump_bitpattern はバイトごとにprintf("%x")するので、先頭の0が落ちて
+//   "0a"と"a"の区別がつかず、遅い。ここでは呼び出し側のバッファへ直接書く(メモリ確保なし)
+// * 並び順は2通り
+//   - byte_order::memory : メモリ上のバイトの並び(06-casting.cpp と同じ。リトルエンディアンでは下位バイトが先)
+//   - byte_order::value  : 値として上位のバイトから(0xDEADBEEFなら"deadbeef")
+// * 浮動小数点数(float/double)は符号・指数・仮数に分けて見られる。std::bit_castで同じ大きさの整数に
+//   してからビットを取り出すので、ホストのバイト順に関係なく同じ結果になる
+// * 結果は std::to_chars と同じく to_chars_result で返す(足りなければ value_too_large)
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
+namespace bitpattern
+{
+    enum class byte_order
+    {
+        memory, // メモリ上の並び
+        value,  // 値の上位バイトから
+    };
+
+    /// @brief 16進表記の文字数
+    template <class T>
+    constexpr std::size_t hex_length = sizeof(T) * 2;
+
+    /// @brief 2進表記の文字数(separatorを使う場合は8bitごとに1文字増える)
+    template <class T>
+    constexpr std::size_t bit_length(bool separator = false) noexcept
+    {
+        return sizeof(T) * 8 + (separator ? sizeof(T) - 1 : 0);
+    }
+
+    namespace detail
+    {
+        struct tables
+        {
+            char hex[256][2];
+            char bits[256][8];
+            constexpr tables() : hex{}, bits{}
+            {
+                constexpr char digits[] = "0123456789abcdef";
+                for (int i = 0; i < 256; i++)
+                {
+                    hex[i][0] = digits[i >> 4];
+                    hex[i][1] = digits[i & 0xF];
+                    for (int b = 0; b < 8; b++)
+                        bits[i][b] = (i >> (7 - b)) & 1 ? '1' : '0';
+                }
+            }
+        };
+        inline constexpr tables table{};
+
+        /// @brief 指定した順にバイトを取り出せるよう、値のバイト列を返す
+        template <class T>
+        inline void bytes_of(const T &x, unsigned char (&out)[sizeof(T)], byte_order order) noexcept
+        {
+            std::memcpy(out, &x, sizeof(T));
+            if (order == byte_order::value && std::endian::native == std::endian::little)
+            {
+                for (std::size_t i = 0; i < sizeof(T) / 2; i++)
+                {
+                    const auto tmp = out[i];
+                    out[i] = out[sizeof(T) - 1 - i];
+                    out[sizeof(T) - 1 - i] = tmp;
+                }
+            }
+        }
+    }
+
+    /// @brief xのバイト列を16進で書く
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    std::to_chars_result to_hex(char *first, char *last, const T &x, byte_order order = byte_order::value) noexcept
+    {
+        if (static_cast<std::size_t>(last - first) < hex_length<T>)
+            return {last, std::errc::value_too_large};
+        unsigned char bytes[sizeof(T)];
+        detail::bytes_of(x, bytes, order);
+        for (std::size_t i = 0; i < sizeof(T); i++)
+            std::memcpy(first + i * 2, detail::table.hex[bytes[i]], 2);
+        return {first + hex_length<T>, std::errc{}};
+    }
+
+    /// @brief xのビット列を2進で書く
+    /// @param separator trueなら8bitごとに空白を入れる
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    std::to_chars_result to_bits(char *first, char *last, const T &x, byte_order order = byte_order::value,
+                                 bool separator = false) noexcept
+    {
+        const auto length = bit_length<T>(separator);
+        if (static_cast<std::size_t>(last - first) < length)
+            return {last, std::errc::value_too_large};
+        unsigned char bytes[sizeof(T)];
+        detail::bytes_of(x, bytes, order);
+        char *p = first;
+        for (std::size_t i = 0; i < sizeof(T); i++)
+        {
+            if (separator && i > 0)
+                *p++ = ' ';
+            std::memcpy(p, detail::table.bits[bytes[i]], 8);
+            p += 8;
+        }
+        return {p, std::errc{}};
+    }
+
+    //
+    // IEEE 754の浮動小数点数
+    //
+
+    enum class float_category
+    {
+        zero,
+        subnormal,
+        normal,
+        infinity,
+        nan,
+    };
+
+    /// @brief 浮動小数点数を符号・指数・仮数に分けたもの
+    struct float_fields
+    {
+        bool sign;              // 負ならtrue
+        std::uint32_t exponent; // バイアス付きの指数部(ビット列のまま)
+        std::uint64_t mantissa; // 仮数部(暗黙の1を含まない)
+        int exponent_bits;
+        int mantissa_bits;
+
+        /// @brief バイアスを引いた指数(正規化数なら値 = 1.mantissa × 2^unbiased_exponent())
+        constexpr int unbiased_exponent() const noexcept
+        {
+            const int bias = (1 << (exponent_bits - 1)) - 1;
+            return exponent == 0 ? 1 - bias : static_cast<int>(exponent) - bias;
+        }
+
+        constexpr float_category category() const noexcept
+        {
+            const auto max_exponent = (std::uint32_t{1} << exponent_bits) - 1;
+            if (exponent == 0)
+                return mantissa == 0 ? float_category::zero : float_category::subnormal;
+            if (exponent == max_exponent)
+                return mantissa == 0 ? float_category::infinity : float_category::nan;
+            return float_category::normal;
+        }
+    };
+
+    template <std::floating_point T>
+        requires(std::numeric_limits<T>::is_iec559 && (sizeof(T) == 4 || sizeof(T) == 8))
+    constexpr float_fields decompose(T x) noexcept
+    {
+        using U = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+        constexpr int mantissa_bits = std::numeric_limits<T>::digits - 1; // 23 / 52
+        constexpr int exponent_bits = sizeof(T) * 8 - 1 - mantissa_bits;  // 8 / 11
+        const auto u = std::bit_cast<U>(x);
+        return {
+            (u >> (sizeof(T) * 8 - 1)) != 0,
+            static_cast<std::uint32_t>((u >> mantissa_bits) & ((U{1} << exponent_bits) - 1)),
+            static_cast<std::uint64_t>(u & ((U{1} << mantissa_bits) - 1)),
+            exponent_bits,
+            mantissa_bits,
+        };
+    }
+
+    /// @brief 浮動小数点数のビット列を「符号 指数 仮数」に区切って書く(例: 1.0f -> "0 01111111 000...0")
+    template <std::floating_point T>
+    constexpr std::size_t fields_length = sizeof(T) * 8 + 2;
+
+    template <std::floating_point T>
+    std::to_chars_result to_fields(char *first, char *last, T x) noexcept
+    {
+        if (static_cast<std::size_t>(last - first) < fields_length<T>)
+            return {last, std::errc::value_too_large};
+        char bits[sizeof(T) * 8];
+        to_bits(bits, bits + sizeof(bits), x, byte_order::value);
+        const auto f = decompose(x);
+        char *p = first;
+        *p++ = bits[0];
+        *p++ = ' ';
+        std::memcpy(p, bits + 1, static_cast<std::size_t>(f.exponent_bits));
+        p += f.exponent_bits;
+        *p++ = ' ';
+        std::memcpy(p, bits + 1 + f.exponent_bits, static_cast<std::size_t>(f.mantissa_bits));
+        return {p + f.mantissa_bits, std::errc{}};
+    }
+
+    //
+    // 配列をまとめて書く(診断用のループの中で使えるよう、1回の呼び出しで全要素を書く)
+    //
+
+    /// @brief n要素を16進で、区切り文字を挟んで書くのに必要な文字数
+    template <class T>
+    constexpr std::size_t hex_array_length(std::size_t n) noexcept
+    {
+        return n == 0 ? 0 : n * (hex_length<T> + 1) - 1;
+    }
+
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    std::to_chars_result to_hex_array(char *first, char *last, std::span<const T> values, char separator = ' ',
+                                      byte_order order = byte_order::value) noexcept
+    {
+        if (static_cast<std::size_t>(last - first) < hex_array_length<T>(values.size()))
+            return {last, std::errc::value_too_large};
+        char *p = first;
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            if (i > 0)
+                *p++ = separator;
+            p = to_hex(p, last, values[i], order).ptr;
+        }
+        return {p, std::errc{}};
+    }
+}
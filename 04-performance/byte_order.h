@@ -0,0 +1,205 @@
+/// バイト順の変換(エンディアン変換)
+// * 01_basic/06-bitcast.cpp の swap_endian_invalid() はポインタの読み替えでstrict aliasingに違反している。
+//   ここでは std::bit_cast(C++23なら std::byteswap)を使って、未定義動作なしに1要素を変換する(constexpr)
+// * ネットワークから受け取った配列などをまとめて変換するため、16/32/64bitの配列をpshufbで
+//   16バイト(AVX2なら32バイト)ずつ変換する関数を用意する(in-placeとout-of-placeの両方)
+// * ホストのバイト順は std::endian::native で判定する
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace endian
+{
+    /// @brief バイト順を逆にする。整数と浮動小数点数に使える
+    template <class T>
+        requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    constexpr T byteswap(T value) noexcept
+    {
+#if defined(__cpp_lib_byteswap)
+        if constexpr (std::is_integral_v<T>)
+            return std::byteswap(value);
+#endif
+        // 同じ大きさの符号なし整数として並べ替える(GCC/Clangの組み込み関数はconstexprで、1命令のbswapになる)
+        if constexpr (sizeof(T) == 2)
+            return std::bit_cast<T>(__builtin_bswap16(std::bit_cast<std::uint16_t>(value)));
+        else if constexpr (sizeof(T) == 4)
+            return std::bit_cast<T>(__builtin_bswap32(std::bit_cast<std::uint32_t>(value)));
+        else if constexpr (sizeof(T) == 8)
+            return std::bit_cast<T>(__builtin_bswap64(std::bit_cast<std::uint64_t>(value)));
+        // それ以外の大きさ(long doubleなど)はバイト列として並べ替える
+        auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+        for (std::size_t i = 0; i < sizeof(T) / 2; i++)
+        {
+            const auto tmp = bytes[i];
+            bytes[i] = bytes[sizeof(T) - 1 - i];
+            bytes[sizeof(T) - 1 - i] = tmp;
+        }
+        return std::bit_cast<T>(bytes);
+    }
+
+    /// @brief ビッグエンディアン(ネットワークバイトオーダー)とホストのバイト順の変換
+    template <class T>
+    constexpr T big_to_native(T value) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::big)
+            return value;
+        else
+            return byteswap(value);
+    }
+
+    template <class T>
+    constexpr T native_to_big(T value) noexcept { return big_to_native(value); }
+
+    /// @brief リトルエンディアンとホストのバイト順の変換
+    template <class T>
+    constexpr T little_to_native(T value) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::little)
+            return value;
+        else
+            return byteswap(value);
+    }
+
+    template <class T>
+    constexpr T native_to_little(T value) noexcept { return little_to_native(value); }
+
+    /// @brief まとめて変換できる要素の型(16/32/64bitの整数と浮動小数点数)
+    template <class T>
+    concept swappable = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                        (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+    namespace detail
+    {
+#if defined(__SSSE3__)
+        /// @brief 要素の大きさSizeごとにバイトを逆順にするpshufbのマスク(16バイト分)
+        template <std::size_t Size>
+        inline __m128i swap_mask() noexcept
+        {
+            if constexpr (Size == 2)
+                return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            else if constexpr (Size == 4)
+                return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            else
+                return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        }
+#endif
+
+        /// @brief n要素をinからoutへ変換する(in == out でもよい)。SIMDで処理した要素数を返す
+        template <std::size_t Size>
+        inline std::size_t swap_block(const std::byte *in, std::byte *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0; // バイト単位
+            [[maybe_unused]] const std::size_t bytes = n * Size;
+#if defined(__AVX2__)
+            const auto mask256 = _mm256_broadcastsi128_si256(swap_mask<Size>());
+            for (; i + 64 <= bytes; i += 64)
+            {
+                // 2回分をまとめて読んでから書く(in == out の場合も安全)
+                const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 32));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(a, mask256));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 32), _mm256_shuffle_epi8(b, mask256));
+            }
+#endif
+#if defined(__SSSE3__)
+            const auto mask = swap_mask<Size>();
+            for (; i + 16 <= bytes; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(v, mask));
+            }
+#else
+            (void)in;
+            (void)out;
+#endif
+            return i / Size;
+        }
+
+        template <class T>
+        inline void swap_scalar(const T *in, T *out, std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i < n; i++)
+                out[i] = byteswap(in[i]);
+        }
+    }
+
+    /// @brief 配列の各要素のバイト順を逆にする(in-place)
+    /// @param use_simd falseなら1要素ずつ変換する(比較用)
+    template <swappable T>
+    void byteswap(std::span<T> data, bool use_simd = true) noexcept
+    {
+        std::size_t done = 0;
+        if (use_simd)
+        {
+            auto *p = reinterpret_cast<std::byte *>(data.data());
+            done = detail::swap_block<sizeof(T)>(p, p, data.size());
+        }
+        detail::swap_scalar(data.data() + done, data.data() + done, data.size() - done);
+    }
+
+    /// @brief inの各要素のバイト順を逆にしてoutへ書く(out-of-place)。out.size() >= in.size() であること
+    template <swappable T>
+    void byteswap(std::span<const T> in, std::span<T> out, bool use_simd = true) noexcept
+    {
+        std::size_t done = 0;
+        if (use_simd)
+        {
+            done = detail::swap_block<sizeof(T)>(reinterpret_cast<const std::byte *>(in.data()),
+                                                 reinterpret_cast<std::byte *>(out.data()), in.size());
+        }
+        detail::swap_scalar(in.data() + done, out.data() + done, in.size() - done);
+    }
+
+    /// @brief ビッグエンディアンの配列をホストのバイト順にする(ビッグエンディアンのホストでは何もしない)
+    template <swappable T>
+    void big_to_native(std::span<T> data) noexcept
+    {
+        if constexpr (std::endian::native != std::endian::big)
+            byteswap(data);
+    }
+
+    template <swappable T>
+    void big_to_native(std::span<const T> in, std::span<T> out) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::big)
+            std::copy(in.begin(), in.end(), out.begin());
+        else
+            byteswap(in, out);
+    }
+
+    /// @brief ホストのバイト順の配列をビッグエンディアンにする
+    template <swappable T>
+    void native_to_big(std::span<T> data) noexcept { big_to_native(data); }
+
+    template <swappable T>
+    void native_to_big(std::span<const T> in, std::span<T> out) noexcept { big_to_native(in, out); }
+
+    /// @brief バイト列の先頭から、ビッグエンディアンで書かれたTを読む(アラインメント不要)
+    template <swappable T>
+    T load_big(const std::byte *p) noexcept
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T)); // ポインタの読み替えではなくmemcpyで読む(最適化で1命令になる)
+        return big_to_native(value);
+    }
+
+    /// @brief バイト列へビッグエンディアンでTを書く(アラインメント不要)
+    template <swappable T>
+    void store_big(std::byte *p, T value) noexcept
+    {
+        value = native_to_big(value);
+        std::memcpy(p, &value, sizeof(T));
+    }
+}
@@ -0,0 +1,240 @@
+/// キャプチャするラムダをCの関数ポインタのコールバックに渡す
+// * 01_basic/04-lambda.cpp の some_function_with_c_callback(void (*)(int)) には、キャプチャしないラムダしか渡せない。
+//   状態を渡すためにグローバル変数を使ったり、状態をヒープに置いて void* で渡したりしがち
+// * Cのコールバックには2種類ある
+//   - (関数ポインタ, void* context) を受けるもの: bind_context_first / bind_context_last で、ラムダへのポインタを
+//     context にし、それを元の型に戻して呼ぶ関数(トランポリン)を作る。確保はなく、ラムダは呼ぶ側が持ち続ける
+//   - 関数ポインタだけを受けるもの: thunk_pool<Sig, N> があらかじめN個の関数(テンプレートで作る)と
+//     N個の置き場所を用意し、空いている組をラムダに割り当てる。acquire が返す thunk が破棄されると返却される
+//     - 割り当てと返却は atomic のビット列で行うのでスレッドセーフ。N個を使い切ると空の thunk を返す
+//     - ラムダは置き場所の中のバッファ(Capacityバイト)に置くので、確保はない
+//     - thunk を破棄した後に、その関数ポインタが呼ばれないようにするのは使う側の責任
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ccallback
+{
+    /// @brief (関数ポインタ, context) の組。context は最初の引数として渡す
+    template <class Signature>
+    struct context_first;
+
+    template <class R, class... Args>
+    struct context_first<R(Args...)>
+    {
+        R (*fn)(void *context, Args... args) = nullptr;
+        void *context = nullptr;
+
+        R operator()(Args... args) const { return fn(context, std::forward<Args>(args)...); }
+    };
+
+    /// @brief (関数ポインタ, context) の組。context は最後の引数として渡す
+    template <class Signature>
+    struct context_last;
+
+    template <class R, class... Args>
+    struct context_last<R(Args...)>
+    {
+        R (*fn)(Args... args, void *context) = nullptr;
+        void *context = nullptr;
+
+        R operator()(Args... args) const { return fn(std::forward<Args>(args)..., context); }
+    };
+
+    namespace detail
+    {
+        template <class F, class R, class... Args>
+        R call_first(void *context, Args... args)
+        {
+            return (*static_cast<F *>(context))(std::forward<Args>(args)...);
+        }
+
+        template <class F, class R, class... Args>
+        R call_last(Args... args, void *context)
+        {
+            return (*static_cast<F *>(context))(std::forward<Args>(args)...);
+        }
+    }
+
+    /// @brief fを (fn, context) で呼べるようにする。fはコールバックが呼ばれる間、生きていること
+    template <class Signature, class F>
+    context_first<Signature> bind_context_first(F &f) noexcept
+    {
+        return [&]<class R, class... Args>(R (*)(Args...))
+        {
+            static_assert(std::is_invocable_r_v<R, F &, Args...>, "bind_context_first: 引数の型が合わない");
+            return context_first<Signature>{&detail::call_first<F, R, Args...>, static_cast<void *>(std::addressof(f))};
+        }(static_cast<Signature *>(nullptr));
+    }
+
+    /// @brief fを (fn, context) で呼べるようにする(context が最後の引数のAPI向け)
+    template <class Signature, class F>
+    context_last<Signature> bind_context_last(F &f) noexcept
+    {
+        return [&]<class R, class... Args>(R (*)(Args...))
+        {
+            static_assert(std::is_invocable_r_v<R, F &, Args...>, "bind_context_last: 引数の型が合わない");
+            return context_last<Signature>{&detail::call_last<F, R, Args...>, static_cast<void *>(std::addressof(f))};
+        }(static_cast<Signature *>(nullptr));
+    }
+
+    template <class Signature, std::size_t N = 64, std::size_t Capacity = 32, class Tag = void>
+    class thunk_pool; // 宣言のみ。関数型で特殊化したものを使う
+
+    /// @param N 同時に割り当てられる数
+    /// @param Capacity ラムダを置くバッファのバイト数
+    /// @param Tag 同じ関数型で別のプールを作るときに変える
+    template <class R, class... Args, std::size_t N, std::size_t Capacity, class Tag>
+    class thunk_pool<R(Args...), N, Capacity, Tag>
+    {
+        static_assert(N > 0);
+        using fn_type = R (*)(Args...);
+
+        struct slot
+        {
+            R (*invoke)(void *storage, Args... args) = nullptr;
+            void (*destroy)(void *storage) noexcept = nullptr;
+            alignas(std::max_align_t) std::byte storage[Capacity];
+        };
+
+        static constexpr std::size_t word_bits = 64;
+        static constexpr std::size_t word_count = (N + word_bits - 1) / word_bits;
+
+    public:
+        /// @brief 割り当てた関数ポインタ。破棄すると置き場所を返す(ムーブのみ)
+        class thunk
+        {
+        public:
+            thunk() noexcept = default;
+            thunk(thunk &&other) noexcept : index_(std::exchange(other.index_, npos)) {}
+            thunk &operator=(thunk &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    reset();
+                    index_ = std::exchange(other.index_, npos);
+                }
+                return *this;
+            }
+            ~thunk() { reset(); }
+
+            /// @brief Cの関数に渡す関数ポインタ。空なら nullptr
+            fn_type get() const noexcept { return index_ == npos ? nullptr : thunks_[index_]; }
+            explicit operator bool() const noexcept { return index_ != npos; }
+
+            /// @brief ラムダを破棄して置き場所を返す
+            void reset() noexcept
+            {
+                if (index_ != npos)
+                {
+                    release(index_);
+                    index_ = npos;
+                }
+            }
+
+        private:
+            friend class thunk_pool;
+            explicit thunk(std::size_t index) noexcept : index_(index) {}
+
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+            std::size_t index_ = npos;
+        };
+
+        /// @brief fを置き場所にムーブして、それを呼ぶ関数ポインタを割り当てる。空きがなければ空の thunk を返す
+        template <class F, class D = std::decay_t<F>>
+        static thunk acquire(F &&f)
+        {
+            static_assert(sizeof(D) <= Capacity, "thunk_pool: キャプチャが大きすぎる。Capacityを増やすこと");
+            static_assert(alignof(std::max_align_t) % alignof(D) == 0, "thunk_pool: キャプチャのアラインメントが大きすぎる");
+            static_assert(std::is_invocable_r_v<R, D &, Args...>, "thunk_pool: 引数の型が合わない");
+
+            const std::size_t index = claim();
+            if (index == thunk::npos)
+                return {};
+            auto &s = slots_[index];
+            try
+            {
+                ::new (static_cast<void *>(s.storage)) D(std::forward<F>(f));
+            }
+            catch (...)
+            {
+                free_bit(index);
+                throw;
+            }
+            s.invoke = [](void *storage, Args... args) -> R
+            { return (*static_cast<D *>(storage))(std::forward<Args>(args)...); };
+            s.destroy = [](void *storage) noexcept
+            { static_cast<D *>(storage)->~D(); };
+            return thunk{index};
+        }
+
+        /// @brief 割り当て中の数
+        static std::size_t in_use() noexcept
+        {
+            std::size_t n = 0;
+            for (const auto &w : used_)
+                n += static_cast<std::size_t>(std::popcount(w.load(std::memory_order_relaxed)));
+            return n;
+        }
+
+        static constexpr std::size_t capacity() noexcept { return N; }
+
+    private:
+        /// @brief 空いているビットを compare_exchange で立てる
+        static std::size_t claim() noexcept
+        {
+            for (std::size_t w = 0; w < word_count; w++)
+            {
+                const auto valid = w + 1 < word_count || N % word_bits == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (N % word_bits)) - 1;
+                auto bits = used_[w].load(std::memory_order_relaxed);
+                while ((~bits & valid) != 0)
+                {
+                    const auto free = ~bits & valid;
+                    const auto lowest = free & (0 - free); // 最も下の空きビット
+                    // acquire: 前に使っていたスレッドの破棄が終わってから置き場所を使う
+                    if (used_[w].compare_exchange_weak(bits, bits | lowest, std::memory_order_acquire, std::memory_order_relaxed))
+                        return w * word_bits + static_cast<std::size_t>(std::countr_zero(lowest));
+                }
+            }
+            return thunk::npos;
+        }
+
+        static void free_bit(std::size_t index) noexcept
+        {
+            // release: 置き場所への書き込み(破棄)を、次に割り当てるスレッドから見えるようにする
+            used_[index / word_bits].fetch_and(~(std::uint64_t{1} << (index % word_bits)), std::memory_order_release);
+        }
+
+        static void release(std::size_t index) noexcept
+        {
+            auto &s = slots_[index];
+            s.destroy(s.storage);
+            s.invoke = nullptr;
+            free_bit(index);
+        }
+
+        template <std::size_t I>
+        static R call(Args... args)
+        {
+            auto &s = slots_[I];
+            return s.invoke(s.storage, std::forward<Args>(args)...);
+        }
+
+        template <std::size_t... I>
+        static constexpr std::array<fn_type, N> make_thunks(std::index_sequence<I...>) noexcept
+        {
+            return {&call<I>...};
+        }
+
+        static inline slot slots_[N];
+        static inline std::atomic<std::uint64_t> used_[word_count]{};
+        static constexpr std::array<fn_type, N> thunks_ = make_thunks(std::make_index_sequence<N>{});
+    };
+}
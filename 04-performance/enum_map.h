@@ -0,0 +1,310 @@
+/// 列挙型をキーにした配列(enum_map)とビット集合(enum_set)
+// * 01_basic/03-scoped_enum.cpp の Status や Diretion ごとに値を持ちたいとき std::map<Status, T> を使うと、
+//   要素ごとにノードを確保し、検索のたびに木をたどる
+// * enum_reflect.h で列挙子の数と番号がコンパイル時にわかるので、
+//   - enum_map<E, T> は列挙子の数の std::array に値を置き、キーの番号を添字にする(全ての列挙子の値を常に持つ)
+//   - enum_set<E> は列挙子の番号をビットの位置にしたビット列で、和・積・差は64要素ずつのビット演算になる
+// * どちらも constexpr で使え、走査は列挙子の順(値の小さい順)
+// * operator[] / insert / erase のキーは列挙子であること(デバッグビルドでは assert で確かめる)。
+//   通信で受け取った値をキャストしたものなど、列挙子か分からない値には at / insert_checked(std::out_of_range を投げる)と
+//   contains(列挙子でなければ false)を使う
+#pragma once
+
+#include "enum_reflect.h"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace enum_reflect
+{
+    namespace detail
+    {
+        /// @brief 列挙子の値が連続しているかどうか(連続していれば番号は引き算だけで求まる)
+        template <class E>
+        inline constexpr bool contiguous = count<E> == 0 || max_value<E> - min_value<E> + 1 == static_cast<int>(count<E>);
+
+        /// @brief 列挙子の番号(keyは列挙子であること)
+        template <class E>
+        constexpr std::size_t index(E key) noexcept
+        {
+            assert(index_of(key) && "enum_reflect: not an enumerator");
+            const auto offset = static_cast<std::size_t>(static_cast<long long>(key) - min_value<E>);
+            if constexpr (contiguous<E>)
+                return offset;
+            else
+                return static_cast<std::size_t>(dense_index<E>[offset]);
+        }
+
+        template <class E>
+        constexpr std::size_t checked_index(E key)
+        {
+            const auto i = index_of(key);
+            if (!i)
+                throw std::out_of_range("enum_reflect: not an enumerator");
+            return *i;
+        }
+    }
+
+    template <enumeration E, class T>
+    class enum_map
+    {
+        using storage = std::array<T, count<E>>;
+
+        template <bool Const>
+        class basic_iterator
+        {
+            using ref = std::conditional_t<Const, const T &, T &>;
+            using ptr = std::conditional_t<Const, const T *, T *>;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = std::pair<E, ref>;
+            using difference_type = std::ptrdiff_t;
+
+            constexpr basic_iterator() noexcept = default;
+            constexpr basic_iterator(ptr values, std::size_t i) noexcept : values_(values), i_(i) {}
+
+            /// @brief (キー, 値への参照)の組。for (auto [key, value] : map) で受ける
+            constexpr value_type operator*() const noexcept { return {enum_reflect::values<E>[i_], values_[i_]}; }
+            constexpr basic_iterator &operator++() noexcept
+            {
+                i_++;
+                return *this;
+            }
+            constexpr basic_iterator operator++(int) noexcept
+            {
+                auto old = *this;
+                i_++;
+                return old;
+            }
+            constexpr bool operator==(const basic_iterator &other) const noexcept { return i_ == other.i_; }
+
+        private:
+            ptr values_ = nullptr;
+            std::size_t i_ = 0;
+        };
+
+    public:
+        using key_type = E;
+        using mapped_type = T;
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        constexpr enum_map() = default;
+
+        /// @brief 全ての値をvalueにする
+        constexpr explicit enum_map(const T &value) { values_.fill(value); }
+
+        /// @brief {{key, value}, ...} で初期化する。書かれなかったキーの値は T{}
+        constexpr enum_map(std::initializer_list<std::pair<E, T>> init)
+        {
+            for (const auto &[key, value] : init)
+                values_[detail::checked_index(key)] = value;
+        }
+
+        static constexpr std::size_t size() noexcept { return count<E>; }
+
+        /// @brief keyは列挙子であること(調べない)
+        constexpr T &operator[](E key) noexcept { return values_[detail::index(key)]; }
+        constexpr const T &operator[](E key) const noexcept { return values_[detail::index(key)]; }
+
+        /// @brief 列挙子でなければ std::out_of_range を投げる
+        constexpr T &at(E key) { return values_[detail::checked_index(key)]; }
+        constexpr const T &at(E key) const { return values_[detail::checked_index(key)]; }
+
+        constexpr void fill(const T &value) { values_.fill(value); }
+
+        /// @brief 値の配列(列挙子の順)。SIMDで合計する場合などに使う
+        constexpr std::span<T, count<E>> data() noexcept { return values_; }
+        constexpr std::span<const T, count<E>> data() const noexcept { return values_; }
+
+        constexpr iterator begin() noexcept { return {values_.data(), 0}; }
+        constexpr iterator end() noexcept { return {values_.data(), count<E>}; }
+        constexpr const_iterator begin() const noexcept { return {values_.data(), 0}; }
+        constexpr const_iterator end() const noexcept { return {values_.data(), count<E>}; }
+
+        friend constexpr bool operator==(const enum_map &, const enum_map &) = default;
+
+    private:
+        storage values_{};
+    };
+
+    template <enumeration E>
+    class enum_set
+    {
+        static constexpr std::size_t word_bits = 64;
+        static constexpr std::size_t word_count = (count<E> + word_bits - 1) / word_bits;
+        using words = std::array<std::uint64_t, word_count>;
+
+    public:
+        using key_type = E;
+        using value_type = E;
+
+        /// @brief 集合の要素を列挙子の順にたどる(立っているビットを countr_zero で探す)
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = E;
+            using difference_type = std::ptrdiff_t;
+
+            constexpr iterator() noexcept = default;
+            constexpr iterator(const words *bits, std::size_t i) noexcept : bits_(bits), i_(i) { skip(); }
+
+            constexpr E operator*() const noexcept { return enum_reflect::values<E>[i_]; }
+            constexpr iterator &operator++() noexcept
+            {
+                i_++;
+                skip();
+                return *this;
+            }
+            constexpr iterator operator++(int) noexcept
+            {
+                auto old = *this;
+                ++*this;
+                return old;
+            }
+            constexpr bool operator==(const iterator &other) const noexcept { return i_ == other.i_; }
+
+        private:
+            constexpr void skip() noexcept
+            {
+                while (i_ < count<E>)
+                {
+                    const auto rest = (*bits_)[i_ / word_bits] >> (i_ % word_bits);
+                    if (rest != 0)
+                    {
+                        i_ += static_cast<std::size_t>(std::countr_zero(rest));
+                        return;
+                    }
+                    i_ = (i_ / word_bits + 1) * word_bits;
+                }
+                i_ = count<E>;
+            }
+
+            const words *bits_ = nullptr;
+            std::size_t i_ = count<E>;
+        };
+        using const_iterator = iterator;
+
+        constexpr enum_set() noexcept = default;
+
+        constexpr enum_set(std::initializer_list<E> keys)
+        {
+            for (auto key : keys)
+                insert_checked(key);
+        }
+
+        /// @brief 全ての列挙子を含む集合
+        static constexpr enum_set all() noexcept
+        {
+            enum_set s;
+            for (std::size_t i = 0; i < count<E>; i++)
+                s.bits_[i / word_bits] |= std::uint64_t{1} << (i % word_bits);
+            return s;
+        }
+
+        static constexpr std::size_t max_size() noexcept { return count<E>; }
+
+        constexpr std::size_t size() const noexcept
+        {
+            std::size_t n = 0;
+            for (auto w : bits_)
+                n += static_cast<std::size_t>(std::popcount(w));
+            return n;
+        }
+
+        constexpr bool empty() const noexcept
+        {
+            for (auto w : bits_)
+                if (w != 0)
+                    return false;
+            return true;
+        }
+
+        /// @brief 含むか。列挙子でない値なら false
+        constexpr bool contains(E key) const noexcept
+        {
+            const auto i = index_of(key);
+            return i && ((bits_[*i / word_bits] >> (*i % word_bits)) & 1);
+        }
+
+        /// @brief 追加する。追加されたら(元々なければ)true。keyは列挙子であること(調べない)
+        constexpr bool insert(E key) noexcept
+        {
+            const auto i = detail::index(key);
+            const auto bit = std::uint64_t{1} << (i % word_bits);
+            const bool inserted = !(bits_[i / word_bits] & bit);
+            bits_[i / word_bits] |= bit;
+            return inserted;
+        }
+
+        /// @brief 列挙子でなければ std::out_of_range を投げる
+        constexpr bool insert_checked(E key)
+        {
+            (void)detail::checked_index(key);
+            return insert(key);
+        }
+
+        /// @brief 取り除く。取り除かれたら(元々あれば)true。keyは列挙子であること(調べない)
+        constexpr bool erase(E key) noexcept
+        {
+            const auto i = detail::index(key);
+            const auto bit = std::uint64_t{1} << (i % word_bits);
+            const bool erased = bits_[i / word_bits] & bit;
+            bits_[i / word_bits] &= ~bit;
+            return erased;
+        }
+
+        constexpr void clear() noexcept { bits_ = {}; }
+
+        /// @brief otherの要素を全て含むか
+        constexpr bool includes(const enum_set &other) const noexcept
+        {
+            for (std::size_t w = 0; w < word_count; w++)
+                if (other.bits_[w] & ~bits_[w])
+                    return false;
+            return true;
+        }
+
+        constexpr enum_set &operator|=(const enum_set &other) noexcept { return apply(other, [](auto a, auto b) { return a | b; }); }
+        constexpr enum_set &operator&=(const enum_set &other) noexcept { return apply(other, [](auto a, auto b) { return a & b; }); }
+        constexpr enum_set &operator-=(const enum_set &other) noexcept { return apply(other, [](auto a, auto b) { return a & ~b; }); }
+        constexpr enum_set &operator^=(const enum_set &other) noexcept { return apply(other, [](auto a, auto b) { return a ^ b; }); }
+
+        friend constexpr enum_set operator|(enum_set a, const enum_set &b) noexcept { return a |= b; }
+        friend constexpr enum_set operator&(enum_set a, const enum_set &b) noexcept { return a &= b; }
+        friend constexpr enum_set operator-(enum_set a, const enum_set &b) noexcept { return a -= b; }
+        friend constexpr enum_set operator^(enum_set a, const enum_set &b) noexcept { return a ^= b; }
+
+        /// @brief 補集合(列挙子の数を超えるビットは立てない)
+        constexpr enum_set operator~() const noexcept { return all() - *this; }
+
+        friend constexpr bool operator==(const enum_set &, const enum_set &) = default;
+
+        constexpr iterator begin() const noexcept { return {&bits_, 0}; }
+        constexpr iterator end() const noexcept { return {&bits_, count<E>}; }
+
+        /// @brief ビット列(列挙子の番号iは bits()[i / 64] の i % 64 ビット目)
+        constexpr const words &bits() const noexcept { return bits_; }
+
+    private:
+        template <class F>
+        constexpr enum_set &apply(const enum_set &other, F f) noexcept
+        {
+            for (std::size_t w = 0; w < word_count; w++)
+                bits_[w] = f(bits_[w], other.bits_[w]);
+            return *this;
+        }
+
+        words bits_{};
+    };
+}
@@ -0,0 +1,294 @@
+/// 列挙型の列挙子の名前と値をコンパイル時に調べる(リフレクション)
+// * 01_basic/03-scoped_enum.cpp では、Diretion を表示するにも static_cast<int> するしかなく、名前は得られない
+// * 列挙子を非型テンプレート引数にした関数の __PRETTY_FUNCTION__ には「Diretion::up」のように名前が入り、
+//   列挙子がない値は「(Diretion)4」になる(GCC/Clang)。これを enum_range の範囲の全ての値について調べる
+//   - 範囲は既定で符号付きなら[-128, 127]、符号なしなら[0, 255](基になる型に収まる範囲)。enum_range の特殊化で変えられる
+//   - 範囲外の列挙子は見つからない。範囲を広げるとコンパイル時間が延びる
+//   - 基になる型を指定しない古い enum は、列挙子が収まるビット幅の外の値にキャストできない(定数式でエラー)ので、
+//     enum_range を特殊化して範囲を狭める
+// * to_string は「値 - 最小値」を添字とする配列、from_string はコンパイル時に作った完全ハッシュ(衝突のない表)で引く。
+//   表はすべて constexpr の変数で、実行時の初期化はない
+// * 同じ値の列挙子が複数あるときは、最初のもの(__PRETTY_FUNCTION__ に出るもの)だけになる
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace enum_reflect
+{
+    /// @brief 列挙子を探す値の範囲。特殊化して変える
+    template <class E>
+    struct enum_range
+    {
+        using underlying = std::underlying_type_t<E>;
+        // unsigned int や int64_t の最小値・最大値を int にすると壊れるので、long long で丸めてから int にする
+        static constexpr int min = static_cast<int>(std::is_signed_v<underlying> ? std::max<long long>(-128, std::numeric_limits<underlying>::min()) : 0);
+        static constexpr int max = static_cast<int>(std::is_signed_v<underlying> ? std::min<long long>(127, std::numeric_limits<underlying>::max()) : std::min<unsigned long long>(255, std::numeric_limits<underlying>::max()));
+        static_assert(min <= max);
+    };
+
+    template <class E>
+    concept enumeration = std::is_enum_v<E>;
+
+    namespace detail
+    {
+        template <auto V>
+        constexpr std::string_view pretty_name() noexcept
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            const std::string_view s = __PRETTY_FUNCTION__; // "... [with auto V = Diretion::up]"
+            const auto first = s.find("V = ") + 4;
+            const auto value = s.substr(first, s.find_first_of(";]", first) - first);
+            if (value.empty() || value.front() == '(' || value.front() == '-' || (value.front() >= '0' && value.front() <= '9'))
+                return {}; // 列挙子がない値
+            const auto colon = value.rfind("::");
+            return colon == std::string_view::npos ? value : value.substr(colon + 2);
+#else
+            static_assert(V != V, "enum_reflect は GCC/Clang でのみ使える");
+            return {};
+#endif
+        }
+
+        /// @brief 名前を入れておく固定長の文字列(__PRETTY_FUNCTION__ の一部を直接指さないようにコピーする)
+        template <std::size_t N>
+        struct static_string
+        {
+            constexpr explicit static_string(std::string_view s) noexcept
+            {
+                for (std::size_t i = 0; i < N; i++)
+                    chars[i] = s[i];
+            }
+            constexpr std::string_view view() const noexcept { return {chars.data(), N}; }
+            std::array<char, N + 1> chars{}; // 終端の'\0'つき
+        };
+
+        template <auto V>
+        inline constexpr auto name_storage = static_string<pretty_name<V>().size()>(pretty_name<V>());
+
+        template <class E>
+        constexpr int range_size = enum_range<E>::max - enum_range<E>::min + 1;
+
+        /// @brief 範囲内の各値に列挙子があるかどうか
+        template <class E, std::size_t... I>
+        constexpr auto scan(std::index_sequence<I...>) noexcept
+        {
+            return std::array<bool, sizeof...(I)>{!pretty_name<static_cast<E>(enum_range<E>::min + static_cast<int>(I))>().empty()...};
+        }
+
+        template <class E>
+        inline constexpr auto valid = scan<E>(std::make_index_sequence<range_size<E>>{});
+
+        template <class E>
+        inline constexpr std::size_t count = [] {
+            std::size_t n = 0;
+            for (bool v : valid<E>)
+                n += v;
+            return n;
+        }();
+
+        template <class E, std::size_t... I>
+        constexpr auto make_values(std::index_sequence<I...>) noexcept
+        {
+            std::array<E, count<E>> values{};
+            std::size_t n = 0;
+            ((valid<E>[I] ? void(values[n++] = static_cast<E>(enum_range<E>::min + static_cast<int>(I))) : void()), ...);
+            return values;
+        }
+
+        template <class E>
+        inline constexpr auto values = make_values<E>(std::make_index_sequence<range_size<E>>{});
+
+        template <class E, std::size_t... I>
+        constexpr auto make_names(std::index_sequence<I...>) noexcept
+        {
+            return std::array<std::string_view, sizeof...(I)>{name_storage<values<E>[I]>.view()...};
+        }
+
+        template <class E>
+        inline constexpr auto names = make_names<E>(std::make_index_sequence<count<E>>{});
+
+        /// @brief 値の最小値・最大値(列挙子がなければ0)
+        template <class E>
+        inline constexpr int min_value = count<E> ? static_cast<int>(values<E>.front()) : 0;
+        template <class E>
+        inline constexpr int max_value = count<E> ? static_cast<int>(values<E>.back()) : 0;
+
+        /// @brief 「値 - 最小値」から列挙子の番号(なければ -1)を引く配列
+        template <class E>
+        inline constexpr auto dense_index = [] {
+            using index_t = std::conditional_t<(count<E> < 128), std::int8_t, std::int16_t>;
+            std::array<index_t, static_cast<std::size_t>(max_value<E> - min_value<E> + 1)> table{};
+            for (auto &t : table)
+                t = -1;
+            for (std::size_t i = 0; i < count<E>; i++)
+                table[static_cast<std::size_t>(static_cast<int>(values<E>[i]) - min_value<E>)] = static_cast<index_t>(i);
+            return table;
+        }();
+
+        /// @brief from_string 用のハッシュ(64bit FNV-1a の初期値を seed にしたもの)。上位32bitと下位32bitを別々に使う
+        constexpr std::uint64_t hash(std::string_view s, std::uint64_t seed) noexcept
+        {
+            std::uint64_t h = seed;
+            for (char c : s)
+                h = (h ^ static_cast<std::uint8_t>(c)) * 0x100000001B3ull;
+            return h ^ (h >> 29);
+        }
+
+        /// @brief 上位32bitとバケットごとのずらし量 d から表の位置を作る
+        constexpr std::uint32_t displace(std::uint64_t h, std::uint32_t d) noexcept
+        {
+            auto x = static_cast<std::uint32_t>(h >> 32) ^ (d * 0x9E3779B9u);
+            x ^= x >> 16;
+            x *= 0x85EBCA6Bu;
+            return x ^ (x >> 13);
+        }
+
+        template <std::size_t Size, std::size_t Buckets>
+        struct perfect_hash_table
+        {
+            std::uint64_t seed = 0;
+            std::uint32_t mask = 0;                        // 表の大きさ - 1
+            std::uint32_t bucket_mask = 0;                 // バケットの数 - 1
+            std::array<std::uint32_t, Buckets> displace{}; // バケットごとのずらし量
+            std::array<std::int16_t, Size> slots{};        // 列挙子の番号、空きは -1
+        };
+
+        /// @brief 名前が衝突しない表を作る(hash and displace)
+        ///  1. 下位32bitで名前をバケット(平均2個以下)に分ける
+        ///  2. 名前の多いバケットから順に、そのバケットの名前が全て空いた位置に入るずらし量 d を探す
+        ///  1つの seed で全ての名前が衝突しないことを求める方法と違い、列挙子が数百あっても少ない試行で見つかる
+        template <class E>
+        constexpr auto make_perfect_hash() noexcept
+        {
+            constexpr std::size_t n = count<E>;
+            constexpr std::size_t size = std::bit_ceil(n * 2 + 1);
+            constexpr std::size_t buckets = std::bit_ceil(n / 2 + 1);
+            perfect_hash_table<size, buckets> table{};
+            table.mask = static_cast<std::uint32_t>(size - 1);
+            table.bucket_mask = static_cast<std::uint32_t>(buckets - 1);
+            std::array<std::uint64_t, n> hashes{};
+            std::array<std::size_t, n> members{};         // バケットの順に並べた列挙子の番号
+            std::array<std::size_t, buckets + 1> first{}; // バケットbの列挙子は members[first[b]..first[b+1])
+            for (std::uint64_t seed = 0xCBF29CE484222325ull;; seed += 0x9E3779B97F4A7C15ull)
+            {
+                table.seed = seed;
+                for (auto &s : table.slots)
+                    s = -1;
+                for (auto &f : first)
+                    f = 0;
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    hashes[i] = hash(names<E>[i], seed);
+                    first[(hashes[i] & table.bucket_mask) + 1]++;
+                }
+                std::size_t largest = 0;
+                for (std::size_t b = 0; b < buckets; b++)
+                {
+                    largest = std::max(largest, first[b + 1]);
+                    first[b + 1] += first[b];
+                }
+                auto next = first;
+                for (std::size_t i = 0; i < n; i++)
+                    members[next[hashes[i] & table.bucket_mask]++] = i;
+
+                bool ok = true;
+                for (std::size_t k = largest; k > 0 && ok; k--)
+                {
+                    for (std::size_t b = 0; b < buckets && ok; b++)
+                    {
+                        if (first[b + 1] - first[b] != k)
+                            continue;
+                        // 同じ64bitのハッシュを持つ名前があると、どの d でも分けられない。そのときは seed を変える
+                        ok = false;
+                        for (std::uint32_t d = 0; d < 4096 && !ok; d++)
+                        {
+                            std::size_t placed = first[b];
+                            for (; placed < first[b + 1]; placed++)
+                            {
+                                auto &slot = table.slots[displace(hashes[members[placed]], d) & table.mask];
+                                if (slot >= 0)
+                                    break;
+                                slot = static_cast<std::int16_t>(members[placed]);
+                            }
+                            ok = placed == first[b + 1];
+                            if (ok)
+                                table.displace[b] = d;
+                            else // このバケットで置いた分を戻す
+                                for (std::size_t j = first[b]; j < placed; j++)
+                                    table.slots[displace(hashes[members[j]], d) & table.mask] = -1;
+                        }
+                    }
+                }
+                if (ok)
+                    return table;
+            }
+        }
+
+        template <class E>
+        inline constexpr auto perfect_hash = make_perfect_hash<E>();
+    }
+
+    /// @brief 列挙子の数
+    template <enumeration E>
+    inline constexpr std::size_t count = detail::count<E>;
+
+    /// @brief 列挙子の値(値の小さい順)
+    template <enumeration E>
+    inline constexpr const auto &values = detail::values<E>;
+
+    /// @brief 列挙子の名前(values<E> と同じ順)
+    template <enumeration E>
+    inline constexpr const auto &names = detail::names<E>;
+
+    /// @brief 列挙子の番号(values<E> での位置)。列挙子がない値なら std::nullopt
+    template <enumeration E>
+    constexpr std::optional<std::size_t> index_of(E value) noexcept
+    {
+        const auto offset = static_cast<long long>(value) - detail::min_value<E>;
+        if (count<E> == 0 || offset < 0 || offset >= static_cast<long long>(detail::dense_index<E>.size()))
+            return std::nullopt;
+        const auto i = detail::dense_index<E>[static_cast<std::size_t>(offset)];
+        return i < 0 ? std::nullopt : std::optional<std::size_t>(static_cast<std::size_t>(i));
+    }
+
+    template <enumeration E>
+    constexpr bool contains(E value) noexcept { return index_of(value).has_value(); }
+
+    /// @brief 列挙子の名前。列挙子がない値なら空文字列
+    template <enumeration E>
+    constexpr std::string_view to_string(E value) noexcept
+    {
+        const auto i = index_of(value);
+        return i ? names<E>[*i] : std::string_view{};
+    }
+
+    /// @brief 名前から列挙子を引く(大文字小文字を区別する)。見つからなければ std::nullopt
+    template <enumeration E>
+    constexpr std::optional<E> from_string(std::string_view name) noexcept
+    {
+        if constexpr (count<E> == 0)
+            return (void)name, std::nullopt;
+        else
+        {
+            constexpr const auto &table = detail::perfect_hash<E>;
+            const auto h = detail::hash(name, table.seed);
+            const auto i = table.slots[detail::displace(h, table.displace[h & table.bucket_mask]) & table.mask];
+            if (i < 0 || names<E>[static_cast<std::size_t>(i)] != name)
+                return std::nullopt;
+            return values<E>[static_cast<std::size_t>(i)];
+        }
+    }
+
+    /// @brief 基になる型の値(std::to_underlying はC++23)
+    template <enumeration E>
+    constexpr std::underlying_type_t<E> to_underlying(E value) noexcept { return static_cast<std::underlying_type_t<E>>(value); }
+}
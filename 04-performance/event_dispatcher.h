@@ -0,0 +1,264 @@
+/// 多数の購読者へイベントを配るディスパッチャ(signal/slot)
+// * 01_basic/04-lambda.cpp の function_with_callback はコールバックを1つだけ受ける。購読者が数百あるとき
+//   std::function を1つずつノードに入れると、キャプチャとノードがヒープのあちこちに散らばる
+// * dispatcher<void(Args...), Capacity> は購読者のラムダを要素の中のバッファに直接置き、
+//   1本の std::vector に接続順に並べる(呼び出しは配列を先頭からなめるだけ)
+//   - 型消去は inplace_function.h と同じ形だが、呼び出し用の関数ポインタだけは要素に直接持つ
+//     (vtable を経由すると呼び出しごとに間接参照が1回増え、std::function より遅くなる)
+//   - connect は connection (接続ごとに増える番号)を返し、disconnect はその番号を二分探索して外す
+//   - 外した購読者は印を付けるだけで、外したものが半分を超えたら(配っていないときに)配列をまとめて詰める
+//   - 配っている最中(購読者の中から)の connect / disconnect もできる。connect した購読者は次に配るときから呼ばれる
+//   - emit_each はイベントの配列を、購読者ごとにまとめて配る(購読者のキャプチャと命令がキャッシュに載ったまま)
+// * スレッドセーフではない
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace events
+{
+    /// @brief 接続を表す番号。既定値はどの接続も表さない
+    struct connection
+    {
+        std::uint64_t id = 0;
+
+        constexpr explicit operator bool() const noexcept { return id != 0; }
+        friend constexpr bool operator==(connection, connection) noexcept = default;
+    };
+
+    template <class Signature, std::size_t Capacity = 32>
+    class dispatcher; // 宣言のみ。関数型で特殊化したものを使う
+
+    template <class... Args, std::size_t Capacity>
+    class dispatcher<void(Args...), Capacity>
+    {
+    public:
+        dispatcher() = default;
+        dispatcher(const dispatcher &) = delete; // 購読者が this をキャプチャしていることが多いのでコピーさせない
+        dispatcher &operator=(const dispatcher &) = delete;
+
+        /// @brief 接続している購読者の数
+        std::size_t size() const noexcept { return slots_.size() + pending_.size() - removed_; }
+        bool empty() const noexcept { return size() == 0; }
+
+        void reserve(std::size_t n) { slots_.reserve(n); }
+
+        /// @brief 購読者をつなぐ。Capacity バイトを超えるキャプチャはコンパイルエラー
+        template <class F>
+        connection connect(F &&f)
+        {
+            const connection c{++last_id_};
+            if (depth_ == 0)
+            {
+                slots_.emplace_back(std::forward<F>(f), c.id);
+                return c;
+            }
+            // 配っている最中は配列を伸ばせない(呼び出し中のラムダが動いてしまう)ので、終わってから加える。
+            // 加えるのはデストラクタ(dispatch_scope)の中で、そこで確保に失敗すると terminate になるので、
+            // 合わせた大きさを先に pending_ に確保しておく(flush では pending_ と slots_ を入れ替える)
+            pending_.reserve(slots_.size() + pending_.size() + 1);
+            pending_.emplace_back(std::forward<F>(f), c.id);
+            return c;
+        }
+
+        /// @brief 購読者を外す。外したら(つながっていれば)true
+        bool disconnect(connection c) noexcept
+        {
+            if (auto *s = find(slots_, c))
+            {
+                s->active = false; // 印を付けるだけ。外したものが半分を超えたら、配っていないときにまとめて詰める
+                removed_++;
+                compact_if_idle(false);
+                return true;
+            }
+            if (auto *s = find(pending_, c))
+            {
+                pending_.erase(pending_.begin() + (s - pending_.data()));
+                return true;
+            }
+            return false;
+        }
+
+        bool connected(connection c) const noexcept
+        {
+            return find(slots_, c) || find(pending_, c);
+        }
+
+        void disconnect_all() noexcept
+        {
+            for (auto &s : slots_)
+                s.active = false;
+            removed_ = slots_.size();
+            pending_.clear();
+            compact_if_idle(true);
+        }
+
+        /// @brief 全ての購読者を接続順に呼ぶ
+        void emit(Args... args)
+        {
+            const dispatch_scope scope{*this};
+            // 配っている間は配列が再確保されないので、先頭と末尾を先に取っておける
+            for (slot *s = slots_.data(), *last = s + slots_.size(); s != last; ++s)
+            {
+                if (s->active)
+                    s->invoke(s->storage, args...);
+            }
+        }
+
+        /// @brief eventsの各要素を全ての購読者へ配る。購読者ごとに、全てのイベントを順に渡してから次の購読者へ進む
+        ///  (イベントの順は保たれるが、購読者をまたいだ順は emit を繰り返す場合と異なる)
+        /// @param events 引数が1つならその型の配列、複数なら std::tuple<Args...> の配列
+        template <class Event>
+        void emit_each(std::span<const Event> events)
+        {
+            const dispatch_scope scope{*this};
+            for (slot *s = slots_.data(), *last = s + slots_.size(); s != last; ++s)
+            {
+                for (const auto &e : events)
+                {
+                    if (!s->active) // 途中で外された
+                        break;
+                    if constexpr (sizeof...(Args) == 1)
+                        s->invoke(s->storage, e);
+                    else
+                        std::apply([s](const auto &...a)
+                                   { s->invoke(s->storage, a...); },
+                                   e);
+                }
+            }
+        }
+
+        /// @brief 購読者の配列のバイト数
+        std::size_t memory_usage() const noexcept { return (slots_.capacity() + pending_.capacity()) * sizeof(slot); }
+
+    private:
+        /// @brief 購読者1つ分。キャプチャは storage に置き、ムーブと破棄は型ごとの関数テーブルで行う
+        struct slot
+        {
+            struct ops_type
+            {
+                void (*move)(void *dst, void *src) noexcept; // 移動後にsrcは破棄される
+                void (*destroy)(void *storage) noexcept;
+            };
+
+            template <class F>
+            static constexpr ops_type ops_for{
+                [](void *dst, void *src) noexcept
+                {
+                    ::new (dst) F(std::move(*static_cast<F *>(src)));
+                    static_cast<F *>(src)->~F();
+                },
+                [](void *storage) noexcept
+                { static_cast<F *>(storage)->~F(); },
+            };
+
+            template <class F, class D = std::decay_t<F>>
+            slot(F &&f, std::uint64_t id) : id(id)
+            {
+                static_assert(sizeof(D) <= Capacity, "dispatcher: キャプチャが大きすぎる。Capacityを増やすこと");
+                static_assert(alignof(std::max_align_t) % alignof(D) == 0, "dispatcher: キャプチャのアラインメントが大きすぎる");
+                static_assert(std::is_nothrow_move_constructible_v<D>, "dispatcher: ムーブ時に例外を投げる関数オブジェクトは保持できない");
+                static_assert(std::is_invocable_v<D &, Args...>, "dispatcher: 引数の型が合わない");
+                ::new (static_cast<void *>(storage)) D(std::forward<F>(f));
+                invoke = [](void *p, Args... args)
+                { (*static_cast<D *>(p))(args...); };
+                ops = &ops_for<D>;
+            }
+
+            slot(slot &&other) noexcept : invoke(other.invoke), ops(other.ops), id(other.id), active(other.active)
+            {
+                ops->move(storage, other.storage);
+                other.ops = nullptr; // 中身は移した
+            }
+
+            slot &operator=(slot &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    this->~slot();
+                    ::new (this) slot(std::move(other));
+                }
+                return *this;
+            }
+
+            ~slot()
+            {
+                if (ops)
+                    ops->destroy(storage);
+            }
+
+            void (*invoke)(void *storage, Args... args); // 呼び出しは1回の間接参照で済む
+            const ops_type *ops;
+            std::uint64_t id;
+            bool active = true; // falseなら外されている(まだ詰めていない)
+            alignas(std::max_align_t) std::byte storage[Capacity];
+        };
+
+        /// @brief 配っている深さを数え、一番外側の emit が終わったら保留していた変更を反映する(例外で抜けても)
+        struct dispatch_scope
+        {
+            dispatcher &d;
+            explicit dispatch_scope(dispatcher &d) noexcept : d(d) { d.depth_++; }
+            ~dispatch_scope()
+            {
+                if (--d.depth_ == 0)
+                    d.flush();
+            }
+        };
+
+        /// @brief 番号は接続順に増え、配列も接続順なので二分探索できる
+        template <class Slots>
+        static auto find(Slots &slots, connection c) noexcept -> decltype(slots.data())
+        {
+            auto it = std::lower_bound(slots.begin(), slots.end(), c.id, [](const slot &s, std::uint64_t id)
+                                       { return s.id < id; });
+            return it != slots.end() && it->id == c.id && it->active ? &*it : nullptr;
+        }
+
+        void compact_if_idle(bool always) noexcept
+        {
+            if (depth_ == 0 && removed_ != 0 && (always || removed_ * 2 >= slots_.size()))
+            {
+                std::erase_if(slots_, [](const slot &s)
+                              { return !s.active; });
+                removed_ = 0;
+            }
+        }
+
+        /// @brief 保留していた購読者を加える。確保はしない(デストラクタから呼ぶので例外を投げられない)
+        void flush() noexcept
+        {
+            compact_if_idle(false);
+            if (pending_.empty())
+                return;
+            if (slots_.capacity() < slots_.size() + pending_.size())
+            {
+                // pending_ の確保済みの領域(connect で slots_ と合わせた大きさにしてある)へ順に並べ直す
+                const auto n = pending_.size();
+                for (auto &s : slots_)
+                    pending_.push_back(std::move(s)); // 容量内なので確保しない
+                std::rotate(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(n), pending_.end());
+                slots_.swap(pending_);
+            }
+            else
+            {
+                for (auto &s : pending_)
+                    slots_.push_back(std::move(s)); // 容量内なので確保しない
+            }
+            pending_.clear();
+        }
+
+        std::vector<slot> slots_;
+        std::vector<slot> pending_; // 配っている最中につながれた購読者
+        std::size_t removed_ = 0;   // slots_ の中の外された要素の数
+        std::uint64_t last_id_ = 0;
+        int depth_ = 0;
+    };
+}
@@ -0,0 +1,87 @@
+/// ヒープ確保しないPimpl(Fast Pimpl)
+// * 03-technique/05-pimpl.md の unique_ptr<impl> の代わりに、実装クラスをオブジェクト内に直接置く
+//   (ヒープ確保1回とポインタをたどる1回が減る)
+// * ヘッダには大きさとアラインメントの数値だけを書けばよく、実装クラスの定義は隠したままにできる
+// * 特殊メンバ関数(コンストラクタ/デストラクタ/コピー/ムーブ)は、unique_ptr版のPimplと同様に
+//   実装クラスの定義が見える.cpp側で定義すること。そこで大きさの不一致がstatic_assertで検出される
+//
+// 使い方:
+//   // widget.h
+//   class widget {
+//   public:
+//       widget(); ~widget(); // .cppで定義する
+//   private:
+//       class impl;
+//       fast_pimpl<impl, 40, 8> pimpl_; // 40, 8 は sizeof(impl), alignof(impl)
+//   };
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <class T, std::size_t Size, std::size_t Align>
+class fast_pimpl
+{
+public:
+    template <class... Args>
+        requires(!(sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, fast_pimpl> && ...)))
+    explicit fast_pimpl(Args &&...args)
+    {
+        validate<sizeof(T), alignof(T)>();
+        ::new (static_cast<void *>(storage_)) T(std::forward<Args>(args)...);
+    }
+
+    fast_pimpl(const fast_pimpl &other)
+    {
+        validate<sizeof(T), alignof(T)>();
+        ::new (static_cast<void *>(storage_)) T(*other);
+    }
+
+    fast_pimpl(fast_pimpl &&other) noexcept
+    {
+        validate<sizeof(T), alignof(T)>();
+        static_assert(std::is_nothrow_move_constructible_v<T>, "fast_pimpl: Tのムーブコンストラクタはnoexceptにすること");
+        ::new (static_cast<void *>(storage_)) T(std::move(*other));
+    }
+
+    ~fast_pimpl()
+    {
+        validate<sizeof(T), alignof(T)>();
+        get()->~T();
+    }
+
+    // 代入は実装クラスの代入演算子にそのまま任せる
+    // (例外安全性も実装クラスのものと同じになる)
+    fast_pimpl &operator=(const fast_pimpl &other)
+    {
+        **this = *other;
+        return *this;
+    }
+
+    fast_pimpl &operator=(fast_pimpl &&other) noexcept
+    {
+        **this = std::move(*other);
+        return *this;
+    }
+
+    T *operator->() noexcept { return get(); }
+    const T *operator->() const noexcept { return get(); }
+    T &operator*() noexcept { return *get(); }
+    const T &operator*() const noexcept { return *get(); }
+
+private:
+    // エラーメッセージに実際の大きさ(ActualSize/ActualAlign)が表示されるようテンプレート引数で受け取る
+    template <std::size_t ActualSize, std::size_t ActualAlign>
+    static constexpr void validate() noexcept
+    {
+        static_assert(Size == ActualSize, "fast_pimpl: Sizeがsizeof(T)と一致しない。ActualSizeの値に合わせること");
+        static_assert(Align == ActualAlign, "fast_pimpl: Alignがalignof(T)と一致しない。ActualAlignの値に合わせること");
+    }
+
+    T *get() noexcept { return std::launder(reinterpret_cast<T *>(storage_)); }
+    const T *get() const noexcept { return std::launder(reinterpret_cast<const T *>(storage_)); }
+
+    alignas(Align) std::byte storage_[Size];
+};
@@ -0,0 +1,630 @@
+/// オープンアドレス法のハッシュマップ(Swiss table方式)
+// * std::map や std::unordered_map は要素ごとにノードを確保するので、検索のたびにポインタをたどってキャッシュミスが起きる。
+//   flat_hash_map は要素を1つの配列に直接置き、衝突したら隣の位置を探す(オープンアドレス法)
+// * 要素ごとに1バイトの制御バイト(空き/削除済み/ハッシュ値の下位7bit)を別の配列に持ち、
+//   16個の制御バイトをSSE2でまとめて比べて候補を絞る。キーの比較は7bitが一致した位置でだけ行う
+// * キーの型と違う型で検索できる(std::string のキーを std::string_view で引いても一時文字列を作らない)
+// * 最大負荷率は7/8。reserve()/rehash()で容量を先に決められる
+// * 削除した位置には「削除済み」の印を残す(検索が途中で止まらないように)。印が増えたら同じ容量で作り直す
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace flat
+{
+    namespace detail
+    {
+        using ctrl_t = std::int8_t;
+        constexpr ctrl_t ctrl_empty = -128;  // 0b10000000
+        constexpr ctrl_t ctrl_deleted = -2;  // 0b11111110
+        constexpr std::size_t group_width = 16;
+
+        /// @brief 連続する16個の制御バイト。一致した位置をビットマスクで返す
+        struct group
+        {
+#if defined(__SSE2__)
+            explicit group(const ctrl_t *p) noexcept : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+            std::uint32_t match(ctrl_t h2) const noexcept
+            {
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))));
+            }
+
+            std::uint32_t match_empty() const noexcept
+            {
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(ctrl_empty))));
+            }
+
+            /// @brief 空きと削除済みは最上位ビットが1(使用中は0～127)
+            std::uint32_t match_empty_or_deleted() const noexcept
+            {
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl));
+            }
+
+            __m128i ctrl;
+#else
+            explicit group(const ctrl_t *p) noexcept { std::memcpy(ctrl, p, group_width); }
+
+            std::uint32_t match(ctrl_t h2) const noexcept
+            {
+                std::uint32_t bits = 0;
+                for (std::size_t i = 0; i < group_width; i++)
+                    bits |= std::uint32_t{ctrl[i] == h2} << i;
+                return bits;
+            }
+
+            std::uint32_t match_empty() const noexcept { return match(ctrl_empty); }
+
+            std::uint32_t match_empty_or_deleted() const noexcept
+            {
+                std::uint32_t bits = 0;
+                for (std::size_t i = 0; i < group_width; i++)
+                    bits |= std::uint32_t{ctrl[i] < 0} << i;
+                return bits;
+            }
+
+            ctrl_t ctrl[group_width];
+#endif
+        };
+
+        template <bool Transparent>
+        struct key_arg_impl
+        {
+            template <class K, class Key>
+            using type = Key;
+        };
+
+        template <>
+        struct key_arg_impl<true>
+        {
+            template <class K, class Key>
+            using type = K;
+        };
+
+        /// @brief ハッシュ値の全ビットを混ぜる(std::hash<整数>は値そのものを返す実装が多いので、そのままでは下位7bitが偏る)
+        constexpr std::uint64_t mix(std::uint64_t h) noexcept
+        {
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+            return h;
+        }
+    }
+
+    /// @brief 既定のハッシュ関数(std::hashの結果を混ぜる)
+    template <class Key>
+    struct hash
+    {
+        std::size_t operator()(const Key &key) const noexcept(noexcept(std::hash<Key>{}(key)))
+        {
+            return detail::mix(std::hash<Key>{}(key));
+        }
+    };
+
+    /// @brief std::string のキーは std::string_view や const char* でも引けるようにする
+    template <>
+    struct hash<std::string>
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view key) const noexcept
+        {
+            return detail::mix(std::hash<std::string_view>{}(key));
+        }
+    };
+
+    template <class Key, class T, class Hash = hash<Key>, class KeyEqual = std::equal_to<>>
+    class flat_hash_map
+    {
+        static constexpr bool transparent = requires { typename Hash::is_transparent; };
+
+        /// @brief 検索に使うキーの型。transparentならKのまま(推論できる)、そうでなければKey
+        template <class K>
+        using key_arg = typename detail::key_arg_impl<transparent>::template type<K, Key>;
+
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<const Key, T>;
+        using size_type = std::size_t;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+
+        template <bool Const>
+        class basic_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = flat_hash_map::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+            using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+            basic_iterator() = default;
+
+            /// @brief iterator から const_iterator への変換
+            template <bool C = Const>
+                requires C
+            basic_iterator(const basic_iterator<false> &other) noexcept
+                : ctrl_(other.ctrl_), slot_(other.slot_), end_(other.end_)
+            {
+            }
+
+            reference operator*() const noexcept { return *slot_; }
+            pointer operator->() const noexcept { return slot_; }
+
+            basic_iterator &operator++() noexcept
+            {
+                ++ctrl_;
+                ++slot_;
+                skip_free();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const basic_iterator &a, const basic_iterator &b) noexcept { return a.ctrl_ == b.ctrl_; }
+
+        private:
+            friend class flat_hash_map;
+            template <bool>
+            friend class basic_iterator;
+
+            basic_iterator(const detail::ctrl_t *ctrl, pointer slot, const detail::ctrl_t *end) noexcept
+                : ctrl_(ctrl), slot_(slot), end_(end)
+            {
+            }
+
+            /// @brief 使用中の位置まで進める(16個ずつまとめて調べる)
+            void skip_free() noexcept
+            {
+                if (ctrl_ != end_ && *ctrl_ >= 0) // 次が使用中なら調べるまでもない
+                    return;
+                while (ctrl_ < end_)
+                {
+                    // 末尾の先は先頭の制御バイトの複製なので、読んでもよいが結果はend_で打ち切る
+                    const auto full = ~detail::group(ctrl_).match_empty_or_deleted() & 0xFFFF;
+                    if (full != 0)
+                    {
+                        const auto k = std::countr_zero(full);
+                        ctrl_ += k;
+                        slot_ += k;
+                        break;
+                    }
+                    ctrl_ += detail::group_width;
+                    slot_ += detail::group_width;
+                }
+                if (ctrl_ > end_)
+                {
+                    slot_ -= ctrl_ - end_;
+                    ctrl_ = end_;
+                }
+            }
+
+            const detail::ctrl_t *ctrl_ = nullptr;
+            pointer slot_ = nullptr;
+            const detail::ctrl_t *end_ = nullptr;
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        flat_hash_map() = default;
+
+        explicit flat_hash_map(size_type n) { reserve(n); }
+
+        flat_hash_map(std::initializer_list<value_type> init)
+        {
+            reserve(init.size());
+            for (const auto &v : init)
+                insert(v);
+        }
+
+        flat_hash_map(const flat_hash_map &other)
+            : hash_(other.hash_), eq_(other.eq_)
+        {
+            reserve(other.size());
+            for (const auto &v : other)
+                insert(v);
+        }
+
+        flat_hash_map(flat_hash_map &&other) noexcept { swap(other); }
+
+        flat_hash_map &operator=(flat_hash_map other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~flat_hash_map() { release(); }
+
+        void swap(flat_hash_map &other) noexcept
+        {
+            std::swap(ctrl_, other.ctrl_);
+            std::swap(slots_, other.slots_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(size_, other.size_);
+            std::swap(growth_left_, other.growth_left_);
+            std::swap(hash_, other.hash_);
+            std::swap(eq_, other.eq_);
+        }
+
+        size_type size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        /// @brief 要素を置ける位置の数(2のべき乗)
+        size_type capacity() const noexcept { return capacity_; }
+
+        float load_factor() const noexcept { return capacity_ == 0 ? 0.0f : static_cast<float>(size_) / static_cast<float>(capacity_); }
+
+        iterator begin() noexcept { return make_begin<iterator>(ctrl_, slots_); }
+        iterator end() noexcept { return {ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_}; }
+        const_iterator begin() const noexcept { return make_begin<const_iterator>(ctrl_, slots_); }
+        const_iterator end() const noexcept { return {ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_}; }
+
+        /// @brief n要素を入れても作り直しが起きないように容量を確保する
+        void reserve(size_type n)
+        {
+            const auto needed = capacity_for(n);
+            if (needed > capacity_)
+                resize(needed);
+        }
+
+        /// @brief 容量をn要素分(ただし今の要素数が入る大きさ以上)にして作り直す。0なら要素数に合わせて縮める
+        void rehash(size_type n)
+        {
+            const auto needed = std::max(capacity_for(n), capacity_for(size_));
+            if (needed == 0)
+            {
+                release();
+                return;
+            }
+            resize(needed);
+        }
+
+        void clear() noexcept
+        {
+            if (capacity_ == 0)
+                return;
+            destroy_all();
+            std::memset(ctrl_, detail::ctrl_empty, capacity_ + detail::group_width - 1);
+            size_ = 0;
+            growth_left_ = max_load(capacity_);
+        }
+
+        //
+        // 検索と削除のキー(Hashが is_transparent を持つ場合は、キーと比較できる別の型でもよい)
+        //
+
+        template <class K = Key>
+        iterator find(const key_arg<K> &key) noexcept
+        {
+            const auto i = find_index(key);
+            return i == npos ? end() : iterator{ctrl_ + i, slots_ + i, ctrl_ + capacity_};
+        }
+
+        template <class K = Key>
+        const_iterator find(const key_arg<K> &key) const noexcept
+        {
+            const auto i = find_index(key);
+            return i == npos ? end() : const_iterator{ctrl_ + i, slots_ + i, ctrl_ + capacity_};
+        }
+
+        template <class K = Key>
+        bool contains(const key_arg<K> &key) const noexcept { return find_index(key) != npos; }
+
+        template <class K = Key>
+        size_type count(const key_arg<K> &key) const noexcept { return contains(key) ? 1 : 0; }
+
+        //
+        // 挿入
+        //
+
+        /// @brief keyがなければ T(args...) を挿入する。あれば何もしない
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(const Key &key, Args &&...args)
+        {
+            return try_emplace_impl(key, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(Key &&key, Args &&...args)
+        {
+            return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
+        }
+
+        /// @brief キーと比較できる別の型で渡す。挿入するときだけKeyを作る
+        template <class K, class... Args>
+            requires(transparent && !std::is_convertible_v<K &&, const Key &> && std::is_constructible_v<Key, K &&>)
+        std::pair<iterator, bool> try_emplace(K &&key, Args &&...args)
+        {
+            return try_emplace_impl(std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+        std::pair<iterator, bool> insert(value_type &&value) { return try_emplace(value.first, std::move(value.second)); }
+
+        template <class... Args>
+        std::pair<iterator, bool> emplace(Args &&...args)
+        {
+            value_type value(std::forward<Args>(args)...);
+            return insert(std::move(value));
+        }
+
+        /// @brief keyがあれば値を上書きし、なければ挿入する
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(const Key &key, M &&obj)
+        {
+            if (auto it = find(key); it != end())
+            {
+                it->second = std::forward<M>(obj);
+                return {it, false};
+            }
+            return try_emplace(key, std::forward<M>(obj));
+        }
+
+        T &operator[](const Key &key) { return try_emplace(key).first->second; }
+        T &operator[](Key &&key) { return try_emplace(std::move(key)).first->second; }
+
+        template <class K>
+            requires(transparent && !std::is_convertible_v<K &&, const Key &> && std::is_constructible_v<Key, K &&>)
+        T &operator[](K &&key)
+        {
+            return try_emplace(std::forward<K>(key)).first->second;
+        }
+
+        //
+        // 削除
+        //
+
+        void erase(const_iterator it) noexcept { erase_at(static_cast<size_type>(it.ctrl_ - ctrl_)); }
+        void erase(iterator it) noexcept { erase_at(static_cast<size_type>(it.ctrl_ - ctrl_)); }
+
+        template <class K = Key>
+        size_type erase(const key_arg<K> &key) noexcept
+        {
+            const auto i = find_index(key);
+            if (i == npos)
+                return 0;
+            erase_at(i);
+            return 1;
+        }
+
+        /// @brief 確保しているバイト数(要素の配列と制御バイト)
+        size_type memory_usage() const noexcept
+        {
+            return capacity_ == 0 ? 0 : capacity_ * sizeof(value_type) + capacity_ + detail::group_width - 1;
+        }
+
+    private:
+        static constexpr size_type npos = static_cast<size_type>(-1);
+
+        static constexpr size_type max_load(size_type capacity) noexcept { return capacity - capacity / 8; }
+
+        /// @brief n要素を入れるのに必要な容量(最大負荷率7/8、最小はグループ幅)
+        static constexpr size_type capacity_for(size_type n) noexcept
+        {
+            if (n == 0)
+                return 0;
+            return std::bit_ceil(std::max(detail::group_width, n + (n + 6) / 7));
+        }
+
+        /// @brief ハッシュ値の上位をグループの探索開始位置、下位7bitを制御バイトに使う
+        static constexpr size_type h1(size_type hash) noexcept { return hash >> 7; }
+        static constexpr detail::ctrl_t h2(size_type hash) noexcept { return static_cast<detail::ctrl_t>(hash & 0x7F); }
+
+        template <class Iterator, class Slot>
+        Iterator make_begin(const detail::ctrl_t *ctrl, Slot *slots) const noexcept
+        {
+            Iterator it{ctrl, slots, ctrl + capacity_};
+            it.skip_free();
+            return it;
+        }
+
+        /// @brief 制御バイトを書く。先頭の group_width-1 個は末尾にも複製しておき、どの位置からでも16バイト読めるようにする
+        void set_ctrl(size_type i, detail::ctrl_t c) noexcept
+        {
+            set_ctrl(ctrl_, capacity_, i, c);
+        }
+
+        static void set_ctrl(detail::ctrl_t *ctrl, size_type capacity, size_type i, detail::ctrl_t c) noexcept
+        {
+            ctrl[i] = c;
+            if (i < detail::group_width - 1)
+                ctrl[capacity + i] = c;
+        }
+
+        template <class K, class... Args>
+        std::pair<iterator, bool> try_emplace_impl(K &&key, Args &&...args)
+        {
+            const auto hash = hash_(key);
+            if (const auto i = find_index(key, hash); i != npos)
+                return {iterator{ctrl_ + i, slots_ + i, ctrl_ + capacity_}, false};
+            const auto i = prepare_insert(hash);
+            // 要素を作ってから制御バイトを書く(キーや値の構築が例外を投げても、表は挿入前のまま)
+            std::construct_at(slots_ + i, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+            commit_insert(i, hash);
+            return {iterator{ctrl_ + i, slots_ + i, ctrl_ + capacity_}, true};
+        }
+
+        template <class K>
+        size_type find_index(const K &key) const noexcept
+        {
+            return find_index(key, hash_(key));
+        }
+
+        template <class K>
+        size_type find_index(const K &key, size_type hash) const noexcept
+        {
+            if (capacity_ == 0)
+                return npos;
+            const size_type mask = capacity_ - 1;
+            size_type pos = h1(hash) & mask;
+            // 16個ずつ、1, 2, 3, ...グループ分ずつ進めて探す(容量が2のべき乗なら全グループを一度ずつ訪れる)
+            for (size_type step = detail::group_width;; step += detail::group_width)
+            {
+                const detail::group g(ctrl_ + pos);
+                for (auto bits = g.match(h2(hash)); bits != 0; bits &= bits - 1)
+                {
+                    const size_type i = (pos + static_cast<size_type>(std::countr_zero(bits))) & mask;
+                    if (eq_(slots_[i].first, key))
+                        return i;
+                }
+                if (g.match_empty() != 0) // 空きがあれば、その先にはない
+                    return npos;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        /// @brief hashを入れる位置(空きか削除済み)を探す
+        size_type find_free(size_type hash) const noexcept
+        {
+            return find_free(ctrl_, capacity_, hash);
+        }
+
+        static size_type find_free(const detail::ctrl_t *ctrl, size_type capacity, size_type hash) noexcept
+        {
+            const size_type mask = capacity - 1;
+            size_type pos = h1(hash) & mask;
+            for (size_type step = detail::group_width;; step += detail::group_width)
+            {
+                const auto bits = detail::group(ctrl + pos).match_empty_or_deleted();
+                if (bits != 0)
+                    return (pos + static_cast<size_type>(std::countr_zero(bits))) & mask;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        /// @brief 挿入する位置を決める(必要なら作り直す)。制御バイトは要素を作った後に commit_insert で書く
+        size_type prepare_insert(size_type hash)
+        {
+            if (capacity_ == 0)
+                resize(detail::group_width);
+            auto i = find_free(hash);
+            if (growth_left_ == 0 && ctrl_[i] == detail::ctrl_empty)
+            {
+                // 削除済みの印が多いだけなら同じ容量で作り直して印を消す
+                resize(size_ * 2 < max_load(capacity_) ? capacity_ : capacity_ * 2);
+                i = find_free(hash);
+            }
+            return i;
+        }
+
+        void commit_insert(size_type i, size_type hash) noexcept
+        {
+            // 空きを使ったときだけ残りを減らす(削除済みの位置を再利用する場合は空きの数が変わらない)
+            if (ctrl_[i] == detail::ctrl_empty)
+                growth_left_--;
+            set_ctrl(i, h2(hash));
+            size_++;
+        }
+
+        void erase_at(size_type i) noexcept
+        {
+            std::destroy_at(slots_ + i);
+            set_ctrl(i, detail::ctrl_deleted);
+            size_--;
+        }
+
+        /// @brief 容量をnew_capacityにして全要素を入れ直す
+        ///  新しい表を作り終えてから差し替える。途中で例外が出たら作りかけの表を捨て、元の表はそのまま残す
+        void resize(size_type new_capacity)
+        {
+            auto *new_ctrl = new detail::ctrl_t[new_capacity + detail::group_width - 1];
+            value_type *new_slots;
+            try
+            {
+                new_slots = std::allocator<value_type>{}.allocate(new_capacity);
+            }
+            catch (...)
+            {
+                delete[] new_ctrl;
+                throw;
+            }
+            std::memset(new_ctrl, detail::ctrl_empty, new_capacity + detail::group_width - 1);
+            try
+            {
+                for (size_type i = 0; i < capacity_; i++)
+                {
+                    if (ctrl_[i] < 0)
+                        continue;
+                    const auto hash = hash_(slots_[i].first);
+                    const auto j = find_free(new_ctrl, new_capacity, hash);
+                    // キーはconstなのでムーブでもコピーになる。コピーが例外を投げうるなら、元を壊さないよう値もコピーする
+                    std::construct_at(new_slots + j, std::move_if_noexcept(slots_[i]));
+                    set_ctrl(new_ctrl, new_capacity, j, h2(hash)); // 作れてから印を付ける
+                }
+            }
+            catch (...)
+            {
+                for (size_type j = 0; j < new_capacity; j++)
+                    if (new_ctrl[j] >= 0)
+                        std::destroy_at(new_slots + j);
+                delete[] new_ctrl;
+                std::allocator<value_type>{}.deallocate(new_slots, new_capacity);
+                throw;
+            }
+            release_storage();
+            ctrl_ = new_ctrl;
+            slots_ = new_slots;
+            capacity_ = new_capacity;
+            growth_left_ = max_load(new_capacity) - size_;
+        }
+
+        void destroy_all() noexcept
+        {
+            for (size_type i = 0; i < capacity_; i++)
+                if (ctrl_[i] >= 0)
+                    std::destroy_at(slots_ + i);
+        }
+
+        void release() noexcept
+        {
+            release_storage();
+            ctrl_ = nullptr;
+            slots_ = nullptr;
+            capacity_ = size_ = growth_left_ = 0;
+        }
+
+        /// @brief 要素を破棄して領域を返す(メンバーはそのまま)
+        void release_storage() noexcept
+        {
+            if (capacity_ == 0)
+                return;
+            destroy_all();
+            delete[] ctrl_;
+            std::allocator<value_type>{}.deallocate(slots_, capacity_);
+        }
+
+        detail::ctrl_t *ctrl_ = nullptr;
+        value_type *slots_ = nullptr;
+        size_type capacity_ = 0;
+        size_type size_ = 0;
+        size_type growth_left_ = 0; // 空きのまま使える位置の数(削除済みの印は含まない)
+        [[no_unique_address]] Hash hash_{};
+        [[no_unique_address]] KeyEqual eq_{};
+    };
+}
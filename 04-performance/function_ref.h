@@ -0,0 +1,66 @@
+/// 呼び出し可能なオブジェクトを所有しない軽量な参照
+// * 「関数の中でその場で呼ぶだけ」のコールバック引数向け。ポインタ2つ分の大きさしかない
+// * 参照先(ラムダなど)より長生きさせてはいけない。std::string_viewと同じ注意が必要
+//
+// 使い方:
+//   void for_each_item(function_ref<void(int)> callback); // 呼び出し側は普通にラムダを渡せる
+//   for_each_item([&](int x) { sum += x; });
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template <class Signature>
+class function_ref; // 宣言のみ。関数型で特殊化したものを使う
+
+template <class R, class... Args>
+class function_ref<R(Args...)>
+{
+public:
+    /// @brief 呼び出し可能なオブジェクトを参照する(コピーはしない)
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::remove_cvref_t<F>, function_ref> &&
+                                                std::is_invocable_r_v<R, F &, Args...>>>
+    function_ref(F &&f) noexcept
+    {
+        using D = std::remove_cvref_t<F>;
+        if constexpr (std::is_function_v<std::remove_pointer_t<D>>)
+        {
+            // 関数(ポインタ)は値そのものを保持する(一時的なポインタを参照すると寿命が切れるため)
+            using FP = std::add_pointer_t<std::remove_pointer_t<D>>;
+            FP fp = f;
+            object_ = reinterpret_cast<void *>(fp);
+            callback_ = &invoke_function_pointer<FP>;
+        }
+        else
+        {
+            object_ = const_cast<void *>(static_cast<const void *>(std::addressof(f)));
+            callback_ = &invoke<std::remove_reference_t<F>>;
+        }
+    }
+
+    function_ref(const function_ref &) noexcept = default;
+    function_ref &operator=(const function_ref &) noexcept = default;
+
+    R operator()(Args... args) const
+    {
+        return callback_(object_, std::forward<Args>(args)...);
+    }
+
+private:
+    template <class F>
+    static R invoke(void *object, Args &&...args)
+    {
+        return std::invoke(*static_cast<F *>(object), std::forward<Args>(args)...);
+    }
+
+    template <class FP>
+    static R invoke_function_pointer(void *object, Args &&...args)
+    {
+        return std::invoke(reinterpret_cast<FP>(object), std::forward<Args>(args)...);
+    }
+
+    void *object_;
+    R (*callback_)(void *, Args &&...);
+};
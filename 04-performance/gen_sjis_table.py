@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""sjis_table.h を生成する。
+
+Pythonのcp932コーデックから、Shift_JIS(CP932)の2バイト文字→Unicodeの表を作る。
+使い方: python3 gen_sjis_table.py > sjis_table.h
+"""
+
+LEADS = list(range(0x81, 0xA0)) + list(range(0xE0, 0xFD))
+TRAILS = range(0x40, 0xFD)  # 0x7Fは不正だが、添字計算を単純にするため表には含める
+
+
+def decode_pair(lead, trail):
+    if trail == 0x7F:
+        return 0
+    try:
+        s = bytes([lead, trail]).decode("cp932")
+    except UnicodeDecodeError:
+        return 0
+    assert len(s) == 1 and ord(s) < 0x10000
+    return ord(s)
+
+
+def main():
+    rows = []
+    row_of_lead = [0xFF] * 256
+    for lead in LEADS:
+        row = [decode_pair(lead, t) for t in TRAILS]
+        if any(row):
+            row_of_lead[lead] = len(rows)
+            rows.append(row)
+
+    out = []
+    out.append("/// Shift_JIS(CP932)の2バイト文字→Unicodeの表")
+    out.append("// * 自動生成: python3 gen_sjis_table.py > sjis_table.h (Pythonのcp932コーデックから生成)")
+    out.append("// * 手で編集しないこと")
+    out.append("#pragma once")
+    out.append("")
+    out.append("#include <cstdint>")
+    out.append("")
+    out.append("namespace sjis::table")
+    out.append("{")
+    out.append("    /// @brief 先頭バイト→rowsの添字。0xFFは文字が割り当てられていない(または先頭バイトではない)")
+    out.append("    inline constexpr std::uint8_t row_of_lead[256] = {")
+    for i in range(0, 256, 16):
+        out.append("        " + " ".join("0x%02x," % v for v in row_of_lead[i:i + 16]))
+    out.append("    };")
+    out.append("")
+    out.append("    inline constexpr int trail_min = 0x%02x;" % TRAILS.start)
+    out.append("    inline constexpr int trail_count = %d;" % len(TRAILS))
+    out.append("    inline constexpr int row_count = %d;" % len(rows))
+    out.append("")
+    out.append("    /// @brief rows[行][2バイト目 - trail_min] = Unicode(BMP)。0は未定義")
+    out.append("    inline constexpr char16_t rows[row_count][trail_count] = {")
+    for lead, row in zip([l for l in LEADS if row_of_lead[l] != 0xFF], rows):
+        out.append("        // 0x%02x" % lead)
+        out.append("        {")
+        for i in range(0, len(row), 12):
+            out.append("            " + " ".join("0x%04x," % v for v in row[i:i + 12]))
+        out.append("        },")
+    out.append("    };")
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
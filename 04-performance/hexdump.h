@@ -0,0 +1,325 @@
+/// 大きなバイナリ向けの16進ダンプ
+// * 02-advanced/03-character-2.cpp の dump() はcallocでコピーを作り、1バイトずつiostreamで書いていたので
+//   大きなデータでは非常に遅い。ここではstd::span<const std::byte>から直接、出力バッファへ文字を組み立てる
+// * 1行の書式は hexdump -C と同じ(オフセット/ASCII表示はoptionsで切り替えられる)
+//     00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 00 01  |Hello, world!...|
+// * 1行(16バイト)の16進変換はSSSE3のpshufbで行う(使えない環境では256要素の表を引く)
+// * dumperはファイルなどから少しずつ渡されるデータを行単位に整形し、write(2)でまとめて書き出す
+//   (POSIX環境向け)
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace hexdump
+{
+    struct options
+    {
+        bool offset = true; // 行頭にオフセットを表示する
+        bool ascii = true;  // 行末にASCII表示を付ける
+    };
+
+    constexpr std::size_t bytes_per_line = 16;
+
+    /// @brief 1行あたりの最大文字数(改行込み)
+    ///  オフセット16桁 + 空白2 + 16進部49 + " |" + ASCII16 + "|" + 改行
+    constexpr std::size_t max_line_length = 16 + 2 + 49 + 2 + bytes_per_line + 1 + 1;
+
+    /// @brief SIMDで1行を組み立てるときに、行末より後ろへはみ出して書く可能性がある大きさ
+    constexpr std::size_t line_slack = 16;
+
+    /// @brief nバイトを整形するのに必要な出力バッファの大きさ
+    constexpr std::size_t required_size(std::size_t n) noexcept
+    {
+        return (n + bytes_per_line - 1) / bytes_per_line * max_line_length + line_slack;
+    }
+
+    namespace detail
+    {
+        inline constexpr char digits[] = "0123456789abcdef";
+
+        /// @brief 0x00～0xffの2桁の16進表記を並べた表
+        struct hex_pair_table
+        {
+            char pairs[256][2];
+            constexpr hex_pair_table() : pairs{}
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    pairs[i][0] = digits[i >> 4];
+                    pairs[i][1] = digits[i & 0xF];
+                }
+            }
+        };
+        inline constexpr hex_pair_table hex_pairs{};
+
+        inline char *write_offset(char *out, std::uint64_t offset) noexcept
+        {
+            // 8桁で足りなければ16桁にする(4GiBを超えるファイル向け)
+            const int bytes = offset > 0xFFFFFFFFull ? 8 : 4;
+            for (int i = bytes - 1; i >= 0; i--)
+            {
+                std::memcpy(out, hex_pairs.pairs[(offset >> (i * 8)) & 0xFF], 2);
+                out += 2;
+            }
+            *out++ = ' ';
+            *out++ = ' ';
+            return out;
+        }
+
+        inline char printable(unsigned char c) noexcept
+        {
+            return (c >= 0x20 && c < 0x7F) ? static_cast<char>(c) : '.';
+        }
+
+        /// @brief 16進部分とASCII部分をスカラーで書く。16バイト未満の最終行にも使う
+        inline char *write_body_scalar(char *out, const unsigned char *p, std::size_t n, bool ascii) noexcept
+        {
+            for (std::size_t j = 0; j < bytes_per_line; j++)
+            {
+                if (j < n)
+                {
+                    std::memcpy(out, hex_pairs.pairs[p[j]], 2);
+                }
+                else
+                {
+                    out[0] = ' ';
+                    out[1] = ' ';
+                }
+                out[2] = ' ';
+                out += 3;
+                if (j == 7)
+                    *out++ = ' ';
+            }
+            if (ascii)
+            {
+                *out++ = ' ';
+                *out++ = '|';
+                for (std::size_t j = 0; j < n; j++)
+                    *out++ = printable(p[j]);
+                *out++ = '|';
+            }
+            else
+            {
+                out -= 1 + (n <= 8); // 末尾の空白は出さない
+                out -= (bytes_per_line - n) * 3;
+            }
+            *out++ = '\n';
+            return out;
+        }
+
+#if defined(__SSSE3__)
+        /// @brief 16バイトちょうどの行をSIMDで書く。outの後ろline_slackバイトまで書き込むことがある
+        inline char *write_body_simd(char *out, const unsigned char *p, bool ascii) noexcept
+        {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const auto table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(digits));
+            const auto low_mask = _mm_set1_epi8(0x0F);
+            const auto hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low_mask));
+            const auto lo = _mm_shuffle_epi8(table, _mm_and_si128(v, low_mask));
+            // 上位桁と下位桁を交互に並べて "h0 l0 h1 l1 ..." にする
+            const auto hex0 = _mm_unpacklo_epi8(hi, lo); // 先頭8バイト分
+            const auto hex1 = _mm_unpackhi_epi8(hi, lo); // 後半8バイト分
+
+            // "hl hl hl ..." の並びに広げる。-1(0x80)の位置は0になるので、そこに空白をORで入れる
+            const auto spread0 = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+            const auto spread1 = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const auto spaces0 = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0);
+            const auto spaces1 = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
+            auto store = [](char *dst, __m128i x)
+            { _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), x); };
+
+            // 前半: 0～24文字目(最後は8バイト目の後の追加の空白)。後半: 25～48文字目
+            store(out, _mm_or_si128(_mm_shuffle_epi8(hex0, spread0), spaces0));
+            store(out + 16, _mm_or_si128(_mm_shuffle_epi8(hex0, spread1), spaces1));
+            store(out + 25, _mm_or_si128(_mm_shuffle_epi8(hex1, spread0), spaces0));
+            store(out + 41, _mm_or_si128(_mm_shuffle_epi8(hex1, spread1), spaces1));
+            out += 49;
+
+            if (ascii)
+            {
+                out[0] = ' ';
+                out[1] = '|';
+                // 0x20～0x7Eはそのまま、それ以外は'.'にする(符号付き比較なので0x80以上は負の値になる)
+                const auto printable_mask = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+                                                          _mm_cmplt_epi8(v, _mm_set1_epi8(0x7F)));
+                const auto text = _mm_or_si128(_mm_and_si128(printable_mask, v),
+                                               _mm_andnot_si128(printable_mask, _mm_set1_epi8('.')));
+                store(out + 2, text);
+                out[18] = '|';
+                out += 19;
+            }
+            else
+            {
+                out -= 1; // 末尾の空白は出さない
+            }
+            *out++ = '\n';
+            return out;
+        }
+#endif
+
+        inline char *write_line(char *out, const unsigned char *p, std::size_t n, std::uint64_t offset,
+                                const options &opt, bool use_simd) noexcept
+        {
+            if (opt.offset)
+                out = write_offset(out, offset);
+#if defined(__SSSE3__)
+            if (use_simd && n == bytes_per_line)
+                return write_body_simd(out, p, opt.ascii);
+#else
+            (void)use_simd;
+#endif
+            return write_body_scalar(out, p, n, opt.ascii);
+        }
+    }
+
+    /// @brief dataを整形してoutへ書き込み、書いた文字数を返す
+    /// @param out required_size(data.size())以上の大きさが必要
+    /// @param offset 先頭バイトのオフセット(表示用)
+    /// @param use_simd falseならスカラー処理だけを使う(比較用)
+    inline std::size_t format(std::span<const std::byte> data, std::span<char> out, std::uint64_t offset = 0,
+                              const options &opt = {}, bool use_simd = true) noexcept
+    {
+        const auto *p = reinterpret_cast<const unsigned char *>(data.data());
+        char *dst = out.data();
+        for (std::size_t i = 0; i < data.size(); i += bytes_per_line)
+        {
+            const auto n = std::min(bytes_per_line, data.size() - i);
+            dst = detail::write_line(dst, p + i, n, offset + i, opt, use_simd);
+        }
+        return static_cast<std::size_t>(dst - out.data());
+    }
+
+    /// @brief 少しずつ渡されるデータを整形し、ファイルディスクリプタへ書き出す
+    ///  整形結果は呼び出し側が渡す固定長バッファに貯め、一杯になったらwrite(2)で書き出す(メモリ確保なし)
+    class dumper
+    {
+    public:
+        /// @param buffer 整形結果を貯めるバッファ。max_line_length + line_slack バイト以上(大きいほどwriteの回数が減る)
+        dumper(int fd, std::span<char> buffer, const options &opt = {}) noexcept
+            : fd_(fd), opt_(opt), buffer_(buffer)
+        {
+            assert(buffer.size() >= max_line_length + line_slack);
+        }
+
+        ~dumper() { finish(); }
+
+        dumper(const dumper &) = delete;
+        dumper &operator=(const dumper &) = delete;
+
+        void feed(std::span<const std::byte> data) noexcept
+        {
+            // 前回の端数があれば1行分になるまで埋める
+            if (carry_size_ > 0)
+            {
+                const auto n = std::min(bytes_per_line - carry_size_, data.size());
+                std::memcpy(carry_ + carry_size_, data.data(), n);
+                carry_size_ += n;
+                data = data.subspan(n);
+                if (carry_size_ < bytes_per_line)
+                    return;
+                put_line(carry_, bytes_per_line);
+                carry_size_ = 0;
+            }
+            const auto *p = reinterpret_cast<const unsigned char *>(data.data());
+            std::size_t i = 0;
+            for (; i + bytes_per_line <= data.size(); i += bytes_per_line)
+            {
+                put_line(p + i, bytes_per_line);
+            }
+            carry_size_ = data.size() - i;
+            std::memcpy(carry_, p + i, carry_size_);
+        }
+
+        /// @brief 端数の行を書き出し、バッファの中身をすべて書き出す
+        void finish() noexcept
+        {
+            if (carry_size_ > 0)
+            {
+                put_line(carry_, carry_size_);
+                carry_size_ = 0;
+            }
+            flush();
+        }
+
+        /// @brief 書き出しに失敗したか
+        bool failed() const noexcept { return failed_; }
+
+    private:
+        void put_line(const unsigned char *p, std::size_t n) noexcept
+        {
+            if (buffer_.size() - used_ < max_line_length + line_slack)
+                flush();
+            used_ = static_cast<std::size_t>(detail::write_line(buffer_.data() + used_, p, n, offset_, opt_, true) - buffer_.data());
+            offset_ += n;
+        }
+
+        void flush() noexcept
+        {
+            std::size_t written = 0;
+            while (written < used_ && !failed_)
+            {
+                const auto r = ::write(fd_, buffer_.data() + written, used_ - written);
+                if (r < 0 && errno == EINTR) // シグナルで中断されただけなら書き直す
+                    continue;
+                if (r < 0)
+                    failed_ = true;
+                else
+                    written += static_cast<std::size_t>(r);
+            }
+            used_ = 0;
+        }
+
+        int fd_;
+        options opt_;
+        std::span<char> buffer_;
+        bool failed_ = false;
+        std::uint64_t offset_ = 0;
+        std::size_t carry_size_ = 0;
+        std::size_t used_ = 0;
+        unsigned char carry_[bytes_per_line];
+    };
+
+    /// @brief ファイルを少しずつ読みながらダンプする(ファイル全体をメモリに読み込まない)
+    /// @return 成功すればtrue
+    inline bool dump_file(const char *path, int out_fd, const options &opt = {})
+    {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        // どちらもスタックに置くには大きいのでthread_localにしている
+        static thread_local std::byte chunk[256 * 1024];
+        static thread_local char text[256 * 1024];
+        dumper d{out_fd, text, opt};
+        bool ok = true;
+        for (;;)
+        {
+            const auto r = ::read(fd, chunk, sizeof(chunk));
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r < 0)
+            {
+                ok = false;
+                break;
+            }
+            if (r == 0)
+                break;
+            d.feed(std::span<const std::byte>(chunk, static_cast<std::size_t>(r)));
+        }
+        d.finish();
+        ::close(fd);
+        return ok && !d.failed();
+    }
+}
@@ -0,0 +1,185 @@
+/// ヒープ確保をしないstd::functionの代わり
+// * キャプチャは固定サイズの内部バッファに置く。入りきらない場合はコンパイルエラーになる
+// * コピー・ムーブ・破棄はラムダの型ごとに作られる関数テーブル(vtable)経由で行う
+//
+// 使い方:
+//   inplace_function<void(int), 16> f = [a, b](int x) { ... }; // a,bが16バイト以内ならOK
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <class Signature, std::size_t Capacity = 32, std::size_t Align = alignof(std::max_align_t)>
+class inplace_function; // 宣言のみ。関数型で特殊化したものを使う
+
+namespace inplace_function_detail
+{
+    template <class R, class... Args>
+    struct vtable
+    {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*copy)(void *dst, const void *src);
+        void (*move)(void *dst, void *src) noexcept; // 移動後にsrcは破棄される
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    /// @brief 空の状態で使うvtable。呼び出すとstd::functionと同様にbad_function_callを投げる
+    ///  (こうしておくと呼び出し時に空かどうかの分岐がいらない)
+    template <class R, class... Args>
+    inline constexpr vtable<R, Args...> empty_vtable{
+        [](void *, Args &&...) -> R
+        { throw std::bad_function_call{}; },
+        [](void *, const void *) {},
+        [](void *, void *) noexcept {},
+        [](void *) noexcept {},
+    };
+
+    template <class F, class R, class... Args>
+    inline constexpr vtable<R, Args...> vtable_for{
+        [](void *storage, Args &&...args) -> R
+        { return std::invoke(*static_cast<F *>(storage), std::forward<Args>(args)...); },
+        [](void *dst, const void *src)
+        { ::new (dst) F(*static_cast<const F *>(src)); },
+        [](void *dst, void *src) noexcept
+        {
+            ::new (dst) F(std::move(*static_cast<F *>(src)));
+            static_cast<F *>(src)->~F();
+        },
+        [](void *storage) noexcept
+        { static_cast<F *>(storage)->~F(); },
+    };
+
+    template <class T>
+    struct is_inplace_function : std::false_type
+    {
+    };
+    template <class Sig, std::size_t C, std::size_t A>
+    struct is_inplace_function<inplace_function<Sig, C, A>> : std::true_type
+    {
+    };
+}
+
+template <class R, class... Args, std::size_t Capacity, std::size_t Align>
+class inplace_function<R(Args...), Capacity, Align>
+{
+    using vtable_type = inplace_function_detail::vtable<R, Args...>;
+
+public:
+    inplace_function() noexcept = default;
+    inplace_function(std::nullptr_t) noexcept {}
+
+    /// @brief 呼び出し可能なオブジェクトを内部バッファにコピー(ムーブ)して保持する
+    template <class F, class D = std::decay_t<F>,
+              class = std::enable_if_t<!inplace_function_detail::is_inplace_function<D>::value &&
+                                       std::is_invocable_r_v<R, D &, Args...>>>
+    inplace_function(F &&f)
+    {
+        static_assert(sizeof(D) <= Capacity,
+                      "inplace_function: キャプチャが大きすぎる。Capacityを増やすこと");
+        static_assert(Align % alignof(D) == 0,
+                      "inplace_function: キャプチャのアラインメントがAlignに合わない");
+        static_assert(std::is_copy_constructible_v<D>,
+                      "inplace_function: コピーできない関数オブジェクトは保持できない");
+        static_assert(std::is_nothrow_move_constructible_v<D>,
+                      "inplace_function: ムーブ時に例外を投げる関数オブジェクトは保持できない");
+        ::new (static_cast<void *>(&storage_)) D(std::forward<F>(f));
+        vtable_ = &inplace_function_detail::vtable_for<D, R, Args...>;
+    }
+
+    /// @brief 容量が小さいinplace_functionからの変換(中身をそのまま移す)
+    template <std::size_t C, std::size_t A, class = std::enable_if_t<(C <= Capacity && Align % A == 0)>>
+    inplace_function(const inplace_function<R(Args...), C, A> &other)
+        : vtable_(other.vtable_)
+    {
+        vtable_->copy(&storage_, &other.storage_);
+    }
+
+    inplace_function(const inplace_function &other)
+        : vtable_(other.vtable_)
+    {
+        vtable_->copy(&storage_, &other.storage_);
+    }
+
+    inplace_function(inplace_function &&other) noexcept
+        : vtable_(other.vtable_)
+    {
+        vtable_->move(&storage_, &other.storage_);
+        other.vtable_ = empty();
+    }
+
+    ~inplace_function()
+    {
+        vtable_->destroy(&storage_);
+    }
+
+    inplace_function &operator=(const inplace_function &other)
+    {
+        if (this != &other)
+        {
+            // コピーが例外を投げても空の状態で残るようにする
+            vtable_->destroy(&storage_);
+            vtable_ = empty();
+            other.vtable_->copy(&storage_, &other.storage_);
+            vtable_ = other.vtable_;
+        }
+        return *this;
+    }
+
+    inplace_function &operator=(inplace_function &&other) noexcept
+    {
+        if (this != &other)
+        {
+            vtable_->destroy(&storage_);
+            vtable_ = other.vtable_;
+            vtable_->move(&storage_, &other.storage_);
+            other.vtable_ = empty();
+        }
+        return *this;
+    }
+
+    inplace_function &operator=(std::nullptr_t) noexcept
+    {
+        vtable_->destroy(&storage_);
+        vtable_ = empty();
+        return *this;
+    }
+
+    template <class F, class = std::enable_if_t<!inplace_function_detail::is_inplace_function<std::decay_t<F>>::value>>
+    inplace_function &operator=(F &&f)
+    {
+        return *this = inplace_function(std::forward<F>(f));
+    }
+
+    R operator()(Args... args) const
+    {
+        return vtable_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return vtable_ != empty();
+    }
+
+    void swap(inplace_function &other) noexcept
+    {
+        inplace_function tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+private:
+    template <class, std::size_t, std::size_t>
+    friend class inplace_function;
+
+    static constexpr const vtable_type *empty() noexcept
+    {
+        return &inplace_function_detail::empty_vtable<R, Args...>;
+    }
+
+    const vtable_type *vtable_ = empty();
+    // constなoperator()から呼べるようmutableにしている(std::functionと同じ振る舞い)
+    alignas(Align) mutable std::byte storage_[Capacity];
+};
@@ -0,0 +1,286 @@
+/// 同じ数で何度も割るための除算(割る数ごとに逆数を前計算する)
+// * 01_basic/07-optional.cpp の safe_divide(a, b) は呼ぶたびに除算命令(idiv)を使う。除算命令は乗算の数倍～十数倍遅い
+// * 割る数dが実行時に決まっても、同じdで大量に割るなら「dの逆数に相当する定数を掛けて上位ビットを取り、シフトする」
+//   形に直せる(コンパイラが定数で割るときに使う方法。Granlund & Montgomery, libdivide)
+//   - 符号なし: q = (t + ((n - t) >> 1)) >> s   (t = mulhi(m, n))
+//   - 符号付き: q = ((n + mulhi(m, n)) >> s) - (n >> (N-1))、dが負なら符号を反転   (0に向かって切り捨て。/ と同じ)
+//   - dが2のべき乗ならシフトだけ
+// * 0で割る場合と、符号付きの最小値を-1で割る場合(結果が表せない)は、未定義動作にせず「無効」として扱う
+// * 配列をまとめて割る関数は、32bitの型をAVX2で8要素ずつ処理する(64bitの上位を求める乗算はAVX2にないのでスカラー)
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace fastdiv
+{
+    template <class T>
+    concept divisible = std::same_as<T, std::int32_t> || std::same_as<T, std::uint32_t> ||
+                        std::same_as<T, std::int64_t> || std::same_as<T, std::uint64_t>;
+
+    namespace detail
+    {
+        template <class T>
+        using wide_t = std::conditional_t<sizeof(T) == 4, std::uint64_t, unsigned __int128>;
+
+        /// @brief 符号なしの積の上位半分
+        template <class U>
+        constexpr U mulhi(U a, U b) noexcept
+        {
+            return static_cast<U>((static_cast<wide_t<U>>(a) * b) >> (sizeof(U) * 8));
+        }
+
+        /// @brief 符号付きの積の上位半分
+        template <class S>
+        constexpr S mulsh(S a, S b) noexcept
+        {
+            using W = std::conditional_t<sizeof(S) == 4, std::int64_t, __int128>;
+            return static_cast<S>((static_cast<W>(a) * b) >> (sizeof(S) * 8));
+        }
+    }
+
+    template <divisible T>
+    class divisor
+    {
+        using U = std::make_unsigned_t<T>;
+        static constexpr int bits = sizeof(T) * 8;
+
+    public:
+        enum class algorithm : std::uint8_t
+        {
+            invalid, // 0で割る
+            shift,   // 2のべき乗(符号付きは負の数の切り捨てを補正してからシフト)
+            magic,   // 乗算とシフト
+        };
+
+        constexpr divisor() noexcept = default;
+
+        constexpr explicit divisor(T d) noexcept : d_(d)
+        {
+            if (d == 0)
+                return;
+            if constexpr (std::is_unsigned_v<T>)
+            {
+                if (std::has_single_bit(d))
+                {
+                    algorithm_ = algorithm::shift;
+                    shift_ = std::countr_zero(d);
+                    return;
+                }
+                const int l = std::bit_width(d); // ceil(log2(d))
+                // m = floor(2^N * (2^l - d) / d) + 1 (Nビットに収まる)
+                using W = detail::wide_t<T>;
+                magic_ = static_cast<U>(((W{1} << bits) * ((W{1} << l) - d)) / d + 1);
+                shift_ = l - 1;
+                algorithm_ = algorithm::magic;
+            }
+            else
+            {
+                negate_ = d < 0 ? ~U(0) : U(0);
+                const U ad = d < 0 ? U(0) - static_cast<U>(d) : static_cast<U>(d); // |d| (最小値でもあふれない)
+                if (std::has_single_bit(ad))
+                {
+                    algorithm_ = algorithm::shift;
+                    shift_ = std::countr_zero(ad);
+                    return;
+                }
+                const int l = std::bit_width(ad); // ceil(log2(|d|)) (2以上)
+                // m = 2^(N+l-1) / |d| + 1 - 2^N (負の数として持つ)
+                using W = detail::wide_t<T>;
+                magic_ = static_cast<U>((W{1} << (bits + l - 1)) / ad + 1);
+                shift_ = l - 1;
+                algorithm_ = algorithm::magic;
+            }
+        }
+
+        constexpr T value() const noexcept { return d_; }
+        constexpr bool valid() const noexcept { return algorithm_ != algorithm::invalid; }
+        constexpr algorithm kind() const noexcept { return algorithm_; }
+
+        /// @brief n / d を求める。valid() であり、符号付きの最小値を-1で割らないこと
+        constexpr T divide(T n) const noexcept
+        {
+            return algorithm_ == algorithm::shift ? divide<algorithm::shift>(n) : divide<algorithm::magic>(n);
+        }
+
+        /// @brief 方式を指定して割る(配列をまとめて割るとき、方式の分岐をループの外に出すため)
+        template <algorithm A>
+        constexpr T divide(T n) const noexcept
+        {
+            static_assert(A != algorithm::invalid);
+            if constexpr (std::is_unsigned_v<T>)
+            {
+                if constexpr (A == algorithm::shift)
+                    return n >> shift_;
+                const U t = detail::mulhi(magic_, n);
+                return (t + ((n - t) >> 1)) >> shift_;
+            }
+            else
+            {
+                U q;
+                const U un = static_cast<U>(n);
+                const U sign = static_cast<U>(n >> (bits - 1)); // 負なら全ビット1
+                if constexpr (A == algorithm::shift)
+                {
+                    // 負の数は 2^shift - 1 を足してからシフトすると0に向かって切り捨てになる
+                    const U bias = shift_ == 0 ? 0 : sign >> (bits - shift_);
+                    q = static_cast<U>(static_cast<T>(un + bias) >> shift_);
+                }
+                else
+                {
+                    const U q0 = un + static_cast<U>(detail::mulsh(static_cast<T>(magic_), n));
+                    q = static_cast<U>(static_cast<T>(q0) >> shift_) - sign;
+                }
+                return static_cast<T>((q ^ negate_) - negate_); // dが負なら符号を反転(分岐しない)
+            }
+        }
+
+        /// @brief 07-optional.cpp の safe_divide と同じく、割れなければ std::nullopt を返す
+        constexpr std::optional<T> try_divide(T n) const noexcept
+        {
+            if (!valid() || overflows(n))
+                return std::nullopt;
+            return divide(n);
+        }
+
+        /// @brief 符号付きの最小値を-1で割る(結果が表せない)かどうか
+        constexpr bool overflows(T n) const noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+                return d_ == -1 && n == std::numeric_limits<T>::min();
+            else
+                return (void)n, false;
+        }
+
+        friend constexpr T operator/(T n, const divisor &d) noexcept { return d.divide(n); }
+
+        // 配列版(detail の関数)から使う
+        constexpr U magic() const noexcept { return magic_; }
+        constexpr int shift() const noexcept { return shift_; }
+        constexpr bool negative() const noexcept { return negate_ != 0; }
+
+    private:
+        T d_ = 0;
+        U magic_ = 0;
+        int shift_ = 0;
+        algorithm algorithm_ = algorithm::invalid;
+        U negate_ = 0; // dが負なら全ビット1
+    };
+
+    namespace detail
+    {
+#if defined(__AVX2__)
+        /// @brief 32bit×8レーンの積の上位32bit(偶数レーンと奇数レーンを別々に掛けて組み合わせる)
+        template <bool Signed>
+        inline __m256i mulhi_epi32(__m256i a, __m256i m) noexcept
+        {
+            const auto even = Signed ? _mm256_mul_epi32(a, m) : _mm256_mul_epu32(a, m);
+            const auto odd = Signed ? _mm256_mul_epi32(_mm256_srli_epi64(a, 32), m) : _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+            return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0b10101010);
+        }
+
+        template <class T>
+        inline std::size_t divide_simd(const T *in, T *out, std::size_t n, const divisor<T> &d) noexcept
+        {
+            if constexpr (sizeof(T) != 4)
+                return 0;
+            else
+            {
+                using algorithm = typename divisor<T>::algorithm;
+                const auto m = _mm256_set1_epi32(static_cast<int>(d.magic()));
+                const auto s = _mm_cvtsi32_si128(d.shift());
+                std::size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                    __m256i q;
+                    if constexpr (std::is_unsigned_v<T>)
+                    {
+                        if (d.kind() == algorithm::shift)
+                            q = _mm256_srl_epi32(x, s);
+                        else
+                        {
+                            const auto t = mulhi_epi32<false>(x, m);
+                            q = _mm256_srl_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(_mm256_sub_epi32(x, t), 1)), s);
+                        }
+                    }
+                    else
+                    {
+                        const auto sign = _mm256_srai_epi32(x, 31);
+                        if (d.kind() == algorithm::shift)
+                        {
+                            const auto bias = _mm256_srl_epi32(sign, _mm_cvtsi32_si128(32 - d.shift())); // shiftが0なら0になる
+                            q = _mm256_sra_epi32(_mm256_add_epi32(x, bias), s);
+                        }
+                        else
+                        {
+                            const auto q0 = _mm256_add_epi32(x, mulhi_epi32<true>(x, m));
+                            q = _mm256_sub_epi32(_mm256_sra_epi32(q0, s), sign);
+                        }
+                        if (d.negative())
+                            q = _mm256_sub_epi32(_mm256_setzero_si256(), q);
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), q);
+                }
+                return i;
+            }
+        }
+#else
+        template <class T>
+        inline std::size_t divide_simd(const T *, T *, std::size_t, const divisor<T> &) noexcept { return 0; }
+#endif
+    }
+
+    /// @brief inの各要素をdで割ってoutへ書く。割れない要素(0で割る、最小値を-1で割る)はfallbackにする
+    /// @return 割れた要素の数。out.size() >= in.size() であること
+    template <divisible T>
+    std::size_t divide(std::span<const T> in, const divisor<T> &d, std::span<T> out, T fallback = T{}, bool use_simd = true) noexcept
+    {
+        if (!d.valid())
+        {
+            std::fill_n(out.data(), in.size(), fallback); // 全要素が無効
+            return 0;
+        }
+        std::size_t i = use_simd ? detail::divide_simd(in.data(), out.data(), in.size(), d) : 0;
+        using algorithm = typename divisor<T>::algorithm;
+        const auto local = d; // outへの書き込みでdの中身が変わりうるとみなされ、毎回読み直すのを防ぐ
+        if (local.kind() == algorithm::shift)
+        {
+            for (; i < in.size(); i++)
+                out[i] = local.template divide<algorithm::shift>(in[i]);
+        }
+        else
+        {
+            for (; i < in.size(); i++)
+                out[i] = local.template divide<algorithm::magic>(in[i]);
+        }
+
+        std::size_t valid = in.size();
+        if constexpr (std::is_signed_v<T>)
+        {
+            if (d.value() == -1) // 最小値を-1で割った要素だけ直す(符号反転で最小値のままになっている)
+            {
+                for (std::size_t k = 0; k < in.size(); k++)
+                {
+                    if (d.overflows(in[k]))
+                    {
+                        out[k] = fallback;
+                        valid--;
+                    }
+                }
+            }
+        }
+        return valid;
+    }
+}
@@ -0,0 +1,207 @@
+/// 無効値を持てる列(値の配列 + 有効ビットの配列)
+// * 01_basic/07-optional.cpp の std::optional<int> は、値4バイト + 有無のbool + パディングで8バイトになる。
+//   大量に並べるとメモリの半分が無駄になり、値と有無が交互に並ぶのでSIMDでまとめて処理しにくい
+// * nullable_column<T> は値を詰めた配列と、有効なら1のビット配列(64要素で8バイト)に分けて持つ(Apache Arrowと同じ形)
+//   - 無効な位置の値は常に T{} にしておく。総和などは有無を見ずに値の配列をそのまま足せばよい
+//   - 無効値の数はビット配列のpopcountで数える
+//   - value_or はビット配列を64要素ずつ見て、全部有効ならコピー、全部無効なら埋めるだけにする
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace columnar
+{
+    template <class T>
+        requires std::is_arithmetic_v<T>
+    class nullable_column
+    {
+    public:
+        using value_type = T;
+        static constexpr std::size_t block_size = 64; // ビット配列の1ワード分
+
+        nullable_column() = default;
+
+        explicit nullable_column(std::span<const std::optional<T>> values)
+        {
+            reserve(values.size());
+            for (const auto &v : values)
+                push_back(v);
+        }
+
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        void reserve(std::size_t n)
+        {
+            values_.reserve(n);
+            validity_.reserve((n + block_size - 1) / block_size);
+        }
+
+        void push_back(T value)
+        {
+            grow();
+            values_.back() = value;
+            validity_.back() |= std::uint64_t{1} << ((size_ - 1) % block_size);
+        }
+
+        void push_back(std::nullopt_t) { grow(); }
+
+        void push_back(const std::optional<T> &value)
+        {
+            if (value)
+                push_back(*value);
+            else
+                push_back(std::nullopt);
+        }
+
+        bool is_valid(std::size_t i) const noexcept { return (validity_[i / block_size] >> (i % block_size)) & 1; }
+
+        std::optional<T> operator[](std::size_t i) const noexcept
+        {
+            return is_valid(i) ? std::optional<T>{values_[i]} : std::nullopt;
+        }
+
+        T value_or(std::size_t i, T fallback) const noexcept { return is_valid(i) ? values_[i] : fallback; }
+
+        void set(std::size_t i, std::optional<T> value) noexcept
+        {
+            const auto bit = std::uint64_t{1} << (i % block_size);
+            if (value)
+            {
+                values_[i] = *value;
+                validity_[i / block_size] |= bit;
+            }
+            else
+            {
+                values_[i] = T{}; // 無効な位置は T{} にしておく
+                validity_[i / block_size] &= ~bit;
+            }
+        }
+
+        /// @brief 値の配列(無効な位置は T{})
+        std::span<const T> values() const noexcept { return values_; }
+
+        /// @brief 有効ビットの配列(i番目の要素は validity()[i / 64] の i % 64 ビット目)
+        std::span<const std::uint64_t> validity() const noexcept { return validity_; }
+
+        /// @brief 無効値の数
+        std::size_t null_count() const noexcept
+        {
+            std::size_t valid = 0;
+            for (auto w : validity_)
+                valid += static_cast<std::size_t>(std::popcount(w));
+            return size_ - valid;
+        }
+
+        /// @brief 全要素をoutへ書く。無効な位置はfallbackにする。out.size() >= size() であること
+        void value_or(std::span<T> out, T fallback, bool use_simd = true) const noexcept
+        {
+            for (std::size_t b = 0; b < validity_.size(); b++)
+            {
+                const std::size_t first = b * block_size;
+                const std::size_t n = std::min(block_size, size_ - first);
+                const auto mask = validity_[b];
+                const auto full = n == block_size ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+                if (mask == full)
+                    std::memcpy(out.data() + first, values_.data() + first, n * sizeof(T));
+                else if (mask == 0)
+                    std::fill_n(out.data() + first, n, fallback);
+                else
+                    select(values_.data() + first, out.data() + first, n, mask, fallback, use_simd);
+            }
+        }
+
+        /// @brief 有効な要素だけについて f(index, value) を呼ぶ
+        template <class F>
+        void for_each_valid(F &&f) const
+        {
+            for (std::size_t b = 0; b < validity_.size(); b++)
+            {
+                for (auto mask = validity_[b]; mask != 0; mask &= mask - 1)
+                {
+                    const std::size_t i = b * block_size + static_cast<std::size_t>(std::countr_zero(mask));
+                    f(i, values_[i]);
+                }
+            }
+        }
+
+        /// @brief 64要素ごとに f(first, values, mask) を呼ぶ(maskのビットiが values[i] の有無)。
+        ///  ブロック単位で処理すると、ループの中身をSIMDで書きやすい
+        template <class F>
+        void for_each_block(F &&f) const
+        {
+            for (std::size_t b = 0; b < validity_.size(); b++)
+            {
+                const std::size_t first = b * block_size;
+                f(first, std::span<const T>(values_.data() + first, std::min(block_size, size_ - first)), validity_[b]);
+            }
+        }
+
+        /// @brief 有効な値の合計(無効な位置は T{} なので、有無を見ずに足せる)
+        template <class Sum = T>
+        Sum sum() const noexcept
+        {
+            Sum s{};
+            for (auto v : values_)
+                s += static_cast<Sum>(v);
+            return s;
+        }
+
+        std::size_t memory_usage() const noexcept
+        {
+            return values_.capacity() * sizeof(T) + validity_.capacity() * sizeof(std::uint64_t);
+        }
+
+    private:
+        void grow()
+        {
+            if (size_ % block_size == 0)
+                validity_.push_back(0);
+            values_.push_back(T{});
+            size_++;
+        }
+
+        /// @brief maskのビットが立っている位置はin、それ以外はfallbackをoutへ書く
+        static void select(const T *in, T *out, std::size_t n, std::uint64_t mask, T fallback, bool use_simd) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if constexpr (sizeof(T) == 4)
+            {
+                if (use_simd)
+                {
+                    // 8bitのマスクを、レーンごとのビットを調べて32bitのマスク8個に広げてからblendする
+                    const auto lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+                    const auto fb = _mm256_castps_si256(_mm256_set1_ps(std::bit_cast<float>(fallback)));
+                    for (; i + 8 <= n; i += 8)
+                    {
+                        const auto bits = _mm256_set1_epi32(static_cast<int>((mask >> i) & 0xFF));
+                        const auto lanes = _mm256_cmpeq_epi32(_mm256_and_si256(bits, lane_bits), lane_bits);
+                        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_blendv_epi8(fb, v, lanes));
+                    }
+                }
+            }
+#endif
+            (void)use_simd;
+            for (; i < n; i++)
+                out[i] = (mask >> i) & 1 ? in[i] : fallback;
+        }
+
+        std::size_t size_ = 0;
+        std::vector<T> values_;
+        std::vector<std::uint64_t> validity_; // 1なら有効
+    };
+}
@@ -0,0 +1,383 @@
+/// 大きな数値ファイル(CSV/改行区切り)の並列パーサ
+// * 05-tips/03-str_to_value.cpp の std::from_chars を、数GBのファイルに使えるようにしたもの
+// * ファイルはmmapで読み込み(コピーなし)、改行の位置で区切ってスレッドごとに分担する
+// * 1回目のパスで各チャンクの行数を数え、全体の行数ぶんの列(columnar)をまとめて確保してから、
+//   2回目のパスで各スレッドが自分の行範囲に直接書き込む(スレッド間の結合やコピーが要らない)
+// * 16桁までの10進数はSSSE3で16バイトをまとめて変換する(それ以外はfrom_chars)
+// * エラーは最初に見つかったものを行番号(1始まり)と列番号(1始まり)で返す
+// * mmapを使うのでPOSIX環境向け
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace numparse
+{
+    /// @brief 読み取り専用でmmapしたファイル。std::ifstreamと同様にis_open()で成否を確かめる
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const char *path) noexcept
+        {
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (::fstat(fd, &st) == 0)
+            {
+                size_ = static_cast<std::size_t>(st.st_size);
+                if (size_ == 0)
+                {
+                    open_ = true; // 空のファイルはmmapできないが、開けたことにする
+                }
+                else if (void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0); p != MAP_FAILED)
+                {
+                    data_ = static_cast<const char *>(p);
+                    open_ = true;
+                    ::madvise(p, size_, MADV_WILLNEED);
+                }
+            }
+            ::close(fd); // マップした後はファイルディスクリプタを閉じてよい
+        }
+
+        ~mapped_file()
+        {
+            if (data_)
+                ::munmap(const_cast<char *>(data_), size_);
+        }
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        bool is_open() const noexcept { return open_; }
+        std::string_view view() const noexcept { return {data_, data_ ? size_ : 0}; }
+
+    private:
+        const char *data_ = nullptr;
+        std::size_t size_ = 0;
+        bool open_ = false;
+    };
+
+    enum class column_type
+    {
+        int64,
+        float64,
+    };
+
+    /// @brief 1列分の値。typeに応じてどちらか一方だけを確保する
+    ///  (vectorにすると確保時に0で埋めるパスが1回余計に走るので、初期化しない配列にしている)
+    struct column
+    {
+        column_type type;
+        std::unique_ptr<std::int64_t[]> int64;
+        std::unique_ptr<double[]> float64;
+    };
+
+    /// @brief 列ごとに並べた解析結果
+    struct table
+    {
+        std::size_t rows = 0;
+        std::vector<column> columns;
+
+        std::span<const std::int64_t> int64_column(std::size_t i) const noexcept { return {columns[i].int64.get(), rows}; }
+        std::span<const double> float64_column(std::size_t i) const noexcept { return {columns[i].float64.get(), rows}; }
+    };
+
+    /// @brief 最初に見つかったエラー。line == 0 ならエラーなし
+    struct parse_error
+    {
+        std::size_t line = 0;  // 1始まり
+        std::size_t field = 0; // 1始まり(0なら行ではなくschemaの誤り)
+        std::errc ec{};
+
+        explicit operator bool() const noexcept { return line != 0; }
+    };
+
+    struct options
+    {
+        char delimiter = ',';
+        unsigned threads = 0; // 0ならstd::thread::hardware_concurrency()
+        bool use_simd = true; // falseならfrom_charsだけを使う(比較用)
+    };
+
+    struct parse_result
+    {
+        table data;        // エラーがあった場合、エラー以降の行の値は不定
+        parse_error error;
+    };
+
+    namespace detail
+    {
+#if defined(__SSSE3__)
+        /// @brief pから始まる1～15桁の10進数を変換する。p[0..16)を読めること
+        /// @return 数字が0桁または16桁以上続く場合はfalse(from_charsに任せる)
+        inline bool parse_digits16(const char *p, std::uint64_t &value, std::size_t &length) noexcept
+        {
+            const auto v = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), _mm_set1_epi8('0'));
+            // 符号なしで9以下なら数字
+            const auto is_digit = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(9)), v);
+            const auto mask = static_cast<unsigned>(_mm_movemask_epi8(is_digit));
+            const auto len = static_cast<std::size_t>(std::countr_one(mask));
+            if (len == 0 || len >= 16)
+                return false;
+
+            // 数字を右詰めにする(あふれた位置の-1は0になる)
+            static constexpr std::int8_t shift[32] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+            const auto digits = _mm_shuffle_epi8(v, _mm_loadu_si128(reinterpret_cast<const __m128i *>(shift + len)));
+            // 隣り合う桁を順にまとめる: 1桁×16 -> 2桁×8 -> 4桁×4 -> 8桁×2
+            const auto d2 = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+            const auto d4 = _mm_madd_epi16(d2, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+            const auto d8 = _mm_madd_epi16(_mm_packs_epi32(d4, d4), _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+            const auto hi = static_cast<std::uint32_t>(_mm_cvtsi128_si32(d8));
+            const auto lo = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(d8, 4)));
+            value = std::uint64_t{hi} * 100000000 + lo;
+            length = len;
+            return true;
+        }
+#endif
+
+        inline std::from_chars_result parse_value(const char *p, const char *end, std::int64_t &value, bool use_simd) noexcept
+        {
+#if defined(__SSSE3__)
+            if (use_simd && end - p >= 17)
+            {
+                const bool negative = *p == '-';
+                const char *q = p + negative;
+                std::uint64_t v;
+                std::size_t len;
+                if (parse_digits16(q, v, len))
+                {
+                    value = negative ? -static_cast<std::int64_t>(v) : static_cast<std::int64_t>(v);
+                    return {q + len, std::errc{}};
+                }
+            }
+#else
+            (void)use_simd;
+#endif
+            return std::from_chars(p, end, value);
+        }
+
+        inline std::from_chars_result parse_value(const char *p, const char *end, double &value, bool use_simd) noexcept
+        {
+#if defined(__SSSE3__)
+            // 仮数が15桁以下・指数なしなら、整数÷10^kで正しく丸められた値になる
+            // (どちらも2^53未満でdoubleで正確に表せ、除算は1回だけなので)
+            if (use_simd && end - p >= 34)
+            {
+                static constexpr double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                                   1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+                const bool negative = *p == '-';
+                const char *q = p + negative;
+                std::uint64_t integer, fraction = 0;
+                std::size_t int_len, frac_len = 0;
+                if (parse_digits16(q, integer, int_len))
+                {
+                    q += int_len;
+                    bool ok = true;
+                    if (*q == '.')
+                    {
+                        ok = parse_digits16(q + 1, fraction, frac_len);
+                        q += 1 + frac_len;
+                    }
+                    if (ok && int_len + frac_len <= 15 && *q != 'e' && *q != 'E')
+                    {
+                        const double m = static_cast<double>(integer * static_cast<std::uint64_t>(pow10[frac_len]) + fraction);
+                        const double v = m / pow10[frac_len];
+                        value = negative ? -v : v;
+                        return {q, std::errc{}};
+                    }
+                }
+            }
+#else
+            (void)use_simd;
+#endif
+            return std::from_chars(p, end, value);
+        }
+
+        /// @brief '\n'の数を数える
+        inline std::size_t count_newlines(const char *p, std::size_t n) noexcept
+        {
+            std::size_t i = 0, count = 0;
+#if defined(__AVX2__)
+            const auto nl = _mm256_set1_epi8('\n');
+            for (; i + 32 <= n; i += 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                count += std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl))));
+            }
+#elif defined(__SSE2__)
+            const auto nl = _mm_set1_epi8('\n');
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                count += std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl))));
+            }
+#endif
+            for (; i < n; i++)
+                count += p[i] == '\n';
+            return count;
+        }
+
+        struct chunk
+        {
+            const char *begin;
+            const char *end;
+            std::size_t first_row; // このチャンクの先頭行の番号(0始まり)
+            std::size_t rows;
+            parse_error error;
+        };
+
+        /// @brief チャンク内の行を解析し、table.columnsのfirst_row行目以降へ書き込む
+        ///  自分より前のチャンクでエラーが見つかったら途中でやめる(最初のエラーは変わらないので)
+        inline parse_error parse_chunk(const chunk &c, std::size_t index, std::span<column> columns,
+                                       const options &opt, std::atomic<std::size_t> &first_failed) noexcept
+        {
+            const char *p = c.begin;
+            const std::size_t fields = columns.size();
+            for (std::size_t row = c.first_row; p < c.end; row++)
+            {
+                if (first_failed.load(std::memory_order_relaxed) < index)
+                    return {};
+                for (std::size_t f = 0; f < fields; f++)
+                {
+                    std::from_chars_result r;
+                    if (columns[f].type == column_type::int64)
+                        r = parse_value(p, c.end, columns[f].int64[row], opt.use_simd);
+                    else
+                        r = parse_value(p, c.end, columns[f].float64[row], opt.use_simd);
+                    if (r.ec == std::errc{})
+                    {
+                        // 値の直後は区切り文字(最後の列なら改行かファイルの終わり)でなければならない
+                        p = r.ptr;
+                        if (f + 1 < fields)
+                        {
+                            if (p < c.end && *p == opt.delimiter)
+                            {
+                                p++;
+                                continue;
+                            }
+                        }
+                        else
+                        {
+                            if (p < c.end && *p == '\r')
+                                p++;
+                            if (p == c.end || *p == '\n')
+                            {
+                                p += (p < c.end);
+                                continue;
+                            }
+                        }
+                        r.ec = std::errc::invalid_argument;
+                    }
+                    // 後ろのチャンクを止めるため、エラーになったチャンクの最小番号を記録する
+                    auto failed = first_failed.load();
+                    while (index < failed && !first_failed.compare_exchange_weak(failed, index))
+                    {
+                    }
+                    return {row + 1, f + 1, r.ec};
+                }
+            }
+            return {};
+        }
+    }
+
+    /// @brief textを解析してschemaの型の列に格納する
+    inline parse_result parse(std::string_view text, std::span<const column_type> schema, const options &opt = {})
+    {
+        parse_result result;
+        // 列がないと1行も読み進められず、各スレッドが同じ位置で回り続けるので、分担する前に断る
+        if (schema.empty())
+        {
+            result.error = {1, 0, std::errc::invalid_argument};
+            return result;
+        }
+        unsigned threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+        // 小さい入力を細かく分けても、スレッドの起動の方が高くつく
+        constexpr std::size_t min_chunk_size = 1 << 20;
+        threads = static_cast<unsigned>(std::clamp<std::size_t>(text.size() / min_chunk_size, 1, threads));
+
+        // 区切り位置を改行の直後に合わせながらチャンクに分ける
+        std::vector<detail::chunk> chunks;
+        const char *const end = text.data() + text.size();
+        const char *begin = text.data();
+        for (unsigned i = 0; i < threads && begin < end; i++)
+        {
+            const char *split = end;
+            if (i + 1 < threads)
+            {
+                split = std::max(begin, text.data() + text.size() / threads * (i + 1));
+                const void *nl = std::memchr(split, '\n', static_cast<std::size_t>(end - split));
+                split = nl ? static_cast<const char *>(nl) + 1 : end;
+            }
+            chunks.push_back({begin, split, 0, 0, {}});
+            begin = split;
+        }
+
+        auto run = [&](auto &&f)
+        {
+            std::vector<std::thread> workers;
+            for (std::size_t i = 1; i < chunks.size(); i++)
+                workers.emplace_back(f, i);
+            if (!chunks.empty())
+                f(0); // 先頭のチャンクは呼び出したスレッドで処理する
+            for (auto &w : workers)
+                w.join();
+        };
+
+        // 1) 各チャンクの行数を数える(最後の行は改行で終わっていなくてもよい)
+        run([&](std::size_t i)
+            {
+                auto &c = chunks[i];
+                const auto n = static_cast<std::size_t>(c.end - c.begin);
+                c.rows = detail::count_newlines(c.begin, n) + (n > 0 && c.end[-1] != '\n'); });
+        for (std::size_t i = 0; i < chunks.size(); i++)
+        {
+            chunks[i].first_row = result.data.rows;
+            result.data.rows += chunks[i].rows;
+        }
+
+        // 2) 列をまとめて確保し、各チャンクが自分の行範囲へ書き込む
+        for (const auto type : schema)
+        {
+            auto &col = result.data.columns.emplace_back(column{type, nullptr, nullptr});
+            if (type == column_type::int64)
+                col.int64.reset(new std::int64_t[result.data.rows]);
+            else
+                col.float64.reset(new double[result.data.rows]);
+        }
+        std::atomic<std::size_t> first_failed{chunks.size()};
+        run([&](std::size_t i)
+            { chunks[i].error = detail::parse_chunk(chunks[i], i, result.data.columns, opt, first_failed); });
+
+        for (const auto &c : chunks)
+        {
+            if (c.error)
+            {
+                result.error = c.error;
+                break;
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,190 @@
+/// 大量の出力を速く書き出すためのバッファ付き出力先
+// * std::endl は改行のたびにflushする(= write(2)が1回呼ばれる)ので、ループの中で使うと非常に遅い
+// * output_sink は大きなバッファを1つだけ確保して使い回し、一杯になったとき(またはflush()を呼んだとき)
+//   だけwrite(2)する。改行ではflushしない
+// * 数値は05-tips/03-str_to_value.cpp の std::to_chars でバッファへ直接書く(ロケールも書式解析もない)
+// * バッファより大きな文字列は、バッファの中身と一緒にwritev(2)で1回で書き出す(コピーしない)
+// * POSIX環境向け
+//
+// 使い方:
+//   fastio::output_sink out{STDOUT_FILENO};
+//   for (int i = 0; i < 10; i++)
+//       out << i << ' ' << i * 0.5 << '\n';
+//   // デストラクタでflushされる
+#pragma once
+
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fastio
+{
+    class output_sink
+    {
+    public:
+        /// @param fd 書き込み先のファイルディスクリプタ(閉じるのは呼び出し側)
+        /// @param capacity バッファの大きさ。溜まった量がこれを超えそうになったら書き出す
+        explicit output_sink(int fd, std::size_t capacity = 64 * 1024)
+            : fd_(fd), capacity_(capacity < min_capacity ? min_capacity : capacity), buffer_(new char[capacity_]) {}
+
+        ~output_sink() { flush(); }
+
+        output_sink(const output_sink &) = delete;
+        output_sink &operator=(const output_sink &) = delete;
+
+        output_sink &write(std::string_view s) noexcept
+        {
+            if (s.size() <= capacity_ - used_)
+            {
+                std::memcpy(buffer_.get() + used_, s.data(), s.size());
+                used_ += s.size();
+            }
+            else if (s.size() <= capacity_ / 2)
+            {
+                flush();
+                std::memcpy(buffer_.get(), s.data(), s.size());
+                used_ = s.size();
+            }
+            else
+            {
+                // 大きな文字列はバッファへコピーせず、バッファの中身と一緒に書き出す
+                iovec iov[2] = {{buffer_.get(), used_}, {const_cast<char *>(s.data()), s.size()}};
+                write_all(iov, 2);
+                used_ = 0;
+            }
+            return *this;
+        }
+
+        output_sink &put(char c) noexcept
+        {
+            if (used_ == capacity_)
+                flush();
+            buffer_[used_++] = c;
+            return *this;
+        }
+
+        template <std::integral T>
+        output_sink &write(T value, int base = 10) noexcept
+        {
+            // 64bit整数は2進数でも符号込みで65文字に収まる
+            reserve(65);
+            const auto r = std::to_chars(buffer_.get() + used_, buffer_.get() + capacity_, value, base);
+            used_ = static_cast<std::size_t>(r.ptr - buffer_.get());
+            return *this;
+        }
+
+        /// @brief 浮動小数点数を書く。精度を指定しなければ、読み戻すと元の値になる最短の表記にする
+        template <std::floating_point T>
+        output_sink &write(T value) noexcept
+        {
+            reserve(max_float_length);
+            const auto r = std::to_chars(buffer_.get() + used_, buffer_.get() + capacity_, value);
+            used_ = static_cast<std::size_t>(r.ptr - buffer_.get());
+            return *this;
+        }
+
+        template <std::floating_point T>
+        output_sink &write(T value, std::chars_format fmt, int precision) noexcept
+        {
+            // 固定小数点表記では桁数が値の大きさに依存するので、足りなければバッファを空けてやり直す
+            reserve(max_float_length);
+            auto r = std::to_chars(buffer_.get() + used_, buffer_.get() + capacity_, value, fmt, precision);
+            if (r.ec != std::errc{} && used_ > 0)
+            {
+                flush();
+                r = std::to_chars(buffer_.get(), buffer_.get() + capacity_, value, fmt, precision);
+            }
+            if (r.ec == std::errc{})
+            {
+                used_ = static_cast<std::size_t>(r.ptr - buffer_.get());
+                return *this;
+            }
+            // バッファより長くなる(1e300 の固定小数点表記など)。スタックで作って文字列として書く
+            char tmp[1024];
+            const auto t = std::to_chars(tmp, tmp + sizeof(tmp), value, fmt, precision);
+            if (t.ec == std::errc{})
+                return write(std::string_view(tmp, static_cast<std::size_t>(t.ptr - tmp)));
+            failed_ = true; // それでも収まらない値は黙って捨てずに失敗として報告する
+            return *this;
+        }
+
+        output_sink &operator<<(std::string_view s) noexcept { return write(s); }
+        output_sink &operator<<(const char *s) noexcept { return write(std::string_view(s)); }
+        output_sink &operator<<(char c) noexcept { return put(c); }
+        template <class T>
+            requires(std::integral<T> && !std::same_as<T, char> && !std::same_as<T, bool>)
+        output_sink &operator<<(T value) noexcept { return write(value); }
+        template <std::floating_point T>
+        output_sink &operator<<(T value) noexcept { return write(value); }
+
+        /// @brief バッファの中身を書き出す
+        /// @return これまでの書き出しがすべて成功していればtrue
+        bool flush() noexcept
+        {
+            if (used_ > 0)
+            {
+                iovec iov{buffer_.get(), used_};
+                write_all(&iov, 1);
+                used_ = 0;
+            }
+            return !failed_;
+        }
+
+        /// @brief 書き出しに失敗したか
+        bool failed() const noexcept { return failed_; }
+
+        /// @brief まだ書き出していないバイト数
+        std::size_t buffered() const noexcept { return used_; }
+
+    private:
+        static constexpr std::size_t max_float_length = 32; // 最短表記ならdoubleは24文字、long doubleでも30文字程度
+        static constexpr std::size_t min_capacity = 128;
+
+        void reserve(std::size_t n) noexcept
+        {
+            if (capacity_ - used_ < n)
+                flush();
+        }
+
+        /// @brief iovをすべて書き出す。一部しか書けなかった場合は残りを書き直す
+        void write_all(iovec *iov, int count) noexcept
+        {
+            while (count > 0 && !failed_)
+            {
+                const auto r = ::writev(fd_, iov, count);
+                if (r < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    failed_ = true;
+                    break;
+                }
+                auto n = static_cast<std::size_t>(r);
+                while (count > 0 && n >= iov->iov_len)
+                {
+                    n -= iov->iov_len;
+                    iov++;
+                    count--;
+                }
+                if (count > 0)
+                {
+                    iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+                    iov->iov_len -= n;
+                }
+            }
+        }
+
+        int fd_;
+        bool failed_ = false;
+        std::size_t capacity_;
+        std::size_t used_ = 0;
+        std::unique_ptr<char[]> buffer_;
+    };
+}
@@ -0,0 +1,330 @@
+/// Nビット整数の詰め込み配列
+// * 01_basic/01-cstdint.cpp の整数型は最小でも8bitなので、3～12bitしか要らない値を大量に持つと
+//   メモリの大部分が使われない上位ビットになる。packed_array<Bits> は各値をBitsビットずつ隙間なく並べる
+// * i番目の値はビット位置 i*Bits から始まる(リトルエンディアンのビット列)。8個ごとにちょうどBitsバイトになるので、
+//   8個単位のまとめ変換はAVX2で行う(Bits <= 14 の場合。それ以外はスカラー処理)
+//   - 展開: 16バイトを読み、pshufbで各レーンへ値を含む4バイトを配り、vpsrlvdでずらしてマスクする
+//   - 詰め込み: 隣り合う値をシフトとORで64bitレーンにまとめていく
+// * delta_packed はソート済みの列を「前の値との差」にしてから、128個ごとに必要なビット数で詰め込む
+// * リトルエンディアンの環境向け
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+static_assert(std::endian::native == std::endian::little, "packed_array.h はリトルエンディアンの環境向け");
+
+namespace packed
+{
+    namespace detail
+    {
+        /// @brief 末尾の値を読むときに8バイト(SIMDでは16バイト)まとめて読んでもはみ出さないための余白
+        constexpr std::size_t padding = 16;
+
+        constexpr std::size_t packed_bytes(std::size_t n, unsigned bits) noexcept
+        {
+            return (n * bits + 7) / 8;
+        }
+
+        inline std::uint64_t load64(const std::byte *p) noexcept
+        {
+            std::uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            return w;
+        }
+
+        inline void store64(std::byte *p, std::uint64_t w) noexcept
+        {
+            std::memcpy(p, &w, sizeof(w));
+        }
+
+        template <unsigned Bits>
+        constexpr std::uint32_t mask = Bits == 32 ? 0xFFFFFFFFu : (1u << Bits) - 1;
+
+        template <unsigned Bits>
+        inline std::uint32_t get(const std::byte *data, std::size_t i) noexcept
+        {
+            const std::size_t bit = i * Bits;
+            return static_cast<std::uint32_t>(load64(data + bit / 8) >> (bit % 8)) & mask<Bits>;
+        }
+
+        template <unsigned Bits>
+        inline void set(std::byte *data, std::size_t i, std::uint32_t value) noexcept
+        {
+            const std::size_t bit = i * Bits;
+            const std::uint64_t m = std::uint64_t{mask<Bits>} << (bit % 8);
+            const auto w = load64(data + bit / 8);
+            store64(data + bit / 8, (w & ~m) | ((std::uint64_t{value} << (bit % 8)) & m));
+        }
+
+#if defined(__AVX2__)
+        /// @brief 8個の値のうちj番目を含む4バイトを、レーンjへ配るためのpshufbのインデックス
+        template <unsigned Bits>
+        constexpr auto make_gather_index() noexcept
+        {
+            std::array<std::int8_t, 32> idx{};
+            for (int j = 0; j < 8; j++)
+                for (int k = 0; k < 4; k++)
+                    idx[j * 4 + k] = static_cast<std::int8_t>(j * Bits / 8 + k);
+            return idx;
+        }
+
+        template <unsigned Bits>
+        inline void unpack8(const std::byte *in, std::uint32_t *out) noexcept
+        {
+            alignas(32) static constexpr auto index = make_gather_index<Bits>();
+            const auto bytes = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)));
+            const auto words = _mm256_shuffle_epi8(bytes, _mm256_load_si256(reinterpret_cast<const __m256i *>(index.data())));
+            const auto shift = _mm256_setr_epi32(0, Bits % 8, 2 * Bits % 8, 3 * Bits % 8, 4 * Bits % 8, 5 * Bits % 8, 6 * Bits % 8, 7 * Bits % 8);
+            const auto values = _mm256_and_si256(_mm256_srlv_epi32(words, shift), _mm256_set1_epi32(static_cast<int>(mask<Bits>)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), values);
+        }
+
+        template <unsigned Bits>
+        inline void pack8(const std::uint32_t *in, std::byte *out) noexcept
+        {
+            const auto x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in)),
+                                            _mm256_set1_epi32(static_cast<int>(mask<Bits>)));
+            // 2個ずつ: v0 | v1 << Bits (64bitレーン×4)
+            const auto pairs = _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi64x(0xFFFFFFFF)),
+                                               _mm256_slli_epi64(_mm256_srli_epi64(x, 32), Bits));
+            // 4個ずつ: 隣の64bitレーンと入れ替えたものをずらしてORする(レーン0と2に結果が入る)
+            const auto swapped = _mm256_shuffle_epi32(pairs, _MM_SHUFFLE(1, 0, 3, 2));
+            const auto quads = _mm256_or_si256(pairs, _mm256_slli_epi64(swapped, 2 * Bits));
+            const auto lo = static_cast<unsigned __int128>(static_cast<std::uint64_t>(_mm256_extract_epi64(quads, 0)));
+            const auto hi = static_cast<unsigned __int128>(static_cast<std::uint64_t>(_mm256_extract_epi64(quads, 2)));
+            const auto all = lo | (hi << (4 * Bits));
+            std::memcpy(out, &all, Bits); // 8個でちょうどBitsバイト
+        }
+
+        template <unsigned Bits>
+        constexpr bool simd_supported = Bits >= 1 && Bits <= 14;
+#else
+        template <unsigned Bits>
+        constexpr bool simd_supported = false;
+#endif
+
+        /// @brief 先頭から詰め込まれたn個の値をoutへ展開する
+        template <unsigned Bits>
+        inline void unpack(const std::byte *in, std::size_t n, std::uint32_t *out, bool use_simd = true) noexcept
+        {
+            std::size_t i = 0;
+            if constexpr (Bits == 0)
+            {
+                std::fill(out, out + n, 0u);
+                return;
+            }
+#if defined(__AVX2__)
+            if constexpr (simd_supported<Bits>)
+            {
+                if (use_simd)
+                {
+                    for (; i + 8 <= n; i += 8)
+                        unpack8<Bits>(in + i / 8 * Bits, out + i);
+                }
+            }
+#endif
+            (void)use_simd;
+            for (; i < n; i++)
+                out[i] = get<Bits>(in, i);
+        }
+
+        /// @brief n個の値を先頭から詰め込む。上位の余分なビットは捨てる
+        template <unsigned Bits>
+        inline void pack(const std::uint32_t *in, std::size_t n, std::byte *out, bool use_simd = true) noexcept
+        {
+            if constexpr (Bits == 0)
+                return;
+            std::memset(out, 0, packed_bytes(n, Bits));
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if constexpr (simd_supported<Bits>)
+            {
+                if (use_simd)
+                {
+                    for (; i + 8 <= n; i += 8)
+                        pack8<Bits>(in + i, out + i / 8 * Bits);
+                }
+            }
+#endif
+            (void)use_simd;
+            std::size_t bit = i * Bits;
+            for (const std::uint32_t *p = in + i; p != in + n; ++p, bit += Bits)
+                store64(out + bit / 8, load64(out + bit / 8) | (std::uint64_t{*p & mask<Bits>} << (bit % 8)));
+        }
+
+        using unpack_function = void (*)(const std::byte *, std::size_t, std::uint32_t *, bool) noexcept;
+        using pack_function = void (*)(const std::uint32_t *, std::size_t, std::byte *, bool) noexcept;
+
+        /// @brief 実行時に決まるビット数(0～32)で呼び分けるための表
+        template <std::size_t... I>
+        constexpr auto make_tables(std::index_sequence<I...>) noexcept
+        {
+            return std::pair{std::array<unpack_function, sizeof...(I)>{&unpack<I>...},
+                             std::array<pack_function, sizeof...(I)>{&pack<I>...}};
+        }
+        inline constexpr auto tables = make_tables(std::make_index_sequence<33>{});
+    }
+
+    /// @brief 各値をBitsビット(1～32)で持つ配列
+    template <unsigned Bits>
+        requires(Bits >= 1 && Bits <= 32)
+    class packed_array
+    {
+    public:
+        using value_type = std::uint32_t;
+        static constexpr unsigned bits = Bits;
+        static constexpr value_type max_value = detail::mask<Bits>;
+
+        packed_array() = default;
+        explicit packed_array(std::size_t n) { resize(n); }
+        explicit packed_array(std::span<const value_type> values) { assign(values); }
+
+        std::size_t size() const noexcept { return size_; }
+
+        /// @brief 値の格納に使っているバイト数(余白を含む)
+        std::size_t memory_usage() const noexcept { return words_.capacity() * sizeof(std::uint64_t); }
+
+        /// @brief 要素数を変える。増えた要素は0
+        void resize(std::size_t n)
+        {
+            const std::size_t old = size_;
+            words_.resize((detail::packed_bytes(n, Bits) + detail::padding + 7) / 8, 0);
+            size_ = n;
+            // 縮めてから伸ばした場合に備え、新しい要素を0にする
+            for (std::size_t i = old; i < n; i++)
+                set(i, 0);
+        }
+
+        value_type get(std::size_t i) const noexcept { return detail::get<Bits>(data(), i); }
+
+        /// @brief i番目に値を書く。上位の余分なビットは捨てる
+        void set(std::size_t i, value_type value) noexcept { detail::set<Bits>(data(), i, value); }
+
+        value_type operator[](std::size_t i) const noexcept { return get(i); }
+
+        /// @brief valuesをまとめて詰め込む(要素数はvalues.size()になる)
+        void assign(std::span<const value_type> values, bool use_simd = true)
+        {
+            words_.assign((detail::packed_bytes(values.size(), Bits) + detail::padding + 7) / 8, 0);
+            size_ = values.size();
+            detail::pack<Bits>(values.data(), values.size(), data(), use_simd);
+        }
+
+        /// @brief first番目からout.size()個をoutへ展開する
+        void unpack(std::size_t first, std::span<value_type> out, bool use_simd = true) const noexcept
+        {
+            std::size_t i = 0;
+            // 8個単位の境界まではスカラーで進める
+            for (; i < out.size() && (first + i) % 8 != 0; i++)
+                out[i] = get(first + i);
+            const std::size_t start = first + i;
+            detail::unpack<Bits>(data() + start / 8 * Bits, out.size() - i, out.data() + i, use_simd);
+        }
+
+    private:
+        std::byte *data() noexcept { return reinterpret_cast<std::byte *>(words_.data()); }
+        const std::byte *data() const noexcept { return reinterpret_cast<const std::byte *>(words_.data()); }
+
+        std::size_t size_ = 0;
+        std::vector<std::uint64_t> words_; // 8バイト境界に揃えるためuint64_tで確保する
+    };
+
+    /// @brief 昇順(同じ値の連続は可)に並んだ列を、差分+ビット詰めで持つ
+    class delta_packed
+    {
+    public:
+        static constexpr std::size_t block_size = 128;
+
+        delta_packed() = default;
+
+        /// @param sorted 昇順に並んでいること
+        explicit delta_packed(std::span<const std::uint32_t> sorted)
+            : size_(sorted.size())
+        {
+            std::uint32_t deltas[block_size];
+            for (std::size_t b = 0; b < sorted.size(); b += block_size)
+            {
+                const std::size_t n = std::min(block_size, sorted.size() - b);
+                std::uint32_t max_delta = 0;
+                deltas[0] = 0;
+                for (std::size_t i = 1; i < n; i++)
+                {
+                    deltas[i] = sorted[b + i] - sorted[b + i - 1];
+                    max_delta = std::max(max_delta, deltas[i]);
+                }
+                const auto bits = static_cast<unsigned>(std::bit_width(max_delta)); // ブロック内の差が収まる最小のビット数
+                const std::size_t offset = data_.size(), bytes = detail::packed_bytes(n, bits);
+                blocks_.push_back({sorted[b], static_cast<std::uint32_t>(offset), bits});
+                // pack は末尾の値を8バイトまとめて書くので、余白を付けて詰めてから余白を落とす
+                data_.resize(offset + bytes + detail::padding);
+                detail::tables.second[bits](deltas, n, data_.data() + offset, true);
+                data_.resize(offset + bytes);
+            }
+            data_.resize(data_.size() + detail::padding);
+        }
+
+        std::size_t size() const noexcept { return size_; }
+
+        std::size_t memory_usage() const noexcept
+        {
+            return blocks_.capacity() * sizeof(block) + data_.capacity();
+        }
+
+        /// @brief 全体をoutへ展開する。out.size() >= size() であること
+        void decode(std::span<std::uint32_t> out, bool use_simd = true) const noexcept
+        {
+            for (std::size_t b = 0; b < blocks_.size(); b++)
+            {
+                const auto &blk = blocks_[b];
+                const std::size_t first = b * block_size;
+                const std::size_t n = std::min(block_size, size_ - first);
+                std::uint32_t *dst = out.data() + first;
+                detail::tables.first[blk.bits](data_.data() + blk.offset, n, dst, use_simd);
+                // 差分を足し合わせて元の値に戻す
+                std::uint32_t value = blk.first;
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    value += dst[i];
+                    dst[i] = value;
+                }
+            }
+        }
+
+        /// @brief i番目の値。ブロックの先頭から差分を足していく(最大block_size個)
+        std::uint32_t operator[](std::size_t i) const noexcept
+        {
+            std::uint32_t deltas[block_size];
+            const auto &blk = blocks_[i / block_size];
+            const std::size_t n = i % block_size + 1;
+            detail::tables.first[blk.bits](data_.data() + blk.offset, n, deltas, true);
+            std::uint32_t value = blk.first;
+            for (std::size_t k = 0; k < n; k++)
+                value += deltas[k];
+            return value;
+        }
+
+    private:
+        struct block
+        {
+            std::uint32_t first;  // ブロックの先頭の値
+            std::uint32_t offset; // data_内の位置(バイト)
+            unsigned bits;        // 差分のビット数(0～32)
+        };
+
+        std::size_t size_ = 0;
+        std::vector<block> blocks_;
+        std::vector<std::byte> data_;
+    };
+}
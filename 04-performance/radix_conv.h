@@ -0,0 +1,321 @@
+/// 2/8/16進数の文字列⇔整数の変換(from_chars/to_charsと同じ使い方)
+// * 05-tips/03-str_to_value.cpp の std::from_chars / std::to_chars は1桁ずつ処理するので、
+//   大量の16進/2進ダンプを扱うと遅い。ここでは16～32桁をSIMDでまとめて処理する
+//   - 読み込み: 16進と8進はpshufbで右詰めにしてからpmaddubswで隣り合う桁をまとめる。
+//               2進は'1'の位置をpmovmskbでそのままビット列にする(AVX2なら32桁ずつ)
+//   - 書き出し: 16進はpshufbで4ビットずつ文字にする。2進は各バイトに元のビットを配ってから比較する。
+//               8進は3ビット単位でバイト境界をまたぐのでBMI2のpdepで広げる
+// * 結果(from_chars_result / to_chars_result)の意味はstd版と同じ。2/8/16進数以外の基数と、
+//   SIMDが使えない環境ではstd版をそのまま呼ぶ
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace radix
+{
+#if defined(__SSSE3__)
+    namespace detail
+    {
+        /// @brief 16バイト読む。末尾まで16バイトなければ、足りない部分を0(どの基数でも数字でない)で埋める
+        inline __m128i load16(const char *p, const char *last) noexcept
+        {
+            if (last - p >= 16)
+                return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            alignas(16) char buf[16] = {};
+            std::memcpy(buf, p, static_cast<std::size_t>(last - p));
+            return _mm_load_si128(reinterpret_cast<const __m128i *>(buf));
+        }
+
+        /// @brief vの各バイトがlimit以下(符号なし)なら0xFF
+        inline __m128i less_equal(__m128i v, char limit) noexcept
+        {
+            return _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(limit)), v);
+        }
+
+        /// @brief 先頭の数字を右詰めにする(空いた位置は0)。lengthは1～16
+        inline __m128i align_right(__m128i digits, int length) noexcept
+        {
+            static constexpr std::int8_t shift[32] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+            return _mm_shuffle_epi8(digits, _mm_loadu_si128(reinterpret_cast<const __m128i *>(shift + length)));
+        }
+
+        struct block
+        {
+            std::uint64_t value;
+            int digits; // 読んだ桁数
+        };
+
+        /// @brief '0'が続く長さ(最大16)
+        inline int zero_run(const char *p, const char *last) noexcept
+        {
+            const auto v = load16(p, last);
+            return std::countr_one(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('0')))));
+        }
+
+        /// @brief 16進数を最大16桁読む
+        inline block parse_block16(const char *p, const char *last) noexcept
+        {
+            const auto v = load16(p, last);
+            const auto dec = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+            const auto alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a')); // 大文字も小文字にする
+            const auto is_dec = less_equal(dec, 9);
+            const auto is_alpha = less_equal(alpha, 5);
+            const int length = std::countr_one(static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(is_dec, is_alpha))));
+            if (length == 0)
+                return {0, 0};
+            const auto digits = _mm_or_si128(_mm_and_si128(is_dec, dec),
+                                             _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+            // 2桁ずつ1バイトにまとめると、上位桁が先に並んだ8バイトになる
+            const auto pairs = _mm_maddubs_epi16(align_right(digits, length), _mm_set1_epi16(0x0110)); // (16, 1)
+            const auto bytes = _mm_packus_epi16(pairs, pairs);
+            return {__builtin_bswap64(static_cast<std::uint64_t>(_mm_cvtsi128_si64(bytes))), length};
+        }
+
+        /// @brief 8進数を最大16桁読む
+        inline block parse_block8(const char *p, const char *last) noexcept
+        {
+            const auto digits = _mm_sub_epi8(load16(p, last), _mm_set1_epi8('0'));
+            const int length = std::countr_one(static_cast<unsigned>(_mm_movemask_epi8(less_equal(digits, 7))));
+            if (length == 0)
+                return {0, 0};
+            // 1桁(3bit)×16 -> 2桁×8 -> 4桁×4 -> 8桁(24bit)×2
+            const auto d2 = _mm_maddubs_epi16(align_right(digits, length), _mm_set1_epi16(0x0108)); // (8, 1)
+            const auto d4 = _mm_madd_epi16(d2, _mm_set1_epi32(0x00010040));                        // (64, 1)
+            const auto d8 = _mm_madd_epi16(_mm_packs_epi32(d4, d4), _mm_set1_epi32(0x00011000));   // (4096, 1)
+            const auto hi = static_cast<std::uint32_t>(_mm_cvtsi128_si32(d8));
+            const auto lo = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(d8, 4)));
+            return {(std::uint64_t{hi} << 24) | lo, length};
+        }
+
+        /// @brief 2進数を最大16桁(AVX2なら32桁)読む
+        inline block parse_block2(const char *p, const char *last) noexcept
+        {
+#if defined(__AVX2__)
+            __m256i v;
+            if (last - p >= 32)
+            {
+                v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            }
+            else
+            {
+                alignas(32) char buf[32] = {};
+                std::memcpy(buf, p, static_cast<std::size_t>(last - p));
+                v = _mm256_load_si256(reinterpret_cast<const __m256i *>(buf));
+            }
+            const auto d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+            const auto valid = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(1)), d);
+            const int length = std::countr_one(static_cast<std::uint32_t>(_mm256_movemask_epi8(valid)));
+            if (length == 0)
+                return {0, 0};
+            // 並びを逆にしてからpmovmskbすると、先頭の桁が最上位ビットになる
+            const auto reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                                  15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const auto ones = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_cmpeq_epi8(d, _mm256_set1_epi8(1)), reverse), 0x4E);
+            const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(ones));
+            return {length == 32 ? bits : bits >> (32 - length), length};
+#else
+            const auto d = _mm_sub_epi8(load16(p, last), _mm_set1_epi8('0'));
+            const int length = std::countr_one(static_cast<unsigned>(_mm_movemask_epi8(less_equal(d, 1))));
+            if (length == 0)
+                return {0, 0};
+            const auto reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const auto bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_shuffle_epi8(_mm_cmpeq_epi8(d, _mm_set1_epi8(1)), reverse)));
+            return {bits >> (16 - length), length};
+#endif
+        }
+
+        inline block parse_block(int base, const char *p, const char *last) noexcept
+        {
+            return base == 16 ? parse_block16(p, last) : base == 8 ? parse_block8(p, last)
+                                                                   : parse_block2(p, last);
+        }
+
+        /// @brief 1回のparse_blockで読める最大の桁数
+        constexpr int block_digits(int base) noexcept
+        {
+#if defined(__AVX2__)
+            return base == 2 ? 32 : 16;
+#else
+            (void)base;
+            return 16;
+#endif
+        }
+
+        /// @brief 2/8/16進数の数字の並びを読む。先頭の0は何桁あってもよい
+        /// @return 数字がなければ{first, invalid_argument}。64bitに収まらなければ{数字の直後, result_out_of_range}
+        inline std::from_chars_result parse_unsigned(const char *first, const char *last, std::uint64_t &value, int base) noexcept
+        {
+            const int bits = base == 16 ? 4 : base == 8 ? 3
+                                                        : 1;
+            const char *p = first;
+            for (int z = 16; z == 16 && p < last;)
+            {
+                z = zero_run(p, last);
+                p += z;
+            }
+            bool any = p != first;
+            bool overflow = false;
+            std::uint64_t v = 0;
+            while (p < last)
+            {
+                const auto b = parse_block(base, p, last);
+                if (b.digits == 0)
+                    break;
+                any = true;
+                const int shift = b.digits * bits;
+                // 上位へずらしたときにあふれるビットがあればオーバーフロー
+                // (1ブロックの値b.valueはshiftビットに必ず収まる)
+                if (shift >= 64 ? v != 0 : (v >> (64 - shift)) != 0)
+                    overflow = true;
+                v = shift >= 64 ? b.value : (v << shift) | b.value;
+                p += b.digits;
+                if (b.digits < block_digits(base))
+                    break;
+            }
+            if (!any)
+                return {first, std::errc::invalid_argument};
+            if (overflow)
+                return {p, std::errc::result_out_of_range};
+            value = v;
+            return {p, std::errc{}};
+        }
+
+        //
+        // 書き出し。outの末尾(end)から前へ向かって全桁(先頭の0を含む)を書き、有効な桁数を返す
+        //
+
+        inline int format16(char *end, std::uint64_t v) noexcept
+        {
+            const auto x = _mm_cvtsi64_si128(static_cast<long long>(__builtin_bswap64(v)));
+            const auto low_mask = _mm_set1_epi8(0x0F);
+            const auto nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 4), low_mask), _mm_and_si128(x, low_mask));
+            const auto table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 16), _mm_shuffle_epi8(table, nibbles));
+            return (64 - std::countl_zero(v | 1) + 3) / 4;
+        }
+
+        inline int format2(char *end, std::uint64_t v) noexcept
+        {
+#if defined(__AVX2__)
+            // 32bitずつ: 各バイトに自分のビットを含むバイトを配り、ビットが立っていれば'1'にする
+            const auto spread = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                                 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+            const auto bit = _mm256_set1_epi64x(static_cast<long long>(0x0102040810204080ull));
+            for (int i = 0; i < 2; i++)
+            {
+                const auto x = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(v >> (32 * i))), spread);
+                const auto set = _mm256_cmpeq_epi8(_mm256_and_si256(x, bit), bit);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(end - 32 * (i + 1)), _mm256_sub_epi8(_mm256_set1_epi8('0'), set));
+            }
+#else
+            const auto spread = _mm_setr_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+            const auto bit = _mm_set1_epi64x(static_cast<long long>(0x0102040810204080ull));
+            for (int i = 0; i < 4; i++)
+            {
+                const auto x = _mm_shuffle_epi8(_mm_set1_epi16(static_cast<short>(v >> (16 * i))), spread);
+                const auto set = _mm_cmpeq_epi8(_mm_and_si128(x, bit), bit);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 16 * (i + 1)), _mm_sub_epi8(_mm_set1_epi8('0'), set));
+            }
+#endif
+            return 64 - std::countl_zero(v | 1);
+        }
+
+#if defined(__BMI2__)
+        inline int format8(char *end, std::uint64_t v) noexcept
+        {
+            // 24bit(8桁)ずつ、3bitを1バイトずつに広げる。下位の桁が下位バイトに入るのでバイト順を逆にする
+            for (int i = 0; i < 3; i++)
+            {
+                const auto spread = _pdep_u64((v >> (24 * i)) & 0xFFFFFF, 0x0707070707070707ull);
+                const auto text = __builtin_bswap64(spread) | 0x3030303030303030ull;
+                std::memcpy(end - 8 * (i + 1), &text, 8);
+            }
+            return (64 - std::countl_zero(v | 1) + 2) / 3;
+        }
+#endif
+    }
+#endif
+
+    /// @brief std::from_charsと同じ。2/8/16進数はSIMDで処理する
+    template <std::integral T>
+    std::from_chars_result from_chars(const char *first, const char *last, T &value, int base = 10) noexcept
+    {
+#if defined(__SSSE3__)
+        if ((base == 2 || base == 8 || base == 16) && !std::is_same_v<T, bool>)
+        {
+            const char *p = first;
+            bool negative = false;
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (p != last && *p == '-')
+                {
+                    negative = true;
+                    p++;
+                }
+            }
+            std::uint64_t magnitude;
+            auto r = detail::parse_unsigned(p, last, magnitude, base);
+            if (r.ec == std::errc::invalid_argument)
+                return {first, r.ec};
+            if (r.ec != std::errc{})
+                return r;
+            using U = std::make_unsigned_t<T>;
+            const std::uint64_t limit = static_cast<U>(std::numeric_limits<T>::max()) + std::uint64_t{negative};
+            if (magnitude > limit)
+                return {r.ptr, std::errc::result_out_of_range};
+            value = static_cast<T>(negative ? U(0) - static_cast<U>(magnitude) : static_cast<U>(magnitude));
+            return r;
+        }
+#endif
+        return std::from_chars(first, last, value, base);
+    }
+
+    /// @brief std::to_charsと同じ。2/8/16進数はSIMDで処理する
+    template <std::integral T>
+    std::to_chars_result to_chars(char *first, char *last, T value, int base = 10) noexcept
+    {
+#if defined(__SSSE3__)
+#if defined(__BMI2__)
+        const bool supported = base == 2 || base == 8 || base == 16;
+#else
+        const bool supported = base == 2 || base == 16;
+#endif
+        if (supported && !std::is_same_v<T, bool>)
+        {
+            using U = std::make_unsigned_t<T>;
+            const bool negative = value < 0;
+            // 8/16ビットの U(0) - x は int に昇格して負になるので、U に戻してから広げる
+            const auto magnitude = static_cast<std::uint64_t>(negative ? static_cast<U>(U(0) - static_cast<U>(value)) : static_cast<U>(value));
+            char buf[64];
+            int n = 0;
+            if (base == 16)
+                n = detail::format16(buf + 64, magnitude);
+            else if (base == 2)
+                n = detail::format2(buf + 64, magnitude);
+#if defined(__BMI2__)
+            else
+                n = detail::format8(buf + 64, magnitude);
+#endif
+            if (last - first < n + negative)
+                return {last, std::errc::value_too_large};
+            if (negative)
+                *first++ = '-';
+            std::memcpy(first, buf + 64 - n, static_cast<std::size_t>(n));
+            return {first + n, std::errc{}};
+        }
+#endif
+        return std::to_chars(first, last, value, base);
+    }
+}
@@ -0,0 +1,327 @@
+/// 値を範囲に丸める処理(クランプ・飽和変換)を配列にまとめて行う
+// * 05-tips/01-clamp.cpp の std::clamp(x, 0, 255) を、画像の全画素や音声の全サンプルに対して行うためのもの
+// * 2種類の処理がある
+//   - clamp         : 同じ型のまま[lo, hi]に丸める(SSE4.1/AVX2のmin/max)
+//   - saturate_cast : 小さい型へ、範囲外は最小値/最大値に張り付けて変換する(SSE2/AVX2のpack命令は飽和付き)
+//     int32→uint8/int16、int16→uint8、float→uint8/int16 はSIMDで、それ以外の組み合わせはスカラーで処理する
+// * 浮動小数点数から整数への変換は最も近い整数に丸め(ちょうど中間なら偶数)、NaNは0にする
+// * スカラー版(std::clamp と std::cmp_less による)とSIMD版は同じ結果になる
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace saturate
+{
+    /// @brief 1要素をToの範囲に丸めて変換する(整数→整数、浮動小数点数→整数)
+    template <std::integral To, class From>
+        requires std::is_arithmetic_v<From>
+    constexpr To saturate_cast(From x) noexcept
+    {
+        constexpr auto lo = std::numeric_limits<To>::min();
+        constexpr auto hi = std::numeric_limits<To>::max();
+        if constexpr (std::is_floating_point_v<From>)
+        {
+            if (x != x) // NaN
+                return 0;
+            // 32/64bitのToの最大値はfloatで正確に表せず、2^31や2^63に切り上がる。
+            // 先に整数へ丸め、正確に表せる 2^digits (最大値+1)以上かどうかで比べる
+            constexpr auto limit = static_cast<From>(hi / 2 + 1) * 2;
+            const auto rounded = std::nearbyint(x);
+            if (rounded >= limit)
+                return hi;
+            if (rounded <= static_cast<From>(lo)) // loは0か-2^digitsなので正確に表せる
+                return lo;
+            return static_cast<To>(rounded);
+        }
+        else
+        {
+            // 符号の有無が違っても正しく比べられる std::cmp_less/cmp_greater を使う
+            if (std::cmp_less(x, lo))
+                return lo;
+            if (std::cmp_greater(x, hi))
+                return hi;
+            return static_cast<To>(x);
+        }
+    }
+
+    namespace detail
+    {
+        template <class To, class From>
+        inline void saturate_scalar(const From *in, To *out, std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i < n; i++)
+                out[i] = saturate_cast<To>(in[i]);
+        }
+
+        template <class T>
+        inline void clamp_scalar(const T *in, T *out, std::size_t n, T lo, T hi) noexcept
+        {
+            for (std::size_t i = 0; i < n; i++)
+                out[i] = std::clamp(in[i], lo, hi);
+        }
+
+#if defined(__SSE2__)
+        inline __m128i load128(const void *p) noexcept { return _mm_loadu_si128(static_cast<const __m128i *>(p)); }
+        inline void store128(void *p, __m128i v) noexcept { _mm_storeu_si128(static_cast<__m128i *>(p), v); }
+
+        /// @brief floatを[lo, hi]に丸めて32bit整数にする(NaNは0)
+        inline __m128i float_to_int32(__m128 x, __m128 lo, __m128 hi) noexcept
+        {
+            const auto ordered = _mm_cmpord_ps(x, x); // NaNなら0
+            const auto clamped = _mm_min_ps(_mm_max_ps(x, lo), hi);
+            return _mm_cvtps_epi32(_mm_and_ps(clamped, ordered)); // 丸めは既定の丸めモード(最近接偶数)
+        }
+#endif
+#if defined(__AVX2__)
+        inline __m256i load256(const void *p) noexcept { return _mm256_loadu_si256(static_cast<const __m256i *>(p)); }
+        inline void store256(void *p, __m256i v) noexcept { _mm256_storeu_si256(static_cast<__m256i *>(p), v); }
+
+        inline __m256i float_to_int32(__m256 x, __m256 lo, __m256 hi) noexcept
+        {
+            const auto ordered = _mm256_cmp_ps(x, x, _CMP_ORD_Q);
+            const auto clamped = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+            return _mm256_cvtps_epi32(_mm256_and_ps(clamped, ordered));
+        }
+
+        /// @brief pack命令は128bitごとに動くので、32bit単位の並びを元の順に戻す
+        inline __m256i fix_pack_order(__m256i v) noexcept
+        {
+            return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        }
+#endif
+
+        //
+        // SIMDで処理できる組み合わせ。処理した要素数を返す
+        //
+
+        template <class To, class From>
+        inline std::size_t saturate_simd(const From *, To *, std::size_t) noexcept { return 0; }
+
+        /// @brief int32 → uint8 (packs_epi32でint16へ、packus_epi16でuint8へ。2段とも飽和するので[0, 255]になる)
+        template <>
+        inline std::size_t saturate_simd(const std::int32_t *in, std::uint8_t *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= n; i += 32)
+            {
+                const auto ab = _mm256_packs_epi32(load256(in + i), load256(in + i + 8));
+                const auto cd = _mm256_packs_epi32(load256(in + i + 16), load256(in + i + 24));
+                store256(out + i, fix_pack_order(_mm256_packus_epi16(ab, cd)));
+            }
+#endif
+#if defined(__SSE2__)
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto ab = _mm_packs_epi32(load128(in + i), load128(in + i + 4));
+                const auto cd = _mm_packs_epi32(load128(in + i + 8), load128(in + i + 12));
+                store128(out + i, _mm_packus_epi16(ab, cd));
+            }
+#endif
+            return i;
+        }
+
+        /// @brief int32 → int16
+        template <>
+        inline std::size_t saturate_simd(const std::int32_t *in, std::int16_t *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto v = _mm256_packs_epi32(load256(in + i), load256(in + i + 8));
+                store256(out + i, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+#endif
+#if defined(__SSE2__)
+            for (; i + 8 <= n; i += 8)
+                store128(out + i, _mm_packs_epi32(load128(in + i), load128(in + i + 4)));
+#endif
+            return i;
+        }
+
+        /// @brief int16 → uint8
+        template <>
+        inline std::size_t saturate_simd(const std::int16_t *in, std::uint8_t *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= n; i += 32)
+            {
+                const auto v = _mm256_packus_epi16(load256(in + i), load256(in + i + 16));
+                store256(out + i, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+#endif
+#if defined(__SSE2__)
+            for (; i + 16 <= n; i += 16)
+                store128(out + i, _mm_packus_epi16(load128(in + i), load128(in + i + 8)));
+#endif
+            return i;
+        }
+
+        /// @brief float → int16 (範囲外の値をcvtps_epi32に渡すと0x80000000になるので、先にfloatのまま丸める)
+        template <>
+        inline std::size_t saturate_simd(const float *in, std::int16_t *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            {
+                const auto lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+                for (; i + 16 <= n; i += 16)
+                {
+                    const auto a = float_to_int32(_mm256_loadu_ps(in + i), lo, hi);
+                    const auto b = float_to_int32(_mm256_loadu_ps(in + i + 8), lo, hi);
+                    store256(out + i, _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+                }
+            }
+#endif
+#if defined(__SSE2__)
+            const auto lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+            for (; i + 8 <= n; i += 8)
+            {
+                const auto a = float_to_int32(_mm_loadu_ps(in + i), lo, hi);
+                const auto b = float_to_int32(_mm_loadu_ps(in + i + 4), lo, hi);
+                store128(out + i, _mm_packs_epi32(a, b));
+            }
+#endif
+            return i;
+        }
+
+        /// @brief float → uint8
+        template <>
+        inline std::size_t saturate_simd(const float *in, std::uint8_t *out, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            {
+                const auto lo = _mm256_set1_ps(0.0f), hi = _mm256_set1_ps(255.0f);
+                for (; i + 32 <= n; i += 32)
+                {
+                    const auto ab = _mm256_packs_epi32(float_to_int32(_mm256_loadu_ps(in + i), lo, hi),
+                                                       float_to_int32(_mm256_loadu_ps(in + i + 8), lo, hi));
+                    const auto cd = _mm256_packs_epi32(float_to_int32(_mm256_loadu_ps(in + i + 16), lo, hi),
+                                                       float_to_int32(_mm256_loadu_ps(in + i + 24), lo, hi));
+                    store256(out + i, fix_pack_order(_mm256_packus_epi16(ab, cd)));
+                }
+            }
+#endif
+#if defined(__SSE2__)
+            const auto lo = _mm_set1_ps(0.0f), hi = _mm_set1_ps(255.0f);
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto ab = _mm_packs_epi32(float_to_int32(_mm_loadu_ps(in + i), lo, hi),
+                                                float_to_int32(_mm_loadu_ps(in + i + 4), lo, hi));
+                const auto cd = _mm_packs_epi32(float_to_int32(_mm_loadu_ps(in + i + 8), lo, hi),
+                                                float_to_int32(_mm_loadu_ps(in + i + 12), lo, hi));
+                store128(out + i, _mm_packus_epi16(ab, cd));
+            }
+#endif
+            return i;
+        }
+
+        template <class T>
+        inline std::size_t clamp_simd(const T *, T *, std::size_t, T, T) noexcept { return 0; }
+
+        template <>
+        inline std::size_t clamp_simd(const std::int32_t *in, std::int32_t *out, std::size_t n, std::int32_t lo, std::int32_t hi) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            {
+                const auto l = _mm256_set1_epi32(lo), h = _mm256_set1_epi32(hi);
+                for (; i + 8 <= n; i += 8)
+                    store256(out + i, _mm256_min_epi32(_mm256_max_epi32(load256(in + i), l), h));
+            }
+#endif
+#if defined(__SSE4_1__) // pminsd/pmaxsd はSSE4.1から
+            const auto l = _mm_set1_epi32(lo), h = _mm_set1_epi32(hi);
+            for (; i + 4 <= n; i += 4)
+                store128(out + i, _mm_min_epi32(_mm_max_epi32(load128(in + i), l), h));
+#else
+            (void)in, (void)out, (void)n, (void)lo, (void)hi;
+#endif
+            return i;
+        }
+
+        template <>
+        inline std::size_t clamp_simd(const std::int16_t *in, std::int16_t *out, std::size_t n, std::int16_t lo, std::int16_t hi) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            {
+                const auto l = _mm256_set1_epi16(lo), h = _mm256_set1_epi16(hi);
+                for (; i + 16 <= n; i += 16)
+                    store256(out + i, _mm256_min_epi16(_mm256_max_epi16(load256(in + i), l), h));
+            }
+#endif
+#if defined(__SSE2__)
+            const auto l = _mm_set1_epi16(lo), h = _mm_set1_epi16(hi);
+            for (; i + 8 <= n; i += 8)
+                store128(out + i, _mm_min_epi16(_mm_max_epi16(load128(in + i), l), h));
+#endif
+            return i;
+        }
+
+        /// @brief float。maxps/minpsはどちらかがNaNなら2番目の引数を返すので、xを2番目に置いてNaNをそのまま通す(std::clampと同じ)
+        template <>
+        inline std::size_t clamp_simd(const float *in, float *out, std::size_t n, float lo, float hi) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            {
+                const auto l = _mm256_set1_ps(lo), h = _mm256_set1_ps(hi);
+                for (; i + 8 <= n; i += 8)
+                    _mm256_storeu_ps(out + i, _mm256_min_ps(h, _mm256_max_ps(l, _mm256_loadu_ps(in + i))));
+            }
+#endif
+#if defined(__SSE2__)
+            const auto l = _mm_set1_ps(lo), h = _mm_set1_ps(hi);
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_min_ps(h, _mm_max_ps(l, _mm_loadu_ps(in + i))));
+#endif
+            return i;
+        }
+    }
+
+    /// @brief inの各要素を[lo, hi]に丸めてoutへ書く(in と out は同じ配列でもよい)。out.size() >= in.size() であること
+    /// @param use_simd falseなら std::clamp で1要素ずつ処理する(比較用)
+    template <class T>
+        requires std::is_arithmetic_v<T>
+    void clamp(std::span<const T> in, std::span<T> out, T lo, T hi, bool use_simd = true) noexcept
+    {
+        assert(out.size() >= in.size() && !(hi < lo));
+        const std::size_t done = use_simd ? detail::clamp_simd(in.data(), out.data(), in.size(), lo, hi) : 0;
+        detail::clamp_scalar(in.data() + done, out.data() + done, in.size() - done, lo, hi);
+    }
+
+    /// @brief in-place版
+    template <class T>
+        requires std::is_arithmetic_v<T>
+    void clamp(std::span<T> data, T lo, T hi, bool use_simd = true) noexcept
+    {
+        clamp(std::span<const T>(data), data, lo, hi, use_simd);
+    }
+
+    /// @brief inの各要素をToの範囲に丸めてoutへ書く。out.size() >= in.size() であること
+    template <std::integral To, class From>
+        requires std::is_arithmetic_v<From>
+    void saturate_cast(std::span<const From> in, std::span<To> out, bool use_simd = true) noexcept
+    {
+        assert(out.size() >= in.size());
+        const std::size_t done = use_simd ? detail::saturate_simd(in.data(), out.data(), in.size()) : 0;
+        detail::saturate_scalar(in.data() + done, out.data() + done, in.size() - done);
+    }
+}
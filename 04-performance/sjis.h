@@ -0,0 +1,402 @@
+/// Shift_JIS(CP932) ⇄ UTF-8 のストリーミング変換
+// * 02-advanced/03-character-1.md で説明したShift_JIS(Windowsの「マルチバイト文字」)のデータを
+//   UTF-8と相互に変換する。入力を任意の位置で分割して少しずつ渡してもよい
+//   (2バイト文字やUTF-8の途中で切れた分は、変換器の中に持ち越して次の呼び出しで続きを処理する)
+// * 表は2段階: 先頭バイト→行番号(256要素) と 行ごとの2バイト目→Unicode(189要素)。
+//   UTF-8→Shift_JIS用の逆引き表(上位8bit→ページ、ページ内256要素)はコンパイル時に作る
+// * ASCIIの連続はSIMDで長さを調べてまとめてコピーする(utf_transcode.hのascii_run_length)
+// * 変換できないバイト列/文字の扱いは error_policy で選ぶ
+//   - replace: Shift_JIS→UTF-8ではU+FFFD、UTF-8→Shift_JISでは'?'に置き換えて続ける
+//   - strict : そこで止めてエラーを返す
+#pragma once
+
+#include "sjis_table.h"
+#include "utf_transcode.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace sjis
+{
+    enum class error_policy
+    {
+        replace,
+        strict,
+    };
+
+    enum class status : std::uint8_t
+    {
+        ok,
+        invalid_sequence, // 入力が正しいShift_JIS/UTF-8ではない
+        unmappable,       // UTF-8の文字にShift_JISの対応がない
+        output_full,      // 出力バッファが足りない
+    };
+
+    /// @brief 変換結果。readは消費した入力のバイト数(次の呼び出しへ持ち越した分も含む)
+    ///  エラーやoutput_fullのときは、その文字の先頭位置を指す
+    struct result
+    {
+        std::size_t read;
+        std::size_t written;
+        status ec;
+    };
+
+    /// @brief nバイトの入力を変換するときに必要な出力バイト数の上限(持ち越し分を含む)
+    constexpr std::size_t max_utf8_length(std::size_t sjis_bytes) noexcept { return sjis_bytes * 3 + 3; }
+    constexpr std::size_t max_sjis_length(std::size_t utf8_bytes) noexcept { return utf8_bytes + 3; }
+
+    namespace detail
+    {
+        constexpr bool is_lead(unsigned b) noexcept
+        {
+            return (b >= 0x81 && b <= 0x9F) || (b >= 0xE0 && b <= 0xFC);
+        }
+
+        /// @brief 2バイト文字をUnicodeへ。対応がなければ0
+        constexpr char32_t lookup(unsigned lead, unsigned trail) noexcept
+        {
+            const unsigned row = table::row_of_lead[lead];
+            const int t = static_cast<int>(trail) - table::trail_min;
+            if (row == 0xFF || t < 0 || t >= table::trail_count)
+                return 0;
+            return table::rows[row][t];
+        }
+
+        /// @brief Unicode(BMP)→Shift_JISの逆引き表。コンパイル時に作るので実行時の初期化はない
+        struct reverse_table
+        {
+            static constexpr int max_pages = 128;
+            std::uint8_t page_of[256]{}; // 上位8bit→ページ番号+1(0はページなし)
+            std::uint16_t pages[max_pages][256]{};
+
+            constexpr reverse_table()
+            {
+                int used = 0;
+                for (unsigned lead = 0x81; lead <= 0xFC; lead++)
+                {
+                    for (int t = 0; t < table::trail_count; t++)
+                    {
+                        const char32_t cp = lookup(lead, table::trail_min + t);
+                        if (cp == 0)
+                            continue;
+                        auto &page = page_of[cp >> 8];
+                        if (page == 0)
+                        {
+                            if (used == max_pages)
+                                throw "reverse_table: max_pages is too small"; // コンパイルエラーになる
+                            page = static_cast<std::uint8_t>(++used);
+                        }
+                        auto &slot = pages[page - 1][cp & 0xFF];
+                        // 同じ文字が複数の位置にある場合(NEC特殊文字とIBM拡張文字の重複)はWindowsと同じ規則で選ぶ:
+                        // 小さいコードを優先するが、NEC選定IBM拡張文字(0xED, 0xEE行)は他に候補がないときだけ使う
+                        const bool nec_selected = (slot >> 8) == 0xED || (slot >> 8) == 0xEE;
+                        if (slot == 0 || nec_selected)
+                            slot = static_cast<std::uint16_t>((lead << 8) | (table::trail_min + t));
+                    }
+                }
+
+                // JIS X 0208準拠の変換(macOSなど)で使われる文字を、CP932の対応する文字へ寄せる(一方向のみ)
+                // 例: WAVE DASH(U+301C) → 0x8160(CP932では FULLWIDTH TILDE U+FF5E)
+                constexpr std::uint16_t jis_compat[][2] = {
+                    {0x00A2, 0x8191}, {0x00A3, 0x8192}, {0x00AC, 0x81CA},
+                    {0x2016, 0x8161}, {0x2212, 0x817C}, {0x301C, 0x8160}};
+                for (const auto &[cp, code] : jis_compat)
+                {
+                    if (find(cp) == 0)
+                        pages[page_of[cp >> 8] - 1][cp & 0xFF] = code; // 全て既存のページに含まれる
+                }
+            }
+
+            /// @brief 対応するShift_JISの2バイトコード。なければ0
+            constexpr std::uint16_t find(char32_t cp) const noexcept
+            {
+                if (cp > 0xFFFF)
+                    return 0;
+                const unsigned page = page_of[cp >> 8];
+                return page == 0 ? 0 : pages[page - 1][cp & 0xFF];
+            }
+        };
+        inline constexpr reverse_table reverse{};
+
+        /// @brief 先頭から続くASCIIの長さ(SIMDで調べ、残りの端数はスカラーで数える)
+        inline std::size_t ascii_length(const unsigned char *p, std::size_t n) noexcept
+        {
+            auto len = utf::detail::ascii_run_length(reinterpret_cast<const char8_t *>(p), n);
+            while (len < n && p[len] < 0x80)
+                len++;
+            return len;
+        }
+    }
+
+    /// @brief Shift_JIS → UTF-8 の変換器
+    class decoder
+    {
+    public:
+        explicit decoder(error_policy policy = error_policy::replace) noexcept
+            : policy_(policy) {}
+
+        /// @brief inを変換してoutへ書く
+        /// @param last 最後の入力ならtrue。途中で切れている文字をエラー(置き換え)として扱う
+        result convert(std::span<const char> in, std::span<char8_t> out, bool last = false) noexcept
+        {
+            const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+            const std::size_t n = in.size();
+            char8_t *dst = out.data();
+            const std::size_t m = out.size();
+            std::size_t i = 0, o = 0;
+
+            // 前回の2バイト文字の続き
+            if (pending_lead_ != 0)
+            {
+                if (n == 0)
+                {
+                    if (!last)
+                        return {0, 0, status::ok};
+                    if (policy_ == error_policy::strict)
+                    {
+                        pending_lead_ = 0;
+                        return {0, 0, status::invalid_sequence};
+                    }
+                    const auto w = utf::detail::encode(0xFFFD, dst, m);
+                    if (w == 0)
+                        return {0, 0, status::output_full};
+                    pending_lead_ = 0;
+                    return {0, w, status::ok};
+                }
+                const auto [cp, len] = decode_pair(pending_lead_, p[0]);
+                if (cp == 0 && policy_ == error_policy::strict)
+                {
+                    pending_lead_ = 0;
+                    return {0, 0, status::invalid_sequence};
+                }
+                const auto w = utf::detail::encode(cp == 0 ? 0xFFFD : cp, dst, m);
+                if (w == 0)
+                    return {0, 0, status::output_full};
+                pending_lead_ = 0;
+                o = w;
+                i = len - 1; // 先頭バイトは前回消費済み
+            }
+
+            while (i < n)
+            {
+                const unsigned b = p[i];
+                if (b < 0x80)
+                {
+                    // ASCIIはまとめてコピーする
+                    auto run = detail::ascii_length(p + i, n - i);
+                    if (run > m - o)
+                        run = m - o;
+                    std::memcpy(dst + o, p + i, run);
+                    i += run;
+                    o += run;
+                    if (o == m && i < n)
+                        return {i, o, status::output_full};
+                    continue;
+                }
+
+                char32_t cp = 0;
+                std::size_t len = 1;
+                if (b >= 0xA1 && b <= 0xDF)
+                {
+                    cp = 0xFF61 + (b - 0xA1); // 半角カナ
+                }
+                else if (b == 0x80)
+                {
+                    cp = 0x80;
+                }
+                else if (detail::is_lead(b))
+                {
+                    if (i + 1 == n)
+                    {
+                        if (!last)
+                        {
+                            pending_lead_ = b; // 次の呼び出しへ持ち越す
+                            return {n, o, status::ok};
+                        }
+                    }
+                    else
+                    {
+                        const auto d = decode_pair(b, p[i + 1]);
+                        cp = d.cp;
+                        len = d.length;
+                    }
+                }
+
+                if (cp == 0)
+                {
+                    if (policy_ == error_policy::strict)
+                        return {i, o, status::invalid_sequence};
+                    cp = 0xFFFD;
+                }
+                const auto w = utf::detail::encode(cp, dst + o, m - o);
+                if (w == 0)
+                    return {i, o, status::output_full};
+                i += len;
+                o += w;
+            }
+            return {i, o, status::ok};
+        }
+
+        void reset() noexcept { pending_lead_ = 0; }
+
+    private:
+        struct pair_result
+        {
+            char32_t cp; // 0なら不正
+            std::size_t length;
+        };
+
+        static pair_result decode_pair(unsigned lead, unsigned trail) noexcept
+        {
+            if (const auto cp = detail::lookup(lead, trail); cp != 0)
+                return {cp, 2};
+            // 不正な場合、2バイト目がASCIIならそれは別の文字として読み直す(WHATWGの仕様と同じ)
+            return {0, trail < 0x80 ? 1u : 2u};
+        }
+
+        error_policy policy_;
+        unsigned pending_lead_ = 0;
+    };
+
+    /// @brief UTF-8 → Shift_JIS の変換器
+    class encoder
+    {
+    public:
+        explicit encoder(error_policy policy = error_policy::replace) noexcept
+            : policy_(policy) {}
+
+        /// @brief inを変換してoutへ書く
+        /// @param last 最後の入力ならtrue。途中で切れている文字をエラー(置き換え)として扱う
+        result convert(std::span<const char8_t> in, std::span<char> out, bool last = false) noexcept
+        {
+            const char8_t *p = in.data();
+            const std::size_t n = in.size();
+            char *dst = out.data();
+            const std::size_t m = out.size();
+            std::size_t i = 0, o = 0;
+
+            // 前回途中で切れたUTF-8の続き
+            if (pending_size_ > 0)
+            {
+                char8_t tmp[4];
+                std::memcpy(tmp, pending_, pending_size_);
+                const auto take = std::min<std::size_t>(4 - pending_size_, n);
+                std::memcpy(tmp + pending_size_, p, take);
+                const auto d = utf::detail::decode(tmp, pending_size_ + take);
+                if (d.ec == utf::status::truncated && !last)
+                {
+                    // まだ足りない。全部持ち越す
+                    std::memcpy(pending_ + pending_size_, p, take);
+                    pending_size_ += take;
+                    return {n, 0, status::ok};
+                }
+                if (d.length == 0)
+                {
+                    // 不正。まとめて渡された場合と結果を揃えるため、持ち越した1バイトごとに'?'にする
+                    // (持ち越したのは正しいUTF-8の途中までなので、続きのバイトで初めて不正と分かる)
+                    if (policy_ == error_policy::strict)
+                    {
+                        pending_size_ = 0;
+                        return {0, 0, status::invalid_sequence};
+                    }
+                    if (m < pending_size_)
+                        return {0, 0, status::output_full};
+                    std::memset(dst, '?', pending_size_);
+                    o = pending_size_;
+                }
+                else
+                {
+                    const auto r = put(d, dst, m);
+                    if (r.ec != status::ok)
+                    {
+                        if (r.ec != status::output_full)
+                            pending_size_ = 0;
+                        return {0, 0, r.ec};
+                    }
+                    i = d.length - pending_size_;
+                    o = r.written;
+                }
+                pending_size_ = 0;
+            }
+
+            while (i < n)
+            {
+                if (p[i] < 0x80)
+                {
+                    auto run = detail::ascii_length(reinterpret_cast<const unsigned char *>(p + i), n - i);
+                    if (run > m - o)
+                        run = m - o;
+                    std::memcpy(dst + o, p + i, run);
+                    i += run;
+                    o += run;
+                    if (o == m && i < n)
+                        return {i, o, status::output_full};
+                    continue;
+                }
+
+                // 日本語の大半を占める3バイト文字(2バイト目に特別な制約がないE1～EC, EE～EF)はここで読む
+                utf::detail::decoded d;
+                if (const unsigned b0 = p[i]; i + 3 <= n && b0 >= 0xE1 && b0 <= 0xEF && b0 != 0xED &&
+                                              (p[i + 1] & 0xC0) == 0x80 && (p[i + 2] & 0xC0) == 0x80)
+                    d = {((b0 & 0x0Fu) << 12) | ((p[i + 1] & 0x3Fu) << 6) | (p[i + 2] & 0x3Fu), 3, utf::status::ok};
+                else
+                    d = utf::detail::decode(p + i, n - i);
+                if (d.ec == utf::status::truncated && !last)
+                {
+                    // 入力の末尾で切れている。次の呼び出しへ持ち越す
+                    pending_size_ = n - i;
+                    std::memcpy(pending_, p + i, pending_size_);
+                    return {n, o, status::ok};
+                }
+                const auto r = put(d, dst + o, m - o);
+                if (r.ec != status::ok)
+                    return {i, o, r.ec};
+                i += d.length > 0 ? d.length : 1; // 不正なバイトは1バイトずつ読み飛ばす
+                o += r.written;
+            }
+            return {i, o, status::ok};
+        }
+
+        void reset() noexcept { pending_size_ = 0; }
+
+    private:
+        /// @brief 1文字をShift_JISで書く
+        result put(const utf::detail::decoded &d, char *out, std::size_t m) const noexcept
+        {
+            unsigned code = '?';
+            status error = status::ok;
+            if (d.length == 0)
+                error = status::invalid_sequence;
+            else if (d.cp <= 0x80)
+                code = d.cp;
+            else if (d.cp >= 0xFF61 && d.cp <= 0xFF9F)
+                code = d.cp - 0xFF61 + 0xA1; // 半角カナ
+            else if (const auto c = detail::reverse.find(d.cp); c != 0)
+                code = c;
+            else
+                error = status::unmappable;
+
+            if (error != status::ok && policy_ == error_policy::strict)
+                return {0, 0, error};
+            if (code < 0x100)
+            {
+                if (m < 1)
+                    return {0, 0, status::output_full};
+                out[0] = static_cast<char>(code);
+                return {0, 1, status::ok};
+            }
+            if (m < 2)
+                return {0, 0, status::output_full};
+            out[0] = static_cast<char>(code >> 8);
+            out[1] = static_cast<char>(code & 0xFF);
+            return {0, 2, status::ok};
+        }
+
+        error_policy policy_;
+        char8_t pending_[4]{};
+        std::size_t pending_size_ = 0;
+    };
+}
@@ -0,0 +1,195 @@
+/// 32bitハンドルで要素を指すスロットマップ
+// * 01_basic/01-cstdint.cpp ではポインタの値(intptr_t)をオブジェクトの一意なIDにしているが、
+//   1つの参照に8バイト必要で、実行ごとに値が変わり、削除済みのオブジェクトを指していても分からない
+// * slot_map はハンドルを「スロット番号 + 世代番号」の32bitで表す。要素を削除するとスロットの世代が進むので、
+//   古いハンドルで引くと nullptr になる(使用後解放を検出できる)
+//   - 挿入・削除・検索はO(1)。要素は配列に詰めて持つので、全要素の走査は配列をなめるだけ
+//   - 削除は末尾の要素を空いた位置へ移す(要素の順序は保たれない)
+// * 世代番号が上限に達したスロットは再利用しない(古いハンドルが一周して有効に見えることを防ぐ)
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace slot
+{
+    /// @brief 要素を指すハンドル。既定値は何も指さない
+    template <unsigned IndexBits>
+    struct basic_handle
+    {
+        static_assert(IndexBits >= 1 && IndexBits <= 31);
+        static constexpr unsigned index_bits = IndexBits;
+        static constexpr unsigned generation_bits = 32 - IndexBits;
+        static constexpr std::uint32_t max_index = (std::uint32_t{1} << IndexBits) - 1;
+        static constexpr std::uint32_t max_generation = (std::uint32_t{1} << generation_bits) - 1;
+
+        std::uint32_t value = 0; // 下位がスロット番号、上位が世代番号(世代は1から始まるので0は無効)
+
+        constexpr std::uint32_t index() const noexcept { return value & max_index; }
+        constexpr std::uint32_t generation() const noexcept { return value >> IndexBits; }
+        constexpr explicit operator bool() const noexcept { return value != 0; }
+        friend constexpr bool operator==(basic_handle, basic_handle) noexcept = default;
+
+        static constexpr basic_handle make(std::uint32_t index, std::uint32_t generation) noexcept
+        {
+            return {(generation << IndexBits) | index};
+        }
+    };
+
+    /// @param IndexBits スロット番号のビット数。残りが世代番号になる(既定では約100万要素・世代4095まで)
+    template <class T, unsigned IndexBits = 20>
+    class slot_map
+    {
+    public:
+        using handle = basic_handle<IndexBits>;
+        using value_type = T;
+        using iterator = typename std::vector<T>::iterator;
+        using const_iterator = typename std::vector<T>::const_iterator;
+
+        /// @brief 挿入できる要素数の上限
+        static constexpr std::size_t max_size() noexcept { return handle::max_index + 1; }
+
+        std::size_t size() const noexcept { return values_.size(); }
+        bool empty() const noexcept { return values_.empty(); }
+
+        void reserve(std::size_t n)
+        {
+            values_.reserve(n);
+            owners_.reserve(n);
+            slots_.reserve(n);
+        }
+
+        /// @brief 要素を作ってハンドルを返す。上限に達していれば無効なハンドルを返す
+        template <class... Args>
+        handle emplace(Args &&...args)
+        {
+            if (free_head_ == no_slot && slots_.size() >= max_size())
+                return {};
+            // 要素の構築が例外を投げても、スロット表は変わらないようにする
+            values_.emplace_back(std::forward<Args>(args)...);
+            std::uint32_t index;
+            if (free_head_ != no_slot)
+            {
+                index = free_head_;
+                free_head_ = slots_[index].position;
+            }
+            else
+            {
+                index = static_cast<std::uint32_t>(slots_.size());
+                slots_.push_back({no_slot, 1});
+            }
+            owners_.push_back(index);
+            slots_[index].position = static_cast<std::uint32_t>(values_.size() - 1);
+            return handle::make(index, slots_[index].generation);
+        }
+
+        handle insert(const T &value) { return emplace(value); }
+        handle insert(T &&value) { return emplace(std::move(value)); }
+
+        /// @brief hが指す要素を削除する。既に削除されていればfalse
+        bool erase(handle h)
+        {
+            if (!contains(h))
+                return false;
+            auto &s = slots_[h.index()];
+            const std::uint32_t position = s.position;
+            // 末尾の要素を空いた位置へ移し、その要素のスロットが指す位置を直す
+            if (position + 1 != values_.size())
+            {
+                values_[position] = std::move(values_.back());
+                owners_[position] = owners_.back();
+                slots_[owners_[position]].position = position;
+            }
+            values_.pop_back();
+            owners_.pop_back();
+
+            if (s.generation == handle::max_generation)
+            {
+                s.position = no_slot; // 世代を使い切ったスロットは空きリストへ戻さない
+                return true;
+            }
+            s.generation++;
+            s.position = free_head_;
+            free_head_ = h.index();
+            return true;
+        }
+
+        bool contains(handle h) const noexcept
+        {
+            // 空きスロットは世代が進んでいて、世代を使い切ったスロットは位置がno_slotになっている
+            return h.index() < slots_.size() && slots_[h.index()].generation == h.generation() &&
+                   slots_[h.index()].position != no_slot;
+        }
+
+        /// @brief hが指す要素。削除済みならnullptr
+        T *find(handle h) noexcept
+        {
+            return contains(h) ? &values_[slots_[h.index()].position] : nullptr;
+        }
+
+        const T *find(handle h) const noexcept
+        {
+            return contains(h) ? &values_[slots_[h.index()].position] : nullptr;
+        }
+
+        /// @brief hが有効であること
+        T &operator[](handle h) noexcept
+        {
+            assert(contains(h));
+            return values_[slots_[h.index()].position];
+        }
+
+        const T &operator[](handle h) const noexcept
+        {
+            assert(contains(h));
+            return values_[slots_[h.index()].position];
+        }
+
+        /// @brief 詰めて並んだ要素(順序は挿入順とは限らない)
+        std::span<T> values() noexcept { return values_; }
+        std::span<const T> values() const noexcept { return values_; }
+
+        /// @brief values()のi番目の要素を指すハンドル
+        handle handle_at(std::size_t i) const noexcept
+        {
+            const auto index = owners_[i];
+            return handle::make(index, slots_[index].generation);
+        }
+
+        iterator begin() noexcept { return values_.begin(); }
+        iterator end() noexcept { return values_.end(); }
+        const_iterator begin() const noexcept { return values_.begin(); }
+        const_iterator end() const noexcept { return values_.end(); }
+
+        void clear() noexcept
+        {
+            for (std::size_t i = values_.size(); i-- > 0;)
+                erase(handle_at(i));
+        }
+
+        /// @brief 要素以外に使っているバイト数(スロット表と逆引き表)
+        std::size_t overhead_bytes() const noexcept
+        {
+            return slots_.capacity() * sizeof(slot_entry) + owners_.capacity() * sizeof(std::uint32_t);
+        }
+
+    private:
+        static constexpr std::uint32_t no_slot = std::numeric_limits<std::uint32_t>::max();
+
+        struct slot_entry
+        {
+            std::uint32_t position;   // 使用中ならvalues_内の位置、空きなら次の空きスロット
+            std::uint32_t generation; // ハンドルの世代と一致すれば有効
+        };
+
+        std::vector<T> values_;             // 要素(詰めて並べる)
+        std::vector<std::uint32_t> owners_; // values_[i] のスロット番号
+        std::vector<slot_entry> slots_;
+        std::uint32_t free_head_ = no_slot;
+    };
+}
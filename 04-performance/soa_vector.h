@@ -0,0 +1,289 @@
+/// 構造体の配列を、メンバーごとの配列に分けて持つコンテナ(Structure of Arrays)
+// * 01_basic/03-scoped_enum.cpp の get_rgb() のような (r, g, b) の組を std::vector<rgb> に並べると、
+//   rだけを処理するときもg, bを一緒にキャッシュへ読み込み、メモリの帯域の2/3が無駄になる
+// * soa_vector<Fields...> はメンバーごとにキャッシュライン境界(64バイト)から始まる配列を持つ
+//   - v[i] は各配列の要素への参照を束ねた std::tuple<Fields&...> を返す。auto [r, g, b] = v[i] で分解でき、
+//     r, g, b は要素への参照になる(書き換えるとコンテナの中身が変わる)
+//   - column<I>() はI番目のメンバーの配列を std::span で返す。SIMDの処理にそのまま渡せる
+// * 要素の型はムーブが例外を投げないこと(再確保で要素を移すため)
+// * 反復子の参照も tuple<Fields&...> なので、std::sort などの要素を入れ替えるアルゴリズムには使えない
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace soa
+{
+    template <class... Fields>
+        requires(sizeof...(Fields) > 0 && (std::is_nothrow_move_constructible_v<Fields> && ...))
+    class soa_vector
+    {
+        template <std::size_t I>
+        using field_t = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+        static constexpr std::size_t alignment = 64; // キャッシュラインの大きさ
+        using indices = std::index_sequence_for<Fields...>;
+
+        template <bool Const>
+        class basic_iterator
+        {
+            using owner = std::conditional_t<Const, const soa_vector, soa_vector>;
+
+        public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag; // 参照が本物の参照ではないため
+            using value_type = std::tuple<Fields...>;
+            using reference = std::conditional_t<Const, std::tuple<const Fields &...>, std::tuple<Fields &...>>;
+            using difference_type = std::ptrdiff_t;
+
+            basic_iterator() noexcept = default;
+            basic_iterator(owner *v, std::size_t i) noexcept : v_(v), i_(i) {}
+
+            reference operator*() const noexcept { return (*v_)[i_]; }
+            reference operator[](difference_type n) const noexcept { return (*v_)[i_ + n]; }
+
+            basic_iterator &operator++() noexcept { return ++i_, *this; }
+            basic_iterator &operator--() noexcept { return --i_, *this; }
+            basic_iterator operator++(int) noexcept { return {v_, i_++}; }
+            basic_iterator operator--(int) noexcept { return {v_, i_--}; }
+            basic_iterator &operator+=(difference_type n) noexcept { return i_ += n, *this; }
+            basic_iterator &operator-=(difference_type n) noexcept { return i_ -= n, *this; }
+            friend basic_iterator operator+(basic_iterator it, difference_type n) noexcept { return it += n; }
+            friend basic_iterator operator+(difference_type n, basic_iterator it) noexcept { return it += n; }
+            friend basic_iterator operator-(basic_iterator it, difference_type n) noexcept { return it -= n; }
+            friend difference_type operator-(const basic_iterator &a, const basic_iterator &b) noexcept
+            {
+                return static_cast<difference_type>(a.i_) - static_cast<difference_type>(b.i_);
+            }
+            friend bool operator==(const basic_iterator &a, const basic_iterator &b) noexcept { return a.i_ == b.i_; }
+            friend auto operator<=>(const basic_iterator &a, const basic_iterator &b) noexcept { return a.i_ <=> b.i_; }
+
+        private:
+            owner *v_ = nullptr;
+            std::size_t i_ = 0;
+        };
+
+    public:
+        using value_type = std::tuple<Fields...>;
+        using reference = std::tuple<Fields &...>;
+        using const_reference = std::tuple<const Fields &...>;
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        soa_vector() = default;
+
+        explicit soa_vector(std::size_t n) { resize(n); }
+
+        soa_vector(std::initializer_list<value_type> init)
+        {
+            reserve(init.size());
+            for (const auto &v : init)
+                push_back(v);
+        }
+
+        soa_vector(const soa_vector &other)
+        {
+            reserve(other.size_);
+            copy_from(other, indices{});
+        }
+
+        soa_vector(soa_vector &&other) noexcept
+            : columns_(std::exchange(other.columns_, {})), size_(std::exchange(other.size_, 0)), capacity_(std::exchange(other.capacity_, 0)) {}
+
+        soa_vector &operator=(soa_vector other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~soa_vector()
+        {
+            clear();
+            deallocate(columns_, indices{});
+        }
+
+        void swap(soa_vector &other) noexcept
+        {
+            std::swap(columns_, other.columns_);
+            std::swap(size_, other.size_);
+            std::swap(capacity_, other.capacity_);
+        }
+
+        std::size_t size() const noexcept { return size_; }
+        std::size_t capacity() const noexcept { return capacity_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        void reserve(std::size_t n)
+        {
+            if (n <= capacity_)
+                return;
+            auto columns = allocate(n, indices{});
+            relocate(columns, indices{});
+            deallocate(columns_, indices{});
+            columns_ = columns;
+            capacity_ = n;
+        }
+
+        /// @brief 要素数をnにする。増えた要素は値初期化する
+        void resize(std::size_t n)
+        {
+            if (n < size_)
+            {
+                destroy(n, indices{});
+                size_ = n;
+                return;
+            }
+            reserve(n);
+            for (; size_ < n; size_++)
+                construct_at(size_, indices{});
+        }
+
+        void clear() noexcept
+        {
+            destroy(0, indices{});
+            size_ = 0;
+        }
+
+        /// @brief 末尾にメンバーの値を並べて追加する
+        template <class... Args>
+            requires(sizeof...(Args) == sizeof...(Fields))
+        reference emplace_back(Args &&...args)
+        {
+            if (size_ == capacity_)
+                reserve(capacity_ ? capacity_ * 2 : 16);
+            construct_at(size_, indices{}, std::forward<Args>(args)...);
+            return (*this)[size_++];
+        }
+
+        void push_back(const value_type &value)
+        {
+            std::apply([this](const auto &...v)
+                       { emplace_back(v...); },
+                       value);
+        }
+
+        void push_back(value_type &&value)
+        {
+            std::apply([this](auto &...v)
+                       { emplace_back(std::move(v)...); },
+                       value);
+        }
+
+        void pop_back() noexcept
+        {
+            destroy(size_ - 1, indices{});
+            size_--;
+        }
+
+        /// @brief i番目の要素(各メンバーへの参照の組)
+        reference operator[](std::size_t i) noexcept { return at_index<reference>(columns_, i, indices{}); }
+        const_reference operator[](std::size_t i) const noexcept { return at_index<const_reference>(columns_, i, indices{}); }
+
+        reference front() noexcept { return (*this)[0]; }
+        reference back() noexcept { return (*this)[size_ - 1]; }
+
+        /// @brief I番目のメンバーの配列(先頭は64バイト境界にある)
+        template <std::size_t I>
+        std::span<field_t<I>> column() noexcept { return {std::get<I>(columns_), size_}; }
+
+        template <std::size_t I>
+        std::span<const field_t<I>> column() const noexcept { return {std::get<I>(columns_), size_}; }
+
+        iterator begin() noexcept { return {this, 0}; }
+        iterator end() noexcept { return {this, size_}; }
+        const_iterator begin() const noexcept { return {this, 0}; }
+        const_iterator end() const noexcept { return {this, size_}; }
+
+        /// @brief 1要素あたりのバイト数(パディングなし)
+        static constexpr std::size_t element_bytes() noexcept { return (sizeof(Fields) + ...); }
+
+        std::size_t memory_usage() const noexcept { return capacity_ * element_bytes(); }
+
+    private:
+        using pointers = std::tuple<Fields *...>;
+
+        template <std::size_t... I>
+        static pointers allocate(std::size_t n, std::index_sequence<I...>)
+        {
+            pointers p{};
+            std::size_t done = 0;
+            try
+            {
+                ((std::get<I>(p) = static_cast<field_t<I> *>(::operator new(n * sizeof(field_t<I>), std::align_val_t{alignment})), done++), ...);
+            }
+            catch (...)
+            {
+                ((I < done ? ::operator delete(std::get<I>(p), std::align_val_t{alignment}) : void()), ...);
+                throw;
+            }
+            return p;
+        }
+
+        template <std::size_t... I>
+        static void deallocate(const pointers &p, std::index_sequence<I...>) noexcept
+        {
+            ((std::get<I>(p) ? ::operator delete(std::get<I>(p), std::align_val_t{alignment}) : void()), ...);
+        }
+
+        /// @brief 全要素を新しい配列へムーブして、元の要素を破棄する
+        template <std::size_t... I>
+        void relocate(const pointers &to, std::index_sequence<I...>) noexcept
+        {
+            ((std::uninitialized_move_n(std::get<I>(columns_), size_, std::get<I>(to)), std::destroy_n(std::get<I>(columns_), size_)), ...);
+        }
+
+        /// @brief i番目の要素を作る。途中のメンバーで例外が出たら作ったメンバーを破棄する
+        template <std::size_t... I, class... Args>
+        void construct_at(std::size_t i, std::index_sequence<I...>, Args &&...args)
+        {
+            std::size_t done = 0;
+            try
+            {
+                if constexpr (sizeof...(Args) == 0)
+                    ((::new (static_cast<void *>(std::get<I>(columns_) + i)) field_t<I>(), done++), ...);
+                else
+                    ((::new (static_cast<void *>(std::get<I>(columns_) + i)) field_t<I>(std::forward<Args>(args)), done++), ...);
+            }
+            catch (...)
+            {
+                ((I < done ? std::destroy_at(std::get<I>(columns_) + i) : void()), ...);
+                throw;
+            }
+        }
+
+        /// @brief first番目以降の要素を破棄する
+        template <std::size_t... I>
+        void destroy(std::size_t first, std::index_sequence<I...>) noexcept
+        {
+            if (size_ > first)
+                (std::destroy_n(std::get<I>(columns_) + first, size_ - first), ...);
+        }
+
+        template <std::size_t... I>
+        void copy_from(const soa_vector &other, std::index_sequence<I...>)
+        {
+            for (std::size_t i = 0; i < other.size_; i++)
+            {
+                construct_at(i, indices{}, std::get<I>(other.columns_)[i]...);
+                size_++;
+            }
+        }
+
+        template <class Ref, std::size_t... I>
+        static Ref at_index(const pointers &p, std::size_t i, std::index_sequence<I...>) noexcept
+        {
+            return Ref{std::get<I>(p)[i]...};
+        }
+
+        pointers columns_{};
+        std::size_t size_ = 0;
+        std::size_t capacity_ = 0;
+    };
+}
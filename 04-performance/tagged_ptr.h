@@ -0,0 +1,74 @@
+/// 下位ビットにフラグを詰めたポインタ
+// * alignof(T)が8なら、Tを指すポインタの下位3bitは常に0になる。この空きビットに小さな値(フラグや種類の番号)を
+//   入れておけば、ポインタとフラグを別々に持つより構造体が小さくなる(ポインタ+boolなら16バイト→8バイト)
+// * 整数との変換は std::uintptr_t を使う(01_basic/01-cstdint.cpp)。参照外しの前に必ずタグを取り除く
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace tagged
+{
+    /// @param Bits タグに使うビット数。既定はTのアラインメントで空いているビット数
+    template <class T, unsigned Bits = std::countr_zero(alignof(T))>
+    class tagged_ptr
+    {
+        static_assert(Bits >= 1, "アラインメントが1の型には空きビットがない");
+        static_assert(Bits <= std::countr_zero(alignof(T)), "Tのアラインメントで空いているビット数を超えている");
+
+    public:
+        static constexpr unsigned tag_bits = Bits;
+        static constexpr std::uintptr_t tag_mask = (std::uintptr_t{1} << Bits) - 1;
+
+        constexpr tagged_ptr() noexcept = default;
+
+        explicit tagged_ptr(T *p, std::uintptr_t tag = 0) noexcept
+        {
+            reset(p, tag);
+        }
+
+        T *get() const noexcept { return reinterpret_cast<T *>(value_ & ~tag_mask); }
+        T *operator->() const noexcept { return get(); }
+        T &operator*() const noexcept { return *get(); }
+        explicit operator bool() const noexcept { return get() != nullptr; }
+
+        std::uintptr_t tag() const noexcept { return value_ & tag_mask; }
+
+        void set_tag(std::uintptr_t tag) noexcept
+        {
+            assert(tag <= tag_mask);
+            value_ = (value_ & ~tag_mask) | tag;
+        }
+
+        /// @brief タグのiビット目をフラグとして読み書きする
+        bool flag(unsigned i) const noexcept
+        {
+            assert(i < Bits);
+            return (value_ >> i) & 1;
+        }
+
+        void set_flag(unsigned i, bool on) noexcept
+        {
+            assert(i < Bits);
+            value_ = (value_ & ~(std::uintptr_t{1} << i)) | (std::uintptr_t{on} << i);
+        }
+
+        void reset(T *p, std::uintptr_t tag = 0) noexcept
+        {
+            const auto address = reinterpret_cast<std::uintptr_t>(p);
+            assert((address & tag_mask) == 0); // アラインメントが合っていないポインタは入れられない
+            assert(tag <= tag_mask);
+            value_ = address | tag;
+        }
+
+        /// @brief ポインタとタグを合わせた整数(比較やハッシュに使う)
+        std::uintptr_t raw() const noexcept { return value_; }
+
+        friend bool operator==(tagged_ptr, tagged_ptr) noexcept = default;
+
+    private:
+        std::uintptr_t value_ = 0;
+    };
+}
@@ -0,0 +1,245 @@
+/// 文字(コードポイント)単位で扱えるUTF-8文字列のビュー
+// * 02-advanced/03-character-2.cpp のとおり std::u8string::size() はバイト数を返す。
+//   文字数や「n文字目」の位置を求めるには先頭から数える必要がある
+// * 文字数は「続きのバイト(0x80～0xBF)ではないバイト」の数なので、SIMDで16/32バイトずつ比較して
+//   ビットマスクのpopcountで数える
+// * 何度も「n文字目」を求める場合は utf8_index で疎な索引(N文字ごとのバイト位置)を作っておくと、
+//   索引から高々N文字だけ数えれば済む
+// * 正しいUTF-8であることが前提(utf::validate_utf8で事前に確認しておくこと)。
+//   ただし不正なバイト列でも範囲外アクセスはしない
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace utf
+{
+    namespace detail
+    {
+        constexpr bool is_continuation(char8_t c) noexcept
+        {
+            return (c & 0xC0) == 0x80;
+        }
+
+        /// @brief p[0..n)のうちi文字目(0始まり)が始まるバイト位置。足りなければnを返し、remainに残りの文字数を入れる
+        ///  use_simd=falseならスカラー版(比較用)
+        inline std::size_t find_char(const char8_t *p, std::size_t n, std::size_t index, std::size_t &remain,
+                                     bool use_simd = true) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            if (use_simd)
+            {
+                // 符号付きで見ると続きのバイトは-128～-65(-64より小さい)。それ以外が文字の先頭
+                const auto threshold = _mm256_set1_epi8(-64);
+                for (; i + 32 <= n; i += 32)
+                {
+                    const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                    auto lead = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(threshold, v)));
+                    const auto count = static_cast<std::size_t>(std::popcount(lead));
+                    if (index < count)
+                    {
+                        for (; index > 0; index--)
+                            lead &= lead - 1; // 下位から順にビットを消す
+                        remain = 0;
+                        return i + std::countr_zero(lead);
+                    }
+                    index -= count;
+                }
+            }
+#elif defined(__SSE2__) || defined(_M_X64)
+            if (use_simd)
+            {
+                const auto threshold = _mm_set1_epi8(-64);
+                for (; i + 16 <= n; i += 16)
+                {
+                    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                    auto lead = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(threshold, v))) & 0xFFFF;
+                    const auto count = static_cast<std::size_t>(std::popcount(lead));
+                    if (index < count)
+                    {
+                        for (; index > 0; index--)
+                            lead &= lead - 1;
+                        remain = 0;
+                        return i + std::countr_zero(lead);
+                    }
+                    index -= count;
+                }
+            }
+#else
+            (void)use_simd;
+#endif
+            for (; i < n; i++)
+            {
+                if (!is_continuation(p[i]))
+                {
+                    if (index == 0)
+                    {
+                        remain = 0;
+                        return i;
+                    }
+                    index--;
+                }
+            }
+            remain = index;
+            return n;
+        }
+    }
+
+    /// @brief UTF-8の文字数(コードポイント数)を数える
+    inline std::size_t count_code_points(std::u8string_view s, bool use_simd = true) noexcept
+    {
+        const char8_t *p = s.data();
+        const std::size_t n = s.size();
+        std::size_t i = 0, continuations = 0;
+#if defined(__AVX2__)
+        if (use_simd)
+        {
+            const auto threshold = _mm256_set1_epi8(-64);
+            for (; i + 32 <= n; i += 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                continuations += std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(threshold, v))));
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        if (use_simd)
+        {
+            const auto threshold = _mm_set1_epi8(-64);
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                continuations += std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(threshold, v))));
+            }
+        }
+#endif
+        for (; i < n; i++)
+            continuations += detail::is_continuation(p[i]);
+        return n - continuations;
+    }
+
+    /// @brief 文字単位の操作ができるUTF-8文字列のビュー。std::u8string_viewと同じく所有はしない
+    class utf8_view
+    {
+    public:
+        constexpr utf8_view() noexcept = default;
+        constexpr utf8_view(std::u8string_view s) noexcept : s_(s) {}
+
+        /// @brief バイト数
+        constexpr std::size_t size_bytes() const noexcept { return s_.size(); }
+
+        /// @brief 文字数。呼ぶたびに数える(O(n))ので、何度も使うなら結果を保存しておくこと
+        std::size_t size() const noexcept { return count_code_points(s_); }
+
+        constexpr bool empty() const noexcept { return s_.empty(); }
+        constexpr std::u8string_view bytes() const noexcept { return s_; }
+
+        /// @brief index文字目のバイト位置。文字数以上ならsize_bytes()を返す
+        std::size_t byte_offset(std::size_t index) const noexcept
+        {
+            std::size_t remain;
+            return detail::find_char(s_.data(), s_.size(), index, remain);
+        }
+
+        /// @brief pos文字目からcount文字分の部分文字列
+        utf8_view substr(std::size_t pos, std::size_t count = std::u8string_view::npos) const noexcept
+        {
+            const auto begin = byte_offset(pos);
+            if (count == std::u8string_view::npos)
+                return s_.substr(begin);
+            std::size_t remain;
+            const auto len = detail::find_char(s_.data() + begin, s_.size() - begin, count, remain);
+            return s_.substr(begin, len);
+        }
+
+        /// @brief 先頭からmax_bytesバイト以内に収まる最長の部分を、文字の途中で切らずに返す
+        constexpr utf8_view truncate_bytes(std::size_t max_bytes) const noexcept
+        {
+            if (max_bytes >= s_.size())
+                return *this;
+            // 切る位置が続きのバイトなら、文字の先頭まで戻る(UTF-8の1文字は最大4バイト)
+            std::size_t end = max_bytes;
+            for (int k = 0; k < 3 && end > 0 && detail::is_continuation(s_[end]); k++)
+                end--;
+            return s_.substr(0, end);
+        }
+
+        /// @brief 先頭からcount文字分
+        utf8_view truncate_chars(std::size_t count) const noexcept
+        {
+            return s_.substr(0, byte_offset(count));
+        }
+
+    private:
+        std::u8string_view s_;
+    };
+
+    /// @brief stride文字ごとのバイト位置を記録した疎な索引
+    ///  「n文字目」の検索が、索引を引く + 高々stride文字を数える、で済む
+    class utf8_index
+    {
+    public:
+        /// @param stride 何文字ごとに記録するか。0なら std::invalid_argument を投げる
+        explicit utf8_index(utf8_view s, std::size_t stride = 256)
+            : s_(s), stride_(stride)
+        {
+            if (stride == 0) // 0では索引が1文字も進まない
+                throw std::invalid_argument("utf8_index: stride must be positive");
+            const auto bytes = s.bytes();
+            std::size_t pos = 0;
+            offsets_.push_back(0);
+            for (;;)
+            {
+                std::size_t remain;
+                const auto next = detail::find_char(bytes.data() + pos, bytes.size() - pos, stride_, remain);
+                if (remain != 0 || pos + next == bytes.size())
+                {
+                    size_ = (offsets_.size() - 1) * stride_ + (stride_ - remain);
+                    break;
+                }
+                pos += next;
+                offsets_.push_back(pos);
+            }
+        }
+
+        /// @brief 文字数(索引を作るときに数え済みなのでO(1))
+        std::size_t size() const noexcept { return size_; }
+
+        /// @brief index文字目のバイト位置。文字数以上ならsize_bytes()を返す
+        std::size_t byte_offset(std::size_t index) const noexcept
+        {
+            if (index >= size_)
+                return s_.size_bytes();
+            const auto base = offsets_[index / stride_];
+            const auto bytes = s_.bytes();
+            std::size_t remain;
+            return base + detail::find_char(bytes.data() + base, bytes.size() - base, index % stride_, remain);
+        }
+
+        /// @brief pos文字目からcount文字分の部分文字列
+        utf8_view substr(std::size_t pos, std::size_t count) const noexcept
+        {
+            const auto begin = byte_offset(pos);
+            const auto end = count >= size_ - std::min(pos, size_) ? s_.size_bytes() : byte_offset(pos + count);
+            return s_.bytes().substr(begin, end - begin);
+        }
+
+        /// @brief 索引が使うメモリ(バイト)
+        std::size_t memory_usage() const noexcept { return offsets_.capacity() * sizeof(std::size_t); }
+
+    private:
+        utf8_view s_;
+        std::size_t stride_;
+        std::size_t size_ = 0;
+        std::vector<std::size_t> offsets_; // offsets_[k] = k*stride_文字目のバイト位置
+    };
+}
@@ -0,0 +1,113 @@
+/// 文字列リテラルのコンパイル時変換(UTF-8/UTF-16/UTF-32/wchar_t)
+// * 02-advanced/03-character-2.cpp では同じ文字列を u8"..." / u"..." / U"..." / L"..." と何度も書いていた。
+//   1つのリテラルから他の文字型の文字列をコンパイル時に作る
+// * 変換はconstevalで行い、結果は静的な std::array に置かれる(実行時の変換もメモリ確保もない)
+// * 不正なシーケンス(単独のサロゲートや不正なUTF-8バイト)はコンパイルエラーになる
+// * 1文字ずつの変換には utf_transcode.h の detail::decode / detail::encode (constexpr)を使う
+//
+// 使い方:
+//   constexpr std::u16string_view s = utf::literal_view<char16_t, u8"あいう">;
+//   using namespace utf::literals;
+//   constexpr std::u32string_view t = u8"あいう"_u32;
+#pragma once
+
+#include "utf_transcode.h"
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace utf
+{
+    /// @brief テンプレート引数に文字列リテラルを渡すための型(終端のnullを含む)
+    template <class Char, std::size_t N>
+    struct fixed_string
+    {
+        using value_type = Char;
+        Char data[N]{};
+
+        consteval fixed_string(const Char (&s)[N]) noexcept
+        {
+            for (std::size_t i = 0; i < N; i++)
+                data[i] = s[i];
+        }
+
+        /// @brief 終端のnullを除いた要素数
+        static constexpr std::size_t size() noexcept { return N - 1; }
+    };
+
+    namespace detail
+    {
+        /// @brief wchar_tを大きさの同じUnicodeの文字型として扱う(Windowsは2バイト、それ以外は4バイト)
+        template <class Char>
+        using unicode_unit_t = std::conditional_t<
+            std::is_same_v<Char, wchar_t>,
+            std::conditional_t<sizeof(wchar_t) == 2, char16_t, char32_t>,
+            Char>;
+
+        // constexprでない関数なので、コンパイル時に呼ばれるとこの名前の付いたエラーになる
+        inline void invalid_unicode_in_literal() {}
+
+        /// @brief s[0..n)を変換してoutへ書き、書いた要素数を返す。outがnullptrなら数えるだけ
+        ///  不正なシーケンスがあればコンパイルエラー
+        template <class Out, class In>
+        consteval std::size_t transcode_literal(const In *s, std::size_t n, Out *out)
+        {
+            using in_unit = unicode_unit_t<In>;
+            using out_unit = unicode_unit_t<Out>;
+            std::size_t written = 0;
+            for (std::size_t i = 0; i < n;)
+            {
+                // wchar_tのままではdecodeできないので、Unicodeの文字型の一時領域へ移してから読む
+                in_unit in[4] = {};
+                const std::size_t m = n - i < 4 ? n - i : 4;
+                for (std::size_t k = 0; k < m; k++)
+                    in[k] = static_cast<in_unit>(s[i + k]);
+                const auto d = decode(in, m);
+                if (d.ec != status::ok)
+                    invalid_unicode_in_literal();
+                out_unit units[4] = {};
+                const auto len = encode(d.cp, units, 4);
+                for (std::size_t k = 0; k < len; k++)
+                {
+                    if (out)
+                        out[written] = static_cast<Out>(units[k]);
+                    written++;
+                }
+                i += static_cast<std::size_t>(d.length);
+            }
+            return written;
+        }
+
+        template <class Out, fixed_string S>
+        consteval auto make_literal()
+        {
+            constexpr auto length = transcode_literal<Out>(S.data, S.size(), static_cast<Out *>(nullptr));
+            std::array<Out, length + 1> out{}; // 終端のnullを付ける(c_str()のように渡せるように)
+            transcode_literal<Out>(S.data, S.size(), out.data());
+            return out;
+        }
+    }
+
+    /// @brief リテラルSをOutの文字列に変換した静的な配列(終端のnullを含む)
+    template <class Out, fixed_string S>
+    inline constexpr auto literal_array = detail::make_literal<Out, S>();
+
+    /// @brief リテラルSをOutの文字列に変換したもの。中身は静的な配列literal_arrayを指す
+    template <class Out, fixed_string S>
+    inline constexpr std::basic_string_view<Out> literal_view{literal_array<Out, S>.data(), literal_array<Out, S>.size() - 1};
+
+    namespace literals
+    {
+        // u8"..."_u16 のように、どの文字型のリテラルにも付けられる
+        template <fixed_string S>
+        consteval std::u8string_view operator""_u8() { return literal_view<char8_t, S>; }
+        template <fixed_string S>
+        consteval std::u16string_view operator""_u16() { return literal_view<char16_t, S>; }
+        template <fixed_string S>
+        consteval std::u32string_view operator""_u32() { return literal_view<char32_t, S>; }
+        template <fixed_string S>
+        consteval std::wstring_view operator""_w() { return literal_view<wchar_t, S>; }
+    }
+}
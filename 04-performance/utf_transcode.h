@@ -0,0 +1,528 @@
+/// UTF-8/UTF-16/UTF-32の相互変換と検証
+// * 02-advanced/03-character-1.md にあるとおりcodecvtは非推奨になったので、自前で変換する
+// * 6方向の変換すべてを std::span で受け取り、呼び出し側が用意したバッファに書き出す(メモリ確保なし)
+// * 不正なシーケンス(冗長表現、サロゲートの単独出現、U+10FFFFを超える値など)はエラーとして検出する
+// * ASCIIの連続(UTF-16/32同士ではサロゲートを含まない連続)はSSE2/AVX2でまとめて変換する。
+//   それ以外は1文字ずつのスカラー処理。utf::scalar に比較用のスカラー版がある
+//
+// 使い方:
+//   std::u16string out(utf::max_utf16_length(in.size()), u'\0');
+//   auto r = utf::utf8_to_utf16(in, out);
+//   if (r.ec == utf::status::ok) out.resize(r.written);
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define UTF_TRANSCODE_SSE2 1
+#endif
+
+namespace utf
+{
+    enum class status : std::uint8_t
+    {
+        ok,
+        invalid_sequence, // 不正な先頭バイト、続きのバイトの不足、冗長表現など
+        surrogate,        // 対になっていないサロゲート(UTF-8/32ではサロゲート自体が不正)
+        too_large,        // U+10FFFFを超える値
+        truncated,        // 入力の末尾で文字が途切れている
+        output_full,      // 出力バッファが足りない
+    };
+
+    /// @brief 変換結果。エラーの場合、readはエラーになった文字の先頭位置を指す
+    struct result
+    {
+        std::size_t read;    // 読んだ入力の要素数
+        std::size_t written; // 書いた出力の要素数
+        status ec;
+    };
+
+    /// @brief n要素の入力を変換するときに必要な出力要素数の上限
+    // (UTF-16/32の1要素はUTF-8で最大4バイト、UTF-32の1要素はUTF-16で最大2要素になる)
+    constexpr std::size_t max_utf8_length(std::size_t units) noexcept { return units * 4; }
+    constexpr std::size_t max_utf16_length(std::size_t units) noexcept { return units * 2; }
+    constexpr std::size_t max_utf32_length(std::size_t units) noexcept { return units; }
+
+    namespace detail
+    {
+        struct decoded
+        {
+            char32_t cp;
+            int length; // 0ならエラー
+            status ec;
+        };
+
+        //
+        // 1文字の読み込み
+        //
+        constexpr decoded decode(const char8_t *p, std::size_t n) noexcept
+        {
+            const unsigned b0 = p[0];
+            if (b0 < 0x80)
+                return {b0, 1, status::ok};
+
+            // 先頭バイトから長さと、2バイト目に許される範囲を決める(冗長表現とサロゲートを排除)
+            int len;
+            unsigned lo = 0x80, hi = 0xBF;
+            char32_t cp;
+            if (b0 >= 0xC2 && b0 <= 0xDF)
+            {
+                len = 2;
+                cp = b0 & 0x1F;
+            }
+            else if (b0 >= 0xE0 && b0 <= 0xEF)
+            {
+                len = 3;
+                cp = b0 & 0x0F;
+                if (b0 == 0xE0)
+                    lo = 0xA0; // 冗長表現
+                else if (b0 == 0xED)
+                    hi = 0x9F; // サロゲート(U+D800-DFFF)
+            }
+            else if (b0 >= 0xF0 && b0 <= 0xF4)
+            {
+                len = 4;
+                cp = b0 & 0x07;
+                if (b0 == 0xF0)
+                    lo = 0x90; // 冗長表現
+                else if (b0 == 0xF4)
+                    hi = 0x8F; // U+10FFFF超
+            }
+            else
+            {
+                return {0, 0, status::invalid_sequence};
+            }
+
+            if (n < static_cast<std::size_t>(len))
+            {
+                // 途中までは正しいか確認し、正しければ「途切れている」とする
+                for (std::size_t i = 1; i < n; i++)
+                {
+                    const unsigned b = p[i];
+                    if (b < (i == 1 ? lo : 0x80) || b > (i == 1 ? hi : 0xBF))
+                        return {0, 0, status::invalid_sequence};
+                }
+                return {0, 0, status::truncated};
+            }
+            const unsigned b1 = p[1];
+            if (b1 < lo || b1 > hi)
+                return {0, 0, (b0 == 0xED && b1 >= 0xA0 && b1 <= 0xBF) ? status::surrogate : status::invalid_sequence};
+            cp = (cp << 6) | (b1 & 0x3F);
+            for (int i = 2; i < len; i++)
+            {
+                const unsigned b = p[i];
+                if ((b & 0xC0) != 0x80)
+                    return {0, 0, status::invalid_sequence};
+                cp = (cp << 6) | (b & 0x3F);
+            }
+            return {cp, len, status::ok};
+        }
+
+        constexpr decoded decode(const char16_t *p, std::size_t n) noexcept
+        {
+            const char32_t u0 = p[0];
+            if (u0 < 0xD800 || u0 > 0xDFFF)
+                return {u0, 1, status::ok};
+            if (u0 > 0xDBFF) // 下位サロゲートが先に来た
+                return {0, 0, status::surrogate};
+            if (n < 2)
+                return {0, 0, status::truncated};
+            const char32_t u1 = p[1];
+            if (u1 < 0xDC00 || u1 > 0xDFFF)
+                return {0, 0, status::surrogate};
+            return {0x10000 + ((u0 - 0xD800) << 10) + (u1 - 0xDC00), 2, status::ok};
+        }
+
+        constexpr decoded decode(const char32_t *p, std::size_t) noexcept
+        {
+            const char32_t cp = p[0];
+            if (cp >= 0xD800 && cp <= 0xDFFF)
+                return {0, 0, status::surrogate};
+            if (cp > 0x10FFFF)
+                return {0, 0, status::too_large};
+            return {cp, 1, status::ok};
+        }
+
+        //
+        // 1文字の書き出し。書いた要素数を返す(足りなければ0)
+        //
+        constexpr std::size_t encode(char32_t cp, char8_t *out, std::size_t n) noexcept
+        {
+            if (cp < 0x80)
+            {
+                if (n < 1)
+                    return 0;
+                out[0] = static_cast<char8_t>(cp);
+                return 1;
+            }
+            if (cp < 0x800)
+            {
+                if (n < 2)
+                    return 0;
+                out[0] = static_cast<char8_t>(0xC0 | (cp >> 6));
+                out[1] = static_cast<char8_t>(0x80 | (cp & 0x3F));
+                return 2;
+            }
+            if (cp < 0x10000)
+            {
+                if (n < 3)
+                    return 0;
+                out[0] = static_cast<char8_t>(0xE0 | (cp >> 12));
+                out[1] = static_cast<char8_t>(0x80 | ((cp >> 6) & 0x3F));
+                out[2] = static_cast<char8_t>(0x80 | (cp & 0x3F));
+                return 3;
+            }
+            if (n < 4)
+                return 0;
+            out[0] = static_cast<char8_t>(0xF0 | (cp >> 18));
+            out[1] = static_cast<char8_t>(0x80 | ((cp >> 12) & 0x3F));
+            out[2] = static_cast<char8_t>(0x80 | ((cp >> 6) & 0x3F));
+            out[3] = static_cast<char8_t>(0x80 | (cp & 0x3F));
+            return 4;
+        }
+
+        constexpr std::size_t encode(char32_t cp, char16_t *out, std::size_t n) noexcept
+        {
+            if (cp < 0x10000)
+            {
+                if (n < 1)
+                    return 0;
+                out[0] = static_cast<char16_t>(cp);
+                return 1;
+            }
+            if (n < 2)
+                return 0;
+            cp -= 0x10000;
+            out[0] = static_cast<char16_t>(0xD800 + (cp >> 10));
+            out[1] = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+            return 2;
+        }
+
+        constexpr std::size_t encode(char32_t cp, char32_t *out, std::size_t n) noexcept
+        {
+            if (n < 1)
+                return 0;
+            out[0] = cp;
+            return 1;
+        }
+
+        //
+        // SIMDによるまとめ変換
+        // 先頭から「1要素=1文字で、変換後も1要素になる」範囲(ASCII、UTF-16/32同士ではサロゲートなし)を
+        // ブロック単位で変換し、処理した要素数を返す。条件を満たさないブロックが来たら止まる
+        //
+        template <class In, class Out>
+        inline std::size_t simd_block(const In *, std::size_t, Out *, std::size_t) noexcept
+        {
+            return 0; // SIMDが使えない環境では何もせず、スカラー処理に任せる
+        }
+
+#if defined(UTF_TRANSCODE_SSE2)
+        /// @brief 先頭から続くASCIIの長さ
+        inline std::size_t ascii_run_length(const char8_t *p, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= n; i += 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                if (const unsigned mask = _mm256_movemask_epi8(v); mask != 0)
+                    return i + __builtin_ctz(mask);
+            }
+#endif
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                if (const unsigned mask = _mm_movemask_epi8(v); mask != 0)
+                    return i + __builtin_ctz(mask);
+            }
+            return i; // 残りはスカラーで処理する
+        }
+
+        // UTF-8 → UTF-16 : ASCIIを16bitへゼロ拡張
+        inline std::size_t simd_block(const char8_t *in, std::size_t n, char16_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= n && i + 32 <= m; i += 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                if (_mm256_movemask_epi8(v) != 0)
+                    return i;
+                const auto lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+                const auto hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), lo);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 16), hi);
+            }
+#endif
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= n && i + 16 <= m; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                if (_mm_movemask_epi8(v) != 0)
+                    return i;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+            }
+            return i;
+        }
+
+        // UTF-8 → UTF-32 : ASCIIを32bitへゼロ拡張
+        inline std::size_t simd_block(const char8_t *in, std::size_t n, char32_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= n && i + 32 <= m; i += 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                if (_mm256_movemask_epi8(v) != 0)
+                    return i;
+                for (int k = 0; k < 4; k++)
+                {
+                    const auto bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i + k * 8));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + k * 8), _mm256_cvtepu8_epi32(bytes));
+                }
+            }
+#endif
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= n && i + 16 <= m; i += 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                if (_mm_movemask_epi8(v) != 0)
+                    return i;
+                const auto lo = _mm_unpacklo_epi8(v, zero);
+                const auto hi = _mm_unpackhi_epi8(v, zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4), _mm_unpackhi_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 12), _mm_unpackhi_epi16(hi, zero));
+            }
+            return i;
+        }
+
+        // UTF-16 → UTF-8 : 全要素が0x80未満なら8bitへ詰める
+        inline std::size_t simd_block(const char16_t *in, std::size_t n, char8_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+            const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= n && i + 16 <= m; i += 16)
+            {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8));
+                const auto high_bits = _mm_and_si128(_mm_or_si128(a, b), non_ascii);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, zero)) != 0xFFFF)
+                    return i;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(a, b));
+            }
+            return i;
+        }
+
+        // UTF-16 → UTF-32 : サロゲートを含まなければ32bitへゼロ拡張
+        inline std::size_t simd_block(const char16_t *in, std::size_t n, char32_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+            const auto mask = _mm_set1_epi16(static_cast<short>(0xF800));
+            const auto surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+            const auto zero = _mm_setzero_si128();
+            for (; i + 8 <= n && i + 8 <= m; i += 8)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), surrogate)) != 0)
+                    return i;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi16(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4), _mm_unpackhi_epi16(v, zero));
+            }
+            return i;
+        }
+
+        // UTF-32 → UTF-8 : 全要素が0x80未満なら8bitへ詰める
+        inline std::size_t simd_block(const char32_t *in, std::size_t n, char8_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+            const auto non_ascii = _mm_set1_epi32(~0x7F);
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= n && i + 16 <= m; i += 16)
+            {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 4));
+                const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8));
+                const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12));
+                const auto all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(all, non_ascii), zero)) != 0xFFFF)
+                    return i;
+                // 値は0x7F以下なので符号付き飽和でも値は変わらない
+                const auto ab = _mm_packs_epi32(a, b);
+                const auto cd = _mm_packs_epi32(c, d);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(ab, cd));
+            }
+            return i;
+        }
+
+        // UTF-32 → UTF-16 : 全要素がU+D800未満なら16bitへ詰める
+        inline std::size_t simd_block(const char32_t *in, std::size_t n, char16_t *out, std::size_t m) noexcept
+        {
+            std::size_t i = 0;
+            // 符号ビットを反転させると、符号付き比較で符号なし比較ができる
+            const auto flip = _mm_set1_epi32(static_cast<int>(0x80000000u));
+            const auto limit = _mm_set1_epi32(static_cast<int>(0x80000000u + 0xD800));
+            for (; i + 8 <= n && i + 8 <= m; i += 8)
+            {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 4));
+                const auto a_ok = _mm_cmplt_epi32(_mm_xor_si128(a, flip), limit);
+                const auto b_ok = _mm_cmplt_epi32(_mm_xor_si128(b, flip), limit);
+                if (_mm_movemask_epi8(_mm_and_si128(a_ok, b_ok)) != 0xFFFF)
+                    return i;
+                // 0x8000以上の値も正しく詰めるため、下位16bitを符号拡張してから符号付き飽和で詰める
+                const auto a16 = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+                const auto b16 = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a16, b16));
+            }
+            return i;
+        }
+#else
+        inline std::size_t ascii_run_length(const char8_t *, std::size_t) noexcept
+        {
+            return 0;
+        }
+#endif
+
+        /// @brief simd_blockで変換できる可能性がある要素か
+        template <class In, class Out>
+        constexpr bool simd_candidate(In unit) noexcept
+        {
+            if constexpr (sizeof(In) == 1 || sizeof(Out) == 1)
+                return unit < 0x80; // UTF-8が絡む場合はASCIIのみ
+            else
+                return unit < 0xD800; // UTF-16/32同士はサロゲートを含まない範囲
+        }
+
+        /// @brief 変換の本体。UseSimdがfalseならスカラー処理だけを行う(比較用)
+        template <bool UseSimd, class In, class Out>
+        result transcode(std::span<const In> in, std::span<Out> out) noexcept
+        {
+            const In *src = in.data();
+            Out *dst = out.data();
+            const std::size_t n = in.size();
+            const std::size_t m = out.size();
+            std::size_t i = 0, o = 0;
+            while (i < n)
+            {
+                if constexpr (UseSimd)
+                {
+                    // まとめ変換できそうな文字のときだけ試す(非ASCIIが続く文章で無駄に試さない)
+                    if (simd_candidate<In, Out>(src[i]))
+                    {
+                        const auto done = simd_block(src + i, n - i, dst + o, m - o);
+                        i += done;
+                        o += done;
+                        if (i == n)
+                            break;
+                    }
+                }
+                if (src[i] < 0x80 && o < m)
+                {
+                    // ASCIIはどの方向でもそのまま1要素になる(decode/encodeを呼ばずに済ませる)
+                    dst[o++] = static_cast<Out>(src[i++]);
+                    continue;
+                }
+                const auto d = decode(src + i, n - i);
+                if (d.length == 0)
+                    return {i, o, d.ec};
+                const auto w = encode(d.cp, dst + o, m - o);
+                if (w == 0)
+                    return {i, o, status::output_full};
+                i += d.length;
+                o += w;
+            }
+            return {i, o, status::ok};
+        }
+
+        template <bool UseSimd>
+        result validate_utf8(std::span<const char8_t> in) noexcept
+        {
+            const char8_t *p = in.data();
+            const std::size_t n = in.size();
+            std::size_t i = 0;
+            while (i < n)
+            {
+                if constexpr (UseSimd)
+                {
+                    if (p[i] < 0x80)
+                    {
+                        i += ascii_run_length(p + i, n - i);
+                        if (i == n)
+                            break;
+                    }
+                }
+                if (p[i] < 0x80)
+                {
+                    i++;
+                    continue;
+                }
+                const auto d = decode(p + i, n - i);
+                if (d.length == 0)
+                    return {i, 0, d.ec};
+                i += d.length;
+            }
+            return {i, 0, status::ok};
+        }
+    }
+
+    /// @brief UTF-8として正しいか検証する。readは検証できた長さ(エラーならエラー位置)
+    inline result validate_utf8(std::span<const char8_t> in) noexcept { return detail::validate_utf8<true>(in); }
+
+    inline result utf8_to_utf16(std::span<const char8_t> in, std::span<char16_t> out) noexcept { return detail::transcode<true>(in, out); }
+    inline result utf8_to_utf32(std::span<const char8_t> in, std::span<char32_t> out) noexcept { return detail::transcode<true>(in, out); }
+    inline result utf16_to_utf8(std::span<const char16_t> in, std::span<char8_t> out) noexcept { return detail::transcode<true>(in, out); }
+    inline result utf16_to_utf32(std::span<const char16_t> in, std::span<char32_t> out) noexcept { return detail::transcode<true>(in, out); }
+    inline result utf32_to_utf8(std::span<const char32_t> in, std::span<char8_t> out) noexcept { return detail::transcode<true>(in, out); }
+    inline result utf32_to_utf16(std::span<const char32_t> in, std::span<char16_t> out) noexcept { return detail::transcode<true>(in, out); }
+
+    /// @brief 比較用のスカラー実装
+    namespace scalar
+    {
+        inline result validate_utf8(std::span<const char8_t> in) noexcept { return detail::validate_utf8<false>(in); }
+
+        inline result utf8_to_utf16(std::span<const char8_t> in, std::span<char16_t> out) noexcept { return detail::transcode<false>(in, out); }
+        inline result utf8_to_utf32(std::span<const char8_t> in, std::span<char32_t> out) noexcept { return detail::transcode<false>(in, out); }
+        inline result utf16_to_utf8(std::span<const char16_t> in, std::span<char8_t> out) noexcept { return detail::transcode<false>(in, out); }
+        inline result utf16_to_utf32(std::span<const char16_t> in, std::span<char32_t> out) noexcept { return detail::transcode<false>(in, out); }
+        inline result utf32_to_utf8(std::span<const char32_t> in, std::span<char8_t> out) noexcept { return detail::transcode<false>(in, out); }
+        inline result utf32_to_utf16(std::span<const char32_t> in, std::span<char16_t> out) noexcept { return detail::transcode<false>(in, out); }
+    }
+
+    //
+    // 文字列を返す簡易版(メモリ確保あり)。変換に失敗したら空文字列を返す
+    //
+    template <class Out, class In>
+    std::basic_string<Out> convert(std::basic_string_view<In> in)
+    {
+        std::size_t capacity;
+        if constexpr (sizeof(Out) == 1)
+            capacity = max_utf8_length(in.size());
+        else if constexpr (sizeof(Out) == 2)
+            capacity = max_utf16_length(in.size());
+        else
+            capacity = max_utf32_length(in.size());
+        std::basic_string<Out> s(capacity, Out{});
+        const auto r = detail::transcode<true>(std::span<const In>(in.data(), in.size()), std::span<Out>(s));
+        if (r.ec != status::ok)
+            return {};
+        s.resize(r.written);
+        return s;
+    }
+
+    inline std::u16string to_u16string(std::u8string_view s) { return convert<char16_t>(s); }
+    inline std::u32string to_u32string(std::u8string_view s) { return convert<char32_t>(s); }
+    inline std::u8string to_u8string(std::u16string_view s) { return convert<char8_t>(s); }
+    inline std::u8string to_u8string(std::u32string_view s) { return convert<char8_t>(s); }
+    inline std::u32string to_u32string(std::u16string_view s) { return convert<char32_t>(s); }
+    inline std::u16string to_u16string(std::u32string_view s) { return convert<char16_t>(s); }
+}